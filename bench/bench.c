@@ -0,0 +1,235 @@
+/*
+ * Benchmarks for parsing, layout and rendering of decks.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Each stage is timed RUNS times for every FILE and reported as JSON on
+ * STDOUT. Decks are read from the file system (i.e. the page cache).
+ *
+ *
+ *   load       markdown_load() of the whole deck
+ *   layout     layout_deck(), the pre-pass computing rows and widths
+ *   slide      display_slide() into the headless backend, one sample
+ *              per slide and run
+ *   reshow     display_slide() of a slide shown twice before, i.e. a
+ *              replay of its display list
+ *   reload     free_deck(), markdown_load() and layout_deck() again,
+ *              plus drawing the current slide, as the r key does
+ *   goto_last  ncurses_display() with the headless backend and the
+ *              key G, i.e. layout, first slide, last slide
+ *
+ * Times are given in microseconds.
+ *
+ */
+
+#include <getopt.h>
+#include <limits.h>
+#include <locale.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "parser.h"
+#include "viewer.h"
+
+typedef struct _samples_t {
+    double *value;
+    size_t size;
+    size_t alloc;
+} samples_t;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void sample_add(samples_t *s, double v) {
+    if(s->size == s->alloc) {
+        s->alloc = s->alloc ? s->alloc * 2 : 64;
+        if((s->value = realloc(s->value, s->alloc * sizeof(double))) == NULL) {
+            fprintf(stderr, "%s\n", "sample_add() failed to reallocate memory.");
+            exit(EXIT_FAILURE);
+        }
+    }
+    s->value[s->size++] = v;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+static void sample_report(const char *name, samples_t *s, int last) {
+    double sum = 0;
+    size_t i;
+
+    qsort(s->value, s->size, sizeof(double), cmp_double);
+    for(i = 0; i < s->size; i++)
+        sum += s->value[i];
+
+    printf("      \"%s\": { \"n\": %zu, \"median\": %.3f, \"p99\": %.3f, \"min\": %.3f, \"max\": %.3f, \"mean\": %.3f }%s\n",
+           name, s->size,
+           s->size ? s->value[s->size / 2] : 0,
+           s->size ? s->value[(size_t) ((s->size - 1) * 0.99)] : 0,
+           s->size ? s->value[0] : 0,
+           s->size ? s->value[s->size - 1] : 0,
+           s->size ? sum / s->size : 0,
+           last ? "" : ",");
+
+    free(s->value);
+    s->value = NULL;
+    s->size = s->alloc = 0;
+}
+
+static deck_t *load(const char *file) {
+    FILE *input = fopen(file, "r");
+    deck_t *deck;
+
+    if(!input) {
+        perror(file);
+        exit(EXIT_FAILURE);
+    }
+    deck = markdown_load(input, 0);
+    fclose(input);
+    return deck;
+}
+
+static void bench(const char *file, int runs, int lines, int cols, int last) {
+    samples_t load_s = { 0 }, layout_s = { 0 }, slide_s = { 0 },
+              reshow_s = { 0 }, reload_s = { 0 }, goto_s = { 0 };
+    int max_lines, max_cols, max_lines_slide, stop, colors, sc, r;
+    long size;
+    double t;
+    FILE *input;
+    deck_t *deck;
+    slide_t *slide;
+    render_t *render;
+
+    if((input = fopen(file, "r")) == NULL) {
+        perror(file);
+        exit(EXIT_FAILURE);
+    }
+    fseek(input, 0, SEEK_END);
+    size = ftell(input);
+    fclose(input);
+
+    // find a geometry all slides fit in
+    deck = load(file);
+    while(layout_deck(deck, cols, &max_lines, &max_cols, &max_lines_slide))
+        cols *= 2;
+    lines = MAX(lines, max_lines + 2);
+    render = render_headless_init(lines, cols);
+    colors = setup_colors(render);
+
+    for(r = 0; r < runs; r++) {
+
+        t = now();
+        free_deck(deck);
+        deck = load(file);
+        sample_add(&load_s, now() - t);
+
+        t = now();
+        layout_deck(deck, cols, &max_lines, &max_cols, &max_lines_slide);
+        sample_add(&layout_s, now() - t);
+
+        for(slide = deck->slide, sc = 1; slide; slide = slide->next, sc++) {
+            slide->stop = INT_MAX - 1;
+            t = now();
+            display_slide(render, deck, slide, sc, max_cols, 2, colors, &stop);
+            (render->flush)(render);
+            sample_add(&slide_s, now() - t);
+        }
+
+        // the second time compiles the display lists
+        for(slide = deck->slide, sc = 1; slide; slide = slide->next, sc++)
+            display_slide(render, deck, slide, sc, max_cols, 2, colors, &stop);
+
+        for(slide = deck->slide, sc = 1; slide; slide = slide->next, sc++) {
+            t = now();
+            display_slide(render, deck, slide, sc, max_cols, 2, colors, &stop);
+            (render->flush)(render);
+            sample_add(&reshow_s, now() - t);
+        }
+
+        t = now();
+        free_deck(deck);
+        deck = load(file);
+        layout_deck(deck, cols, &max_lines, &max_cols, &max_lines_slide);
+        display_slide(render, deck, deck->slide, 1, max_cols, 2, colors, &stop);
+        (render->flush)(render);
+        sample_add(&reload_s, now() - t);
+
+        render_headless_input(render, "G");
+        t = now();
+        ncurses_display(deck, render, 0, 1, 2);
+        sample_add(&goto_s, now() - t);
+    }
+
+    printf("    \"%s\": {\n", file);
+    printf("      \"bytes\": %ld, \"slides\": %d, \"lines\": %d, \"cols\": %d,\n",
+           size, deck->slides, lines, cols);
+    sample_report("load", &load_s, 0);
+    sample_report("layout", &layout_s, 0);
+    sample_report("slide", &slide_s, 0);
+    sample_report("reshow", &reshow_s, 0);
+    sample_report("reload", &reload_s, 0);
+    sample_report("goto_last", &goto_s, 1);
+    printf("    }%s\n", last ? "" : ",");
+
+    (render->delete)(render);
+    free_deck(deck);
+}
+
+static void usage() {
+    fprintf(stderr, "%s", "Usage: bench [OPTION]... FILE...\n");
+    fprintf(stderr, "%s", "Time parsing, layout and rendering of decks, report JSON on STDOUT.\n\n");
+    fprintf(stderr, "%s", "  -r RUNS     number of runs per file (default 10)\n");
+    fprintf(stderr, "%s", "  -x COLS     columns of the headless screen (default 120)\n");
+    fprintf(stderr, "%s", "  -y LINES    minimum lines of the headless screen (default 40)\n");
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[]) {
+    int runs = 10, lines = 40, cols = 120;
+    int opt, i;
+
+    while((opt = getopt(argc, argv, "r:x:y:h")) != -1) {
+        switch(opt) {
+            case 'r': runs = atoi(optarg);  break;
+            case 'x': cols = atoi(optarg);  break;
+            case 'y': lines = atoi(optarg); break;
+            default : usage();              break;
+        }
+    }
+    if(optind >= argc || runs < 1)
+        usage();
+
+    if(!setlocale(LC_CTYPE, "") || !strcmp(setlocale(LC_CTYPE, NULL), "C"))
+        setlocale(LC_CTYPE, "C.UTF-8");
+
+    setup_list_strings();
+
+    printf("{\n  \"runs\": %d,\n  \"files\": {\n", runs);
+    for(i = optind; i < argc; i++)
+        bench(argv[i], runs, lines, cols, i == argc - 1);
+    printf("  }\n}\n");
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,165 @@
+/*
+ * Generator for synthetic decks used by the benchmarks.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *words[] = {
+    "slide", "deck", "terminal", "markdown", "render", "layout", "cursor",
+    "buffer", "escape", "present", "audience", "speaker", "note", "demo",
+    "code", "list", "header", "footer", "center", "quote", "cache", "frame",
+    "latency", "byte", "width", "unicode", "über", "naïve", "café", "λ",
+    NULL
+};
+
+static const char *entities[] = {
+    "&amp;", "&lt;", "&gt;", "&copy;", "&hellip;", "&#169;", "&#x2192;", "&rarr;",
+    NULL
+};
+
+static int nwords, nentities;
+
+static int chance(double p) {
+    return (double) rand() / RAND_MAX < p;
+}
+
+static void text(int len, double entity, double link) {
+    int n = 0;
+
+    while(n < len) {
+        if(n > 0) {
+            putchar(' ');
+            n++;
+        }
+        if(chance(entity)) {
+            n += printf("%s", entities[rand() % nentities]);
+        } else if(chance(link)) {
+            n += printf("[%s](https://example.com/%d)", words[rand() % nwords], rand() % 1000);
+        } else if(chance(0.05)) {
+            n += printf("*%s*", words[rand() % nwords]);
+        } else if(chance(0.05)) {
+            n += printf("`%s`", words[rand() % nwords]);
+        } else {
+            n += printf("%s", words[rand() % nwords]);
+        }
+    }
+    putchar('\n');
+}
+
+static void usage() {
+    fprintf(stderr, "%s", "Usage: gen [OPTION]...\n");
+    fprintf(stderr, "%s", "Write a synthetic markdown deck to STDOUT.\n\n");
+    fprintf(stderr, "%s", "  -n SLIDES   number of slides (default 100)\n");
+    fprintf(stderr, "%s", "  -l LINES    content lines per slide (default 10)\n");
+    fprintf(stderr, "%s", "  -w WIDTH    approximate line length (default 60)\n");
+    fprintf(stderr, "%s", "  -d DEPTH    maximum list depth, 0 for no lists (default 3)\n");
+    fprintf(stderr, "%s", "  -c RATIO    ratio of code blocks per slide (default 0.2)\n");
+    fprintf(stderr, "%s", "  -e DENSITY  character entities per word (default 0.02)\n");
+    fprintf(stderr, "%s", "  -u DENSITY  links per word (default 0.02)\n");
+    fprintf(stderr, "%s", "  -s SEED     random seed (default 1)\n");
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[]) {
+    int slides = 100, lines = 10, width = 60, depth = 3;
+    double code = 0.2, entity = 0.02, link = 0.02;
+    unsigned int seed = 1;
+    int opt, s, l, level;
+
+    while((opt = getopt(argc, argv, "n:l:w:d:c:e:u:s:h")) != -1) {
+        switch(opt) {
+            case 'n': slides = atoi(optarg); break;
+            case 'l': lines = atoi(optarg);  break;
+            case 'w': width = atoi(optarg);  break;
+            case 'd': depth = atoi(optarg);  break;
+            case 'c': code = atof(optarg);   break;
+            case 'e': entity = atof(optarg); break;
+            case 'u': link = atof(optarg);   break;
+            case 's': seed = atoi(optarg);   break;
+            default : usage();               break;
+        }
+    }
+
+    for(nwords = 0; words[nwords]; nwords++);
+    for(nentities = 0; entities[nentities]; nentities++);
+    srand(seed);
+
+    printf("%%title: Synthetic deck (%d slides)\n", slides);
+    printf("%%author: gen -n %d -l %d -w %d -d %d -c %g -e %g -u %g -s %u\n\n",
+           slides, lines, width, depth, code, entity, link, seed);
+
+    for(s = 1; s <= slides; s++) {
+        if(s > 1)
+            printf("\n---\n\n");
+
+        printf("# Slide %d\n\n", s);
+
+        for(l = 0; l < lines; ) {
+
+            if(chance(code / 2)) {
+                // fenced code block
+                printf("```\n");
+                for(; l < lines && chance(0.8); l++)
+                    printf("int %s_%d = %d; // %s\n", words[rand() % nwords], l, rand(), words[rand() % nwords]);
+                printf("```\n\n");
+                l++;
+
+            } else if(chance(code / 2)) {
+                // indented code block
+                for(; l < lines && chance(0.8); l++)
+                    printf("    %s(%d);\n", words[rand() % nwords], rand() % 100);
+                printf("\n");
+                l++;
+
+            } else if(depth > 0 && chance(0.3)) {
+                // nested list
+                for(level = 1; l < lines && chance(0.8); l++) {
+                    printf("%*s- ", (level - 1) * 4, "");
+                    text(width / 2, entity, link);
+                    if(level < depth && chance(0.4))
+                        level++;
+                    else if(level > 1 && chance(0.3))
+                        level--;
+                }
+                printf("\n");
+                l++;
+
+            } else if(chance(0.1)) {
+                printf("> ");
+                text(width, entity, link);
+                printf("\n");
+                l += 2;
+
+            } else if(chance(0.1)) {
+                printf("^\n");
+
+            } else {
+                text(width, entity, link);
+                printf("\n");
+                l += 2;
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,266 @@
+/*
+ * Keypress to output latency of smdp running under a pseudo-terminal.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * The command is started on a new pseudo-terminal, so no real terminal
+ * is needed. Once the first frame is shown, the keys of the script are
+ * sent one by one. A frame is considered complete when the output stays
+ * quiet for the given time, its latency is measured from sending the key
+ * to the last byte received. Keys that produce no output within the
+ * timeout are reported with a latency of -1.
+ *
+ * The script is a comma separated list of keys, each optionally followed
+ * by *N to repeat it N times. A key is a single character or one of:
+ *
+ *   next, prev, first, last, reload      j, k, g, G, r
+ *   up, down, left, right                arrow keys
+ *   home, end, pgup, pgdn                navigation keys
+ *   enter, space, backspace
+ *   goto:N                               the digits of N
+ *
+ * Results are printed as JSON on STDOUT, times in milliseconds.
+ *
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <getopt.h>
+#include <poll.h>
+#include <pty.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+typedef struct _result_t {
+    char name[32];
+    double latency;
+    long bytes;
+} result_t;
+
+static const struct {
+    const char *name;
+    const char *seq;
+} keys[] = {
+    { "next",      "j" },
+    { "prev",      "k" },
+    { "first",     "g" },
+    { "last",      "G" },
+    { "reload",    "r" },
+    { "up",        "\033[A" },
+    { "down",      "\033[B" },
+    { "right",     "\033[C" },
+    { "left",      "\033[D" },
+    { "home",      "\033[H" },
+    { "end",       "\033[F" },
+    { "pgup",      "\033[5~" },
+    { "pgdn",      "\033[6~" },
+    { "enter",     "\r" },
+    { "space",     " " },
+    { "backspace", "\177" },
+    { NULL, NULL }
+};
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static FILE *dump = NULL;
+
+// wait up to timeout ms for output, then read until it is quiet for
+// quiet ms, returns the time of the last byte or -1 if nothing came
+static double drain(int fd, int timeout, int quiet, long *bytes) {
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    char buf[65536];
+    double last = -1;
+    ssize_t n;
+    int r;
+
+    *bytes = 0;
+    while((r = poll(&pfd, 1, last < 0 ? timeout : quiet)) != 0) {
+        if(r < 0) {
+            if(errno == EINTR)
+                continue;
+            break;
+        }
+        n = read(fd, buf, sizeof(buf));
+        if(n <= 0)
+            break;
+        last = now();
+        *bytes += n;
+        if(dump)
+            fwrite(buf, 1, n, dump);
+    }
+    return last;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(double *v, int n, double p) {
+    return n ? v[(int) ((n - 1) * p)] : 0;
+}
+
+static void usage() {
+    fprintf(stderr, "%s", "Usage: latency [OPTION]... -- COMMAND [ARG]...\n");
+    fprintf(stderr, "%s", "Measure keypress to output latency of COMMAND under a pseudo-terminal.\n\n");
+    fprintf(stderr, "%s", "  -k SCRIPT   keys to send (default next*10,prev*3,last,first,goto:3,reload,next*5)\n");
+    fprintf(stderr, "%s", "  -o FILE     save the raw terminal output to FILE\n");
+    fprintf(stderr, "%s", "  -q MS       quiet time ending a frame (default 200)\n");
+    fprintf(stderr, "%s", "  -w MS       timeout waiting for a frame (default 2000)\n");
+    fprintf(stderr, "%s", "  -x COLS     terminal columns (default 120)\n");
+    fprintf(stderr, "%s", "  -y LINES    terminal lines (default 40)\n");
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[]) {
+    const char *script = "next*10,prev*3,last,first,goto:3,reload,next*5";
+    int quiet = 200, timeout = 2000;
+    struct winsize ws = { 40, 120, 0, 0 };
+    result_t *results = NULL;
+    int nresults = 0, alloc = 0;
+    double *lat, t, start, startup;
+    long bytes, total = 0, startup_bytes;
+    int opt, fd, i, n, rep, status;
+    char *copy, *tok, *save, *star, seq[32];
+    pid_t pid;
+
+    while((opt = getopt(argc, argv, "+k:o:q:w:x:y:h")) != -1) {
+        switch(opt) {
+            case 'k': script = optarg;           break;
+            case 'o':
+                if((dump = fopen(optarg, "w")) == NULL) {
+                    perror(optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'q': quiet = atoi(optarg);      break;
+            case 'w': timeout = atoi(optarg);    break;
+            case 'x': ws.ws_col = atoi(optarg);  break;
+            case 'y': ws.ws_row = atoi(optarg);  break;
+            default : usage();                   break;
+        }
+    }
+    if(optind >= argc)
+        usage();
+
+    start = now();
+    pid = forkpty(&fd, NULL, NULL, &ws);
+    if(pid < 0) {
+        perror("forkpty");
+        return EXIT_FAILURE;
+    }
+    if(pid == 0) {
+        setenv("TERM", "xterm", 0);
+        // decks are UTF-8, the C locale would stop reading at the first
+        // multi-byte char
+        if(!getenv("LC_ALL") && !getenv("LC_CTYPE") && !getenv("LANG"))
+            setenv("LC_ALL", "C.UTF-8", 1);
+        execvp(argv[optind], &argv[optind]);
+        perror(argv[optind]);
+        _exit(127);
+    }
+
+    // first frame
+    t = drain(fd, timeout * 5, quiet, &startup_bytes);
+    startup = t < 0 ? -1 : t - start;
+
+    copy = strdup(script);
+    for(tok = strtok_r(copy, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        rep = 1;
+        if((star = strchr(tok, '*')) != NULL) {
+            *star = '\0';
+            rep = atoi(star + 1);
+        }
+
+        // translate key name to bytes
+        if(!strncmp(tok, "goto:", 5)) {
+            snprintf(seq, sizeof(seq), "%s", tok + 5);
+        } else {
+            for(i = 0; keys[i].name && strcmp(keys[i].name, tok); i++);
+            snprintf(seq, sizeof(seq), "%s", keys[i].name ? keys[i].seq : tok);
+        }
+
+        while(rep-- > 0) {
+            if(nresults == alloc) {
+                alloc = alloc ? alloc * 2 : 32;
+                results = realloc(results, alloc * sizeof(result_t));
+            }
+
+            // discard late output of the previous frame
+            drain(fd, 0, quiet, &bytes);
+
+            t = now();
+            if(write(fd, seq, strlen(seq)) < 0)
+                break;
+            start = drain(fd, timeout, quiet, &bytes);
+
+            snprintf(results[nresults].name, sizeof(results[nresults].name), "%s", tok);
+            results[nresults].latency = start < 0 ? -1 : start - t;
+            results[nresults].bytes = bytes;
+            total += bytes;
+            nresults++;
+        }
+    }
+    free(copy);
+
+    // quit and reap the child
+    if(write(fd, "q", 1) < 0 || drain(fd, 500, quiet, &bytes) < 0 || waitpid(pid, &status, WNOHANG) == 0) {
+        kill(pid, SIGTERM);
+    }
+    waitpid(pid, &status, 0);
+
+    printf("{\n  \"command\": \"");
+    for(i = optind; i < argc; i++)
+        printf("%s%s", argv[i], i < argc - 1 ? " " : "");
+    printf("\",\n  \"lines\": %d, \"cols\": %d, \"quiet\": %d,\n", ws.ws_row, ws.ws_col, quiet);
+    printf("  \"startup\": { \"latency\": %.3f, \"bytes\": %ld },\n", startup, startup_bytes);
+    printf("  \"keys\": [\n");
+    for(i = 0; i < nresults; i++)
+        printf("    { \"key\": \"%s\", \"latency\": %.3f, \"bytes\": %ld }%s\n",
+               results[i].name, results[i].latency, results[i].bytes,
+               i < nresults - 1 ? "," : "");
+    printf("  ],\n");
+
+    lat = malloc((nresults + 1) * sizeof(double));
+    for(i = n = 0; i < nresults; i++)
+        if(results[i].latency >= 0)
+            lat[n++] = results[i].latency;
+    qsort(lat, n, sizeof(double), cmp_double);
+
+    printf("  \"latency\": { \"n\": %d, \"median\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f },\n",
+           n, percentile(lat, n, 0.5), percentile(lat, n, 0.9),
+           percentile(lat, n, 0.99), n ? lat[n - 1] : 0);
+    printf("  \"bytes\": { \"total\": %ld, \"per_key\": %.1f }\n}\n",
+           total, nresults ? (double) total / nresults : 0);
+
+    free(lat);
+    free(results);
+    if(dump)
+        fclose(dump);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,273 @@
+/*
+ * Benchmark of UTF-8 decoding, apart from the rest of the parser.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Each FILE is decoded RUNS times into wide chars, dropping chars that
+ * are neither printable nor space, as the parser does:
+ *
+ *   fgetwc       one char at a time from a wide-oriented stream, the
+ *                way the parser used to read its input
+ *   mbrtowc      one char at a time from memory with the C library
+ *   utf8_decode  the whole file from memory, 7-bit ASCII a block at a time
+ *
+ * Besides the files given, a pure ASCII buffer and a buffer of
+ * three byte chars of the same size as the first file are decoded, to
+ * show the best and the worst case.
+ *
+ * Results are printed as JSON on STDOUT, times in microseconds and
+ * throughput in MB/s of input.
+ *
+ */
+
+#include <getopt.h>
+#include <locale.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wchar.h>
+#include <wctype.h>
+
+#include "utf8.h"
+
+typedef struct _samples_t {
+    double *value;
+    size_t size;
+    size_t alloc;
+} samples_t;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void sample_add(samples_t *s, double v) {
+    if(s->size == s->alloc) {
+        s->alloc = s->alloc ? s->alloc * 2 : 64;
+        if((s->value = realloc(s->value, s->alloc * sizeof(double))) == NULL) {
+            fprintf(stderr, "%s\n", "sample_add() failed to reallocate memory.");
+            exit(EXIT_FAILURE);
+        }
+    }
+    s->value[s->size++] = v;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+static void sample_report(const char *name, samples_t *s, size_t bytes, int last) {
+    double median;
+
+    qsort(s->value, s->size, sizeof(double), cmp_double);
+    median = s->size ? s->value[s->size / 2] : 0;
+
+    printf("      \"%s\": { \"n\": %zu, \"median\": %.3f, \"min\": %.3f, \"max\": %.3f, \"mb_per_s\": %.1f }%s\n",
+           name, s->size, median,
+           s->size ? s->value[0] : 0,
+           s->size ? s->value[s->size - 1] : 0,
+           median > 0 ? bytes / median : 0,
+           last ? "" : ",");
+
+    free(s->value);
+    s->value = NULL;
+    s->size = s->alloc = 0;
+}
+
+static size_t decode_fgetwc(const char *file, wchar_t *out) {
+    FILE *input = fopen(file, "r");
+    wchar_t *start = out;
+    wint_t c;
+
+    if(!input) {
+        perror(file);
+        exit(EXIT_FAILURE);
+    }
+    while((c = fgetwc(input)) != WEOF) {
+        if(iswprint(c) || iswspace(c))
+            *out++ = c;
+    }
+    fclose(input);
+
+    return out - start;
+}
+
+static size_t decode_mbrtowc(const char *s, size_t n, wchar_t *out) {
+    mbstate_t state = { 0 };
+    wchar_t *start = out;
+    wchar_t c;
+    size_t len;
+
+    while(n > 0) {
+        len = mbrtowc(&c, s, n, &state);
+        if(len == (size_t) -1 || len == (size_t) -2) {
+            memset(&state, 0, sizeof(state));
+            len = 1;
+        } else if(len == 0) {
+            len = 1;
+        } else if(iswprint(c) || iswspace(c)) {
+            *out++ = c;
+        }
+        s += len;
+        n -= len;
+    }
+
+    return out - start;
+}
+
+static size_t decode_utf8(const char *s, size_t n, wchar_t *out) {
+    wchar_t *start = out;
+    wchar_t *in, *end;
+    size_t done;
+
+    while(n > 0) {
+        end = out + utf8_decode(s, n, out, UTF8_PRINTABLE, &done);
+
+        // drop what is neither printable nor space
+        for(in = out; in < end; in++) {
+            if(*in)
+                *out++ = *in;
+        }
+
+        done += utf8_invalid(&s[done], n - done);
+        s += done;
+        n -= done;
+    }
+
+    return out - start;
+}
+
+static void bench(const char *name, const char *file, const char *buf, size_t bytes,
+                  int runs, int last) {
+    samples_t fgetwc_s = { 0 }, mbrtowc_s = { 0 }, utf8_s = { 0 };
+    wchar_t *out;
+    size_t a = 0, b = 0, c = 0;
+    double t;
+    int r;
+
+    if((out = malloc((bytes + 1) * sizeof(wchar_t))) == NULL) {
+        fprintf(stderr, "%s\n", "bench() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+
+    for(r = 0; r < runs; r++) {
+        if(file) {
+            t = now();
+            a = decode_fgetwc(file, out);
+            sample_add(&fgetwc_s, now() - t);
+        }
+
+        t = now();
+        b = decode_mbrtowc(buf, bytes, out);
+        sample_add(&mbrtowc_s, now() - t);
+
+        t = now();
+        c = decode_utf8(buf, bytes, out);
+        sample_add(&utf8_s, now() - t);
+    }
+
+    // all of them have to agree on valid input
+    if((file && a != b) || b != c)
+        fprintf(stderr, "%s: decoded %zu, %zu and %zu chars\n", name, a, b, c);
+
+    printf("    \"%s\": {\n", name);
+    printf("      \"bytes\": %zu, \"chars\": %zu,\n", bytes, c);
+    if(file)
+        sample_report("fgetwc", &fgetwc_s, bytes, 0);
+    sample_report("mbrtowc", &mbrtowc_s, bytes, 0);
+    sample_report("utf8_decode", &utf8_s, bytes, 1);
+    printf("    }%s\n", last ? "" : ",");
+
+    free(out);
+}
+
+static char *slurp(const char *file, size_t *bytes) {
+    FILE *input = fopen(file, "r");
+    char *buf;
+    long size;
+
+    if(!input) {
+        perror(file);
+        exit(EXIT_FAILURE);
+    }
+    fseek(input, 0, SEEK_END);
+    size = ftell(input);
+    rewind(input);
+
+    if((buf = malloc(size + 1)) == NULL || fread(buf, 1, size, input) != (size_t) size) {
+        fprintf(stderr, "%s: failed to read\n", file);
+        exit(EXIT_FAILURE);
+    }
+    fclose(input);
+
+    *bytes = size;
+    return buf;
+}
+
+static void usage() {
+    fprintf(stderr, "%s", "Usage: utf8 [OPTION]... FILE...\n");
+    fprintf(stderr, "%s", "Time UTF-8 decoding of files, report JSON on STDOUT.\n\n");
+    fprintf(stderr, "%s", "  -r RUNS     number of runs per file (default 10)\n");
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[]) {
+    int runs = 10;
+    int opt, i;
+    size_t bytes, size;
+    char *buf;
+
+    while((opt = getopt(argc, argv, "r:h")) != -1) {
+        switch(opt) {
+            case 'r': runs = atoi(optarg); break;
+            default : usage();             break;
+        }
+    }
+    if(optind >= argc || runs < 1)
+        usage();
+
+    if(!setlocale(LC_CTYPE, "") || !strcmp(setlocale(LC_CTYPE, NULL), "C"))
+        setlocale(LC_CTYPE, "C.UTF-8");
+
+    printf("{\n  \"runs\": %d,\n  \"files\": {\n", runs);
+    for(i = optind; i < argc; i++) {
+        buf = slurp(argv[i], &bytes);
+        bench(argv[i], argv[i], buf, bytes, runs, 0);
+        free(buf);
+    }
+
+    // best and worst case of the same size as the first file
+    buf = slurp(argv[optind], &size);
+    for(bytes = 0; bytes < size; bytes++)
+        buf[bytes] = bytes % 64 == 63 ? '\n' : 'a' + bytes % 26;
+    bench("ascii", NULL, buf, size, runs, 0);
+
+    // U+20AC, the euro sign
+    size -= size % 3;
+    for(bytes = 0; bytes < size; bytes += 3)
+        memcpy(&buf[bytes], "\xe2\x82\xac", 3);
+    bench("three-byte", NULL, buf, size, runs, 1);
+    free(buf);
+
+    printf("  }\n}\n");
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,131 @@
+/*
+ * Standalone driver running a fuzz target on files, for builds without
+ * libFuzzer, afl-fuzz and regression checks.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Each argument is an input file, or a directory whose files are run in
+ * sorted order. Without arguments one input is read from STDIN, which is
+ * what afl-fuzz expects.
+ *
+ */
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "fuzz.h"
+
+static uint8_t *read_all(FILE *input, size_t *size) {
+    uint8_t *data = NULL;
+    size_t alloc = 0, n;
+
+    *size = 0;
+    do {
+        if(*size == alloc) {
+            alloc = alloc ? alloc * 2 : 4096;
+            if((data = realloc(data, alloc)) == NULL) {
+                fprintf(stderr, "%s\n", "read_all() failed to reallocate memory.");
+                exit(EXIT_FAILURE);
+            }
+        }
+        n = fread(data + *size, 1, alloc - *size, input);
+        *size += n;
+    } while(n > 0);
+
+    return data;
+}
+
+static void run_file(const char *path) {
+    uint8_t *data;
+    size_t size;
+    FILE *input;
+
+    if((input = fopen(path, "rb")) == NULL) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+    data = read_all(input, &size);
+    fclose(input);
+
+    fprintf(stderr, "%s (%zu bytes)\n", path, size);
+    LLVMFuzzerTestOneInput(data, size);
+    free(data);
+}
+
+static int cmp_name(const void *a, const void *b) {
+    return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+static void run_path(const char *path) {
+    struct dirent *entry;
+    struct stat st;
+    char **names = NULL, *name;
+    size_t count = 0, i;
+    DIR *dir;
+
+    if(stat(path, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        run_file(path);
+        return;
+    }
+
+    if((dir = opendir(path)) == NULL) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+    while((entry = readdir(dir)) != NULL) {
+        if(entry->d_name[0] == '.')
+            continue;
+        names = realloc(names, (count + 1) * sizeof(char *));
+        name = malloc(strlen(path) + strlen(entry->d_name) + 2);
+        if(!names || !name) {
+            fprintf(stderr, "%s\n", "run_path() failed to allocate memory.");
+            exit(EXIT_FAILURE);
+        }
+        sprintf(name, "%s/%s", path, entry->d_name);
+        names[count++] = name;
+    }
+    closedir(dir);
+
+    qsort(names, count, sizeof(char *), cmp_name);
+    for(i = 0; i < count; i++) {
+        run_path(names[i]);
+        free(names[i]);
+    }
+    free(names);
+}
+
+int main(int argc, char *argv[]) {
+    uint8_t *data;
+    size_t size;
+    int i;
+
+    if(argc < 2) {
+        data = read_all(stdin, &size);
+        LLVMFuzzerTestOneInput(data, size);
+        free(data);
+        return EXIT_SUCCESS;
+    }
+
+    for(i = 1; i < argc; i++)
+        run_path(argv[i]);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,105 @@
+/*
+ * Shared helpers of the fuzz targets.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <locale.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fuzz.h"
+
+static struct timespec start;
+static double base = -1, budget;
+
+static double env_number(const char *name, double fallback) {
+    const char *env = getenv(name);
+    return env && *env ? atof(env) : fallback;
+}
+
+void fuzz_setup(void) {
+    if(base >= 0)
+        return;
+
+    // decks are read as UTF-8, whatever the environment says
+    if(!setlocale(LC_ALL, "C.UTF-8") && !setlocale(LC_ALL, "en_US.UTF-8"))
+        setlocale(LC_ALL, "");
+
+    // notes are parsed as with a presenter view
+    markdown_notes(true);
+
+    base = env_number("MDP_FUZZ_BASE", FUZZ_BASE);
+    budget = env_number("MDP_FUZZ_BUDGET", FUZZ_BUDGET);
+}
+
+static FILE *fuzz_open(const uint8_t *data, size_t size) {
+    FILE *input;
+    size_t done;
+    ssize_t n;
+
+    // memory streams do not support wide char input, use a real file,
+    // written to without stdio so the stream has no byte orientation
+    if((input = tmpfile()) == NULL) {
+        perror("tmpfile");
+        exit(EXIT_FAILURE);
+    }
+    for(done = 0; done < size; done += n) {
+        if((n = write(fileno(input), data + done, size - done)) < 0) {
+            perror("write");
+            exit(EXIT_FAILURE);
+        }
+    }
+    rewind(input);
+
+    return input;
+}
+
+deck_t *fuzz_load(const uint8_t *data, size_t size) {
+    FILE *input = fuzz_open(data, size);
+    deck_t *deck;
+
+    deck = markdown_load(input, 0);
+    fclose(input);
+    return deck;
+}
+
+deck_t *fuzz_index(const uint8_t *data, size_t size) {
+    return markdown_index(fuzz_open(data, size), 0);
+}
+
+void fuzz_budget_start(void) {
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+}
+
+void fuzz_budget_check(const char *target, size_t size) {
+    struct timespec end;
+    double used, limit;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+    used = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+    limit = base + budget * size / 1e6;
+
+    if(used > limit) {
+        fprintf(stderr, "%s: %zu bytes took %.1f ms, budget is %.1f ms\n",
+                target, size, used, limit);
+        abort();
+    }
+}
@@ -0,0 +1,53 @@
+#if !defined( FUZZ_H )
+#define FUZZ_H
+
+/*
+ * Shared helpers of the fuzz targets.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * function: fuzz_setup to select a UTF-8 locale, called once per process
+ * function: fuzz_load to parse a deck from a buffer
+ * function: fuzz_index to load a deck from a buffer lazily
+ * function: fuzz_budget_start, fuzz_budget_check to abort if an input
+ *           takes longer than its budget, so algorithmic blowups are
+ *           reported like crashes
+ *
+ * The budget is MDP_FUZZ_BASE milliseconds plus MDP_FUZZ_BUDGET
+ * nanoseconds per input byte of CPU time, read from the environment.
+ *
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "parser.h"
+
+#define FUZZ_BASE   20    // ms per input
+#define FUZZ_BUDGET 5000  // ns per byte
+
+void fuzz_setup(void);
+deck_t *fuzz_load(const uint8_t *data, size_t size);
+deck_t *fuzz_index(const uint8_t *data, size_t size);
+void fuzz_budget_start(void);
+void fuzz_budget_check(const char *target, size_t size);
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+#endif // !defined( FUZZ_H )
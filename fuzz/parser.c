@@ -0,0 +1,110 @@
+/*
+ * Fuzz target for markdown_load, the markdown parser.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h> // memcmp
+#include <wchar.h>  // wmemcmp
+
+#include "fuzz.h"
+
+// the lines of two packed slides, text included, are the same
+static bool same_line(const slide_t *slide, const slide_t *other, int ln) {
+    const pack_t *p = slide->pack, *q = other->pack;
+    int i = slide->first + ln, j = other->first + ln;
+
+    return p->bits[i] == q->bits[j] && p->length[i] == q->length[j] && p->size[i] == q->size[j] &&
+           (p->size[i] < 0 || !memcmp(&p->text[p->start[i]], &q->text[q->start[j]], p->size[i]));
+}
+
+static bool same_text(const cstring_t *a, const cstring_t *b) {
+    if(!a || !b)
+        return a == b;
+
+    return a->size == b->size && !wmemcmp(a->value, b->value, a->size);
+}
+
+static void fuzz_compare(deck_t *deck, slide_t *slide, deck_t *lazy, slide_t *other) {
+    line_t *h, *g;
+    int ln;
+
+    markdown_parse(lazy, other);
+
+    if(other->lines != slide->lines || lazy->headers != deck->headers) {
+        fprintf(stderr, "parser: lazy slide has %d lines, %d headers instead of %d, %d\n",
+                other->lines, lazy->headers, slide->lines, deck->headers);
+        abort();
+    }
+
+    for(ln = 0; ln < slide->lines; ln++) {
+        if(!same_line(slide, other, ln)) {
+            fprintf(stderr, "parser: line %d of a lazy slide differs\n", ln);
+            abort();
+        }
+    }
+
+    if(!same_text(slide->notes, other->notes)) {
+        fprintf(stderr, "%s\n", "parser: notes of a lazy slide differ");
+        abort();
+    }
+
+    for(h = deck->header, g = lazy->header; h && g; h = h->next, g = g->next) {
+        if(h->bits != g->bits || h->length != g->length || !same_text(h->text, g->text)) {
+            fprintf(stderr, "%s\n", "parser: header of a lazy deck differs");
+            abort();
+        }
+    }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    deck_t *deck, *lazy;
+    slide_t *slide, *other;
+
+    fuzz_setup();
+    fuzz_budget_start();
+
+    deck = fuzz_load(data, size);
+
+    // a lazily loaded deck has to end up with the same slides, parse them
+    // last to first so none depends on its predecessor, then again first
+    // to last, as the smallest cache has unloaded all but two of them
+    lazy = fuzz_index(data, size);
+    markdown_cache(lazy, 1);
+    markdown_scan(lazy, size + 1);
+
+    if(lazy->slides != deck->slides) {
+        fprintf(stderr, "parser: lazy deck has %d slides instead of %d\n",
+                lazy->slides, deck->slides);
+        abort();
+    }
+
+    for(slide = deck->slide; slide->next; slide = slide->next);
+    for(other = lazy->slide; other->next; other = other->next);
+    for(; slide; slide = slide->prev, other = other->prev)
+        fuzz_compare(deck, slide, lazy, other);
+    for(slide = deck->slide, other = lazy->slide; slide; slide = slide->next, other = other->next)
+        fuzz_compare(deck, slide, lazy, other);
+
+    free_deck(lazy);
+    free_deck(deck);
+
+    fuzz_budget_check("parser", size);
+    return 0;
+}
@@ -0,0 +1,81 @@
+/*
+ * Fuzz target for layout and inline rendering into the headless backend.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Every slide is drawn fully revealed, as the viewer would show it on a
+ * terminal just large enough for the slide. Independent of the parser bits, the text of
+ * every line is passed to inline_display as well.
+ *
+ */
+
+#include <limits.h>
+
+#include "fuzz.h"
+#include "viewer.h"
+
+#define FUZZ_COLS 80
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    static render_t *render = NULL;
+    int max_lines, max_cols, max_lines_slide;
+    int sc = 1, stop = 0, colors;
+    deck_t *deck;
+    slide_t *slide;
+    cstring_t *text = cstring_init();
+    int ln;
+
+    fuzz_setup();
+    if(!render) {
+        render = render_headless_init(24, FUZZ_COLS);
+        setup_list_strings();
+    }
+    fuzz_budget_start();
+
+    deck = fuzz_load(data, size);
+    colors = setup_colors(render);
+
+    // the viewer refuses decks with words wider than the terminal
+    if(layout_deck(deck, FUZZ_COLS, &max_lines, &max_cols, &max_lines_slide) == 0) {
+        for(slide = deck->slide; slide; slide = slide->next, sc++) {
+            // size the screen per slide, one huge slide must not make
+            // drawing all others expensive
+            render->lines = slide->lines_consumed + 3;
+            slide->stop = INT_MAX - 1;
+            display_slide(render, deck, slide, sc, max_cols, 1, colors, &stop);
+            (render->flush)(render);
+        }
+    }
+
+    render->lines = 24;
+    (render->erase)(render);
+    for(slide = deck->slide; slide; slide = slide->next) {
+        for(ln = slide->first; ln < slide->first + slide->lines; ln++) {
+            if(pack_decode(slide->pack, ln, text)) {
+                (render->move)(render, 0, 0);
+                inline_display(render, text->value, colors);
+            }
+        }
+    }
+
+    (text->delete)(text);
+    free_deck(deck);
+
+    fuzz_budget_check("render", size);
+    return 0;
+}
@@ -36,7 +36,7 @@ static const char *list_head1 = " +- ";
 static const char *list_head2 = " +- ";
 static const char *list_head3 = " +- ";
 
-#define GOTO_SLIDE_DELAY 5  // tenths of seconds
+#define GOTO_SLIDE_DELAY 5  // tenths of seconds to wait for a key after digits
 
 // colors - you can only set in 8-bit color mode
 //
@@ -90,6 +90,10 @@ static const int last_slide_binding[] = {
     KEY_END,
     0
 };
+static const int goto_binding[] = {
+    ':',
+    0
+};
 static const int reload_binding[] = {
     'r',
     0
@@ -98,5 +102,29 @@ static const int quit_binding[] = {
     'q',
     0
 };
+static const int search_binding[] = {
+    '/',
+    0
+};
+static const int search_next_binding[] = {
+    'n',
+    0
+};
+static const int search_prev_binding[] = {
+    'N',
+    0
+};
+static const int toc_binding[] = {
+    't',
+    0
+};
+static const int overview_binding[] = {
+    'o',
+    0
+};
+static const int pager_binding[] = {
+    'p',
+    0
+};
 
 #endif // !defined( CONFIG_H )
@@ -26,6 +26,8 @@
  * function: cstring_init to initialize struct of type cstring_t
  * function: cstring_t->expand to add one character to the struct
  * function: cstring_t->expand_arr to add a string to the struct
+ * function: cstring_t->expand_utf8 to add n bytes of UTF-8 encoded text,
+ *           independent of the locale, invalid bytes are skipped
  * function: cstring_t->strip to remove a substring
  * function: cstring_t->reset to clear and reuse the struct
  * function: cstring_t->delete to free the allocated memory
@@ -37,8 +39,8 @@
  *
  */
 
-// The amount of memory allocated from heap when string expansion hits the
-// allocated memory limit
+// The amount of chars allocated from heap on first expansion, the
+// allocation is doubled whenever the limit is hit
 #define REALLOC_ADD 10
 
 typedef struct _cstring_t {
@@ -47,6 +49,7 @@ typedef struct _cstring_t {
     size_t alloc;
     void (*expand)(struct _cstring_t *self, wchar_t x);
     void (*expand_arr)(struct _cstring_t *self, wchar_t *x);
+    void (*expand_utf8)(struct _cstring_t *self, const char *x, size_t n);
     void (*strip)(struct _cstring_t *self, int pos, int len);
     void (*reset)(struct _cstring_t *self);
     void (*delete)(struct _cstring_t *self);
@@ -55,6 +58,7 @@ typedef struct _cstring_t {
 cstring_t *cstring_init();
 void cstring_expand(cstring_t *self, wchar_t x);
 void cstring_expand_arr(cstring_t *self, wchar_t *x);
+void cstring_expand_utf8(cstring_t *self, const char *x, size_t n);
 void cstring_strip(cstring_t *self, int pos, int len);
 void cstring_reset(cstring_t *self);
 void cstring_delete(cstring_t *self);
@@ -0,0 +1,92 @@
+#if !defined( DISPLAY_H )
+#define DISPLAY_H
+
+/*
+ * Display lists, the compiled output of the lines of a slide.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * struct: display_run_t chars of one attribute at a position
+ * struct: display_t the runs of the lines of a slide compiled so far
+ *
+ * function: display_init to allocate an empty display list
+ * function: display_prepare to make sure the list was compiled for the
+ *           given geometry, it is emptied otherwise
+ * function: display_record to compile the next line, returns a backend
+ *           to draw the line into at row 0, which may span the given rows;
+ *           it supports move, addnwstr, addstr, attron, attroff and getx
+ *           only; the first line starts with the attribute attr, any other
+ *           with the one the line before left enabled
+ * function: display_commit to complete the line drawn, the links added
+ *           to the url list from index urls on belong to the line
+ * function: display_replay to draw line ln at row y, with links the links of
+ *           the line are added to the url list again, which is needed
+ *           unless the line was just compiled; the attribute the line left
+ *           enabled is enabled afterwards
+ * function: display_bytes to get the memory held by the list
+ * function: display_delete to free the allocated memory
+ *
+ * Lines are compiled by drawing them into a grid of cells shared by all
+ * display lists, runs are made of the cells drawn only, so lines drawn
+ * later overwrite the cells of earlier lines just as they would when
+ * drawn directly.
+ *
+ */
+
+#include <wchar.h>
+
+#include "common.h"
+#include "render.h"
+
+typedef struct _display_run_t {
+    int dy;            // row relative to the first row of the line
+    int x;
+    int attr;
+    int start;         // first char in text
+    int n;             // chars
+} display_run_t;
+
+typedef struct _display_t {
+    int cols;          // geometry the lines were compiled for
+    int max_cols;
+    int colors;
+    int lines;         // lines compiled
+    int max_lines;
+    int *line_run;     // first run of each line, and the end of the last
+    int *line_url;     // first link of each line, and the end of the last
+    int *line_attr;    // attribute left enabled by each line
+    display_run_t *run;
+    int runs;
+    int max_runs;
+    int *url;          // start and length of name and target of each link
+    int urls;
+    int max_urls;
+    wchar_t *text;     // chars of the runs and links
+    int chars;
+    int max_chars;
+} display_t;
+
+display_t *display_init(void);
+void display_prepare(display_t *d, int cols, int max_cols, int colors);
+render_t *display_record(display_t *d, int rows, int attr);
+void display_commit(display_t *d, int urls);
+void display_replay(display_t *d, render_t *render, int ln, int y, bool links);
+size_t display_bytes(const display_t *d);
+void display_delete(display_t *d);
+
+#endif // !defined( DISPLAY_H )
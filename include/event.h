@@ -0,0 +1,120 @@
+#if !defined( EVENT_H )
+#define EVENT_H
+
+/*
+ * Event loop waiting for keys, file descriptors and timers.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * struct: event_source_t a file descriptor watched for input
+ * struct: event_timer_t a callback due at a point in time
+ * struct: event_t the sources, timers and idle hook of a loop
+ *
+ * function: event_init to allocate a loop without sources
+ * function: event_watch to call ready whenever fd is readable, or closed;
+ *           a fd watched already gets the new callback
+ * function: event_unwatch to stop watching fd
+ * function: event_timer to call expired once, ms milliseconds from now,
+ *           returns an id to cancel it with
+ * function: event_cancel to drop a timer which has not expired yet
+ * function: event_idle to run work while the next event_key call has no
+ *           key to return, the hook is called repeatedly until it returns
+ *           false and is dropped once event_key returns
+ * function: event_wake to make the event_key call waiting, or the next one,
+ *           return EVENT_WAKE once the callback being served returns
+ * function: event_push to queue a key read from another terminal, queued
+ *           keys are returned by event_key first; dropped if EVENT_KEYS
+ *           are queued already
+ * function: event_key to wait for a key of the backend for up to timeout
+ *           milliseconds (< 0 blocks), sources and timers are served while
+ *           waiting; returns ERR on timeout or if the input is closed, and
+ *           EVENT_WAKE if a callback asked for it
+ * function: event_delete to free the allocated memory
+ *
+ * The loop polls the input of the backend together with the sources,
+ * the earliest timer sets the poll timeout. A backend without an input
+ * descriptor (render_t->input < 0) blocks in render_t->getkey instead,
+ * sources and timers are not served then. Callbacks may add or remove
+ * sources and timers.
+ *
+ */
+
+#include <poll.h>
+
+#if defined( WIN32 )
+#include <curses.h>
+#else
+#include <ncurses.h> // KEY_MAX
+#endif
+
+#include "common.h"
+#include "render.h"
+
+// returned by event_key instead of a key, no key code is as high
+#define EVENT_WAKE (KEY_MAX + 1)
+
+#define EVENT_KEYS 32 // keys queued at most
+
+struct _event_t;
+
+typedef void (*event_ready_t)(struct _event_t *ev, int fd, void *data);
+typedef void (*event_expired_t)(struct _event_t *ev, void *data);
+typedef bool (*event_idle_t)(struct _event_t *ev, void *data);
+
+typedef struct _event_source_t {
+    int fd;
+    event_ready_t ready;
+    void *data;
+} event_source_t;
+
+typedef struct _event_timer_t {
+    int id;
+    long long due;     // milliseconds of the monotonic clock
+    event_expired_t expired;
+    void *data;
+} event_timer_t;
+
+typedef struct _event_t {
+    event_source_t *source;
+    int sources;
+    int max_sources;
+    event_timer_t *timer; // ordered by due
+    int timers;
+    int max_timers;
+    int next_id;
+    event_idle_t idle; // work for the next key, NULL for none
+    void *idle_data;
+    bool wake;          // return EVENT_WAKE instead of waiting on
+    int key[EVENT_KEYS]; // keys pushed, oldest first
+    int keys;
+    struct pollfd *pfd; // input of the backend and the sources
+    int max_pfd;
+} event_t;
+
+event_t *event_init(void);
+void event_watch(event_t *ev, int fd, event_ready_t ready, void *data);
+void event_unwatch(event_t *ev, int fd);
+int event_timer(event_t *ev, int ms, event_expired_t expired, void *data);
+void event_cancel(event_t *ev, int id);
+void event_idle(event_t *ev, event_idle_t idle, void *data);
+void event_wake(event_t *ev);
+void event_push(event_t *ev, int key);
+int event_key(event_t *ev, render_t *render, int timeout);
+void event_delete(event_t *ev);
+
+#endif // !defined( EVENT_H )
@@ -0,0 +1,81 @@
+#if !defined( FOLLOW_H )
+#define FOLLOW_H
+
+/*
+ * Following the slides another viewer shows.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * enum: follow_step_t what to do about the state of the leader
+ * struct: follow_t the connection to the leader and its state
+ *
+ * function: follow_init to follow the viewer listening on the remote
+ *           control socket at path, served by the event loop ev; it is
+ *           connected again whenever the connection is lost or fails,
+ *           connecting never blocks
+ * function: follow_pending to tell if the leader shows a state which was
+ *           not taken yet
+ * function: follow_take to take the state of the leader; FOLLOW_RELOAD if
+ *           the leader shows another deck than the one with hash, which
+ *           is returned once per deck of the leader and keeps the state
+ *           pending, FOLLOW_SHOW with the slide and stop to show otherwise
+ * function: follow_delete to close the connection and free the allocated
+ *           memory
+ *
+ * The leader sends its state once the follower connects and whenever it
+ * changes afterwards, see remote.h. A state equal to the one taken last is
+ * not pending, so the follower draws only if the leader moved on.
+ *
+ */
+
+#include <stdint.h>
+
+#include "common.h"
+#include "event.h"
+#include "remote.h"
+
+#define FOLLOW_RETRY 500 // milliseconds to wait before connecting again
+
+typedef enum {
+    FOLLOW_NONE = 0,
+    FOLLOW_SHOW,
+    FOLLOW_RELOAD
+} follow_step_t;
+
+typedef struct _follow_t {
+    event_t *ev;
+    char *path;
+    int fd;            // connection to the leader, -1 while there is none
+    int timer;         // id of the timer to connect again, 0 for none
+    char line[REMOTE_LINE];
+    int len;           // chars of the state read so far
+    int sc;            // state of the leader
+    int stop;
+    uint64_t hash;
+    int taken_sc;      // state taken last, 0 if none was yet
+    int taken_stop;
+    uint64_t taken_hash;
+    uint64_t reloaded; // deck of the leader a reload was asked for
+} follow_t;
+
+follow_t *follow_init(event_t *ev, const char *path);
+bool follow_pending(const follow_t *f);
+follow_step_t follow_take(follow_t *f, uint64_t hash, int *sc, int *stop);
+void follow_delete(follow_t *f);
+
+#endif // !defined( FOLLOW_H )
@@ -0,0 +1,83 @@
+#if !defined( FRAME_H )
+#define FRAME_H
+
+/*
+ * Cache of slides rendered into cell buffers.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * struct: frame_key_t everything a rendered slide depends on
+ * struct: frame_t the cells of a rendered slide, kept in a LRU list
+ * struct: frames_t the cache, limited to a budget of bytes
+ *
+ * function: frames_init to allocate an empty cache of at most budget bytes
+ * function: frames_find to look up a frame without using it
+ * function: frames_get to look up a frame and mark it as most recently
+ *           used, hits and misses are counted
+ * function: frames_add to copy the cells of a rendered slide into the
+ *           cache, least recently used frames are dropped until the budget
+ *           is met; ahead marks frames rendered before they were asked for
+ * function: frames_clear to drop all frames, e.g. for another deck
+ * function: frames_stats to print the cache counters on STDERR
+ * function: frames_delete to free the allocated memory
+ *
+ */
+
+#include <stddef.h>
+
+#include "common.h"
+#include "grid.h"
+
+typedef struct _frame_key_t {
+    int slide;         // slide number
+    int stop;          // stops revealed
+    int lines;         // geometry of the screen
+    int cols;
+    int max_cols;      // width the slide is centered for
+    int slides;        // total in the footer
+    bool more;         // the footer shows that more slides follow
+} frame_key_t;
+
+typedef struct _frame_t {
+    frame_key_t key;
+    grid_t *grid;
+    int hidden;        // lines not shown, as returned by display_slide
+    int passed;        // stops passed, as stored by display_slide
+    size_t bytes;
+    struct _frame_t *newer;
+    struct _frame_t *older;
+} frame_t;
+
+typedef struct _frames_t {
+    frame_t *recent;
+    frame_t *oldest;
+    size_t budget;
+    size_t resident;
+    unsigned long hits, misses, ahead, evictions;
+} frames_t;
+
+frames_t *frames_init(size_t budget);
+frame_t *frames_find(frames_t *f, const frame_key_t *key);
+frame_t *frames_get(frames_t *f, const frame_key_t *key);
+frame_t *frames_add(frames_t *f, const frame_key_t *key, const grid_t *g,
+                    int hidden, int passed, bool ahead);
+void frames_clear(frames_t *f);
+void frames_stats(frames_t *f);
+void frames_delete(frames_t *f);
+
+#endif // !defined( FRAME_H )
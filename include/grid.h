@@ -0,0 +1,74 @@
+#if !defined( GRID_H )
+#define GRID_H
+
+/*
+ * An in-memory grid of character cells with attributes.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * struct: cell_t a single character cell
+ * struct: grid_t a rectangle of cells with a cursor and current attributes
+ *
+ * function: grid_init to allocate a grid of the given size
+ * function: grid_resize to change the size, the content is cleared
+ * function: grid_erase to blank all cells
+ * function: grid_viewport to restrict drawing to a range of rows,
+ *           coordinates of grid_move are relative to this viewport
+ * function: grid_move to position the cursor
+ * function: grid_addnwstr to print up to n chars (n < 0 prints all),
+ *           wrapping at the right edge like a ncurses window does
+ * function: grid_copy to make dst an exact copy of src
+ * function: grid_delete to free the allocated memory
+ *
+ * The attribute of a cell holds the color pair in the low byte, and
+ * the GA_* flags above.
+ *
+ */
+
+#include <wchar.h>
+
+#define GA_PAIR(a)   ((a) & 0xff)
+#define GA_UNDERLINE 0x100
+#define GA_REVERSE   0x200
+
+typedef struct _cell_t {
+    wchar_t c;  // L'\0' marks the right half of a double width char
+    int attr;
+} cell_t;
+
+typedef struct _grid_t {
+    cell_t *cells;
+    int lines;
+    int cols;
+    int top;    // first row of the viewport
+    int bottom; // first row below the viewport
+    int y;      // cursor row, absolute
+    int x;      // cursor column
+    int attr;   // attribute for new chars
+} grid_t;
+
+grid_t *grid_init(int lines, int cols);
+void grid_resize(grid_t *g, int lines, int cols);
+void grid_erase(grid_t *g);
+void grid_viewport(grid_t *g, int top, int height);
+void grid_move(grid_t *g, int y, int x);
+void grid_addnwstr(grid_t *g, const wchar_t *s, int n);
+void grid_copy(grid_t *dst, const grid_t *src);
+void grid_delete(grid_t *g);
+
+#endif // !defined( GRID_H )
@@ -0,0 +1,43 @@
+#if !defined( INPUT_H )
+#define INPUT_H
+
+/*
+ * Reading decks, plain or compressed with gzip or zstd.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * function: input_open to open a deck file, see input_probe; returns NULL
+ *           and sets errno if it cannot be opened
+ * function: input_probe to recognize gzip and zstd compressed input by its
+ *           magic bytes, it is decompressed while it is read; plain input
+ *           is returned as it is if it can be seeked, a pipe gets the bytes
+ *           read to recognize it put back. The stream is closed with the
+ *           one returned; returns NULL and sets errno to ENOTSUP for a
+ *           format that was not built in
+ *
+ * A compressed stream cannot seek. A truncated or corrupt one fails with
+ * EIO, so no partial deck is shown.
+ *
+ */
+
+#include <stdio.h>
+
+FILE *input_open(const char *file);
+FILE *input_probe(FILE *input);
+
+#endif // !defined( INPUT_H )
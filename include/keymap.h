@@ -0,0 +1,83 @@
+#if !defined( KEYMAP_H )
+#define KEYMAP_H
+
+/*
+ * Table mapping keys to the actions of the viewer.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * enum: action_t what a key does
+ * struct: keymap_t the action of every key code up to KEY_MAX
+ *
+ * function: keymap_init to allocate a keymap without bindings
+ * function: keymap_bind to bind the keys of a 0 terminated list to action
+ * function: keymap_load to read bindings from a file, a line is either
+ *           "map KEY ACTION", "unmap KEY", blank or a # comment; KEY is a
+ *           char, ^X for a control char, a name like up or pagedown, or a
+ *           key code; ACTION is one of none, prev, next, first, last, goto,
+ *           reload, quit, search, search-next, search-prev, toc, overview,
+ *           pager or reveal. Invalid lines are reported on STDERR and skipped;
+ *           returns the amount of them, or -1 if the file cannot be read
+ * function: keymap_action to look up the action of a key, ACTION_NONE for
+ *           keys not bound and ERR
+ * function: keymap_delete to free the allocated memory
+ *
+ * Digits are not looked up, the viewer takes them as a count for the
+ * following key.
+ *
+ */
+
+#if defined( WIN32 )
+#include <curses.h>
+#else
+#include <ncurses.h> // KEY_MAX
+#endif
+
+#include "common.h"
+
+#define KEYMAP_KEYS (KEY_MAX + 1)
+
+typedef enum {
+    ACTION_NONE = 0,
+    ACTION_PREV,
+    ACTION_NEXT,
+    ACTION_FIRST,
+    ACTION_LAST,
+    ACTION_GOTO,
+    ACTION_RELOAD,
+    ACTION_QUIT,
+    ACTION_SEARCH,
+    ACTION_SEARCH_NEXT,
+    ACTION_SEARCH_PREV,
+    ACTION_TOC,
+    ACTION_OVERVIEW,
+    ACTION_PAGER,
+    ACTION_REVEAL
+} action_t;
+
+typedef struct _keymap_t {
+    unsigned char action[KEYMAP_KEYS];
+} keymap_t;
+
+keymap_t *keymap_init(void);
+void keymap_bind(keymap_t *km, const int keys[], action_t action);
+int keymap_load(keymap_t *km, const char *file);
+action_t keymap_action(const keymap_t *km, int c);
+void keymap_delete(keymap_t *km);
+
+#endif // !defined( KEYMAP_H )
@@ -20,6 +20,7 @@
  *
  */
 
+#include "input.h"
 #include "parser.h"
 #include "viewer.h"
 
@@ -24,8 +24,17 @@
  * enum: line_bitmask which enumerates markdown formatting bits
  *
  * struct: deck_t the root object representing a deck of slides
- * struct: slide_t a linked list element of type slide contained in a deck
+ * struct: slide_t a linked list element of type slide contained in a deck,
+ *         with a lazily loaded deck only slides marked as loaded have lines
+ *         and notes, the lines following a line ??? up to the next hr
  * struct: line_t a linked list element of type line contained in a slide
+ *         while it is parsed
+ * struct: pack_t the lines of one or more slides, packed into a single UTF-8
+ *         text buffer and parallel arrays of per line data once parsing is
+ *         done, a slide is the range first..first+lines of its pack
+ * struct: heading_t an entry of the table of contents of a deck
+ * struct: summary_t the title and first rows of text of a slide, as shown
+ *         by the overview
  *
  * function: new_deck to initialize a new deck
  * function: new_slide to initialize a new linked list of type slide
@@ -34,11 +43,38 @@
  * function: next_line to extend a linked list of type line by one element
  * function: free_line to free a line elements memory
  * function: free_deck to free a deck's memory
+ * function: new_pack to initialize an empty pack
+ * function: pack_slide to move the lines of a slide to the end of a pack,
+ *           growing it as needed
+ * function: pack_decode to replace the content of a cstring_t with the text
+ *           of a packed line, returns NULL if the line has no text at all
+ * function: free_pack to free a pack's memory
+ * function: toc_add to append a headline of n chars to the table of
+ *           contents of a deck
+ * function: summary_at to get the summary of a slide, the summaries of
+ *           the deck are extended up to that slide as needed
+ * function: summary_row to append a row of n chars to a summary, it is
+ *           cut off after SUMMARY_COLS chars
+ * function: summary_title to set the title of a summary, unless it has
+ *           one already
+ * function: summary_drop to remove the last row of a summary
  *
  */
 
+#include <stdint.h>
+#include <stdio.h>
+
+#include "common.h"
 #include "cstring.h"
 #include "bitops.h"
+#include "search.h"
+
+// byte offsets of invalid UTF-8 sequences kept for the report
+#define INVALID_OFFSETS 8
+
+// rows of text and chars per row kept for the overview of a slide
+#define SUMMARY_ROWS 4
+#define SUMMARY_COLS 48
 
 enum line_bitmask {
     IS_H1,
@@ -68,20 +104,74 @@ typedef struct _line_t {
     int offset;
 } line_t;
 
+typedef struct _pack_t {
+    char *text;        // UTF-8 text of all lines, each terminated by a NUL
+    size_t *start;     // position of the text of each line in text
+    int *size;         // bytes of each line, -1 if the line has no text
+    int *bits;         // markdown bits of each line
+    int *length;       // display width of each line
+    int lines;         // lines packed
+    int max_lines;     // lines allocated
+    size_t bytes;      // bytes of text packed
+    size_t max_bytes;  // bytes of text allocated
+} pack_t;
+
 typedef struct _slide_t {
-    line_t *line;
+    line_t *line;      // lines while the slide is parsed
+    pack_t *pack;      // lines once the slide is parsed
+    int first;         // first line of the slide in pack
     struct _slide_t *prev;
     struct _slide_t *next;
     int lines;
     int stop;
     int lines_consumed;
+    long offset;       // lazy loading: file offset of the first line
+    int skip;          // lazy loading: lines of the include directive at
+                       // offset belonging to previous slides
+    int length;        // lazy loading: lines of input
+    bool loaded;       // lines are parsed
+    bool stop_last;    // lazy loading: a stop follows the last line
+    struct _slide_t *newer; // slide cache: more recently used slide
+    struct _slide_t *older; // slide cache: less recently used slide
+    size_t bytes;      // slide cache: memory held by the lines
+    struct _display_t *display; // lines compiled for the screen, if shown
+    cstring_t *notes;  // lines following ???, each ended by a newline
 } slide_t;
 
+typedef struct _heading_t {
+    wchar_t *text;     // headline without markup
+    int slide;         // number of the slide holding it
+    int level;         // 1 for H1, 2 for H2
+} heading_t;
+
+typedef struct _summary_t {
+    wchar_t *title;    // first headline, NULL if there is none
+    wchar_t *text;     // first rows, each terminated by a NUL
+    int size;          // chars used in text
+    int rows;
+    int lines;         // lines of text
+    bool pending;      // the last row is the line read last, which may
+                       // turn out to be an underlined headline
+} summary_t;
+
 typedef struct _deck_t {
     line_t *header;
     slide_t *slide;
     int slides;
     int headers;
+    pack_t *pack;      // lines of all slides, unless loaded lazily
+    FILE *input;       // lazy loading: input slides are parsed from
+    void *index;       // lazy loading: state of the slide boundary scan
+    unsigned long invalid; // invalid UTF-8 sequences found in the input
+    long invalid_offset[INVALID_OFFSETS]; // byte offsets of the first ones
+    search_t *search;  // index of the slide text, not owned by the deck
+    uint64_t hash;     // FNV-1a of the input, 0 until it was read completely
+    heading_t *toc;    // headlines in order of the slides
+    int headings;
+    int max_headings;
+    summary_t *summary; // summaries of the slides found so far
+    int summaries;
+    int max_summaries;
 } deck_t;
 
 line_t *new_line();
@@ -91,5 +181,14 @@ slide_t *next_slide(slide_t *prev);
 deck_t *new_deck();
 void free_line(line_t *l);
 void free_deck(deck_t *);
+pack_t *new_pack(void);
+void pack_slide(pack_t *pack, slide_t *slide);
+cstring_t *pack_decode(const pack_t *pack, int i, cstring_t *text);
+void free_pack(pack_t *pack);
+void toc_add(deck_t *deck, int slide, int level, const wchar_t *text, size_t n);
+summary_t *summary_at(deck_t *deck, int slide);
+void summary_row(summary_t *s, const wchar_t *text, size_t n);
+void summary_title(summary_t *s, const wchar_t *text, size_t n);
+void summary_drop(summary_t *s);
 
 #endif // !defined( MARKDOWN_H )
@@ -0,0 +1,68 @@
+#if !defined( PAGER_H )
+#define PAGER_H
+
+/*
+ * Row map of a deck shown as one continuous document.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * struct: pager_t the first row of each slide and line for a width
+ *
+ * function: pager_init to allocate an empty row map
+ * function: pager_measure to count the rows of further slides until row
+ *           is covered (INT_MAX for all of them), the map is started over
+ *           if cols differs from the width it was counted for; slides of
+ *           a lazily loaded deck are scanned and parsed as needed;
+ *           returns the amount of rows known
+ * function: pager_seek to find the slide (counted from 0) and its line
+ *           holding a measured row, ln is -1 for the rule following the
+ *           last line of the slide
+ * function: pager_row to get the first row of line ln of slide n
+ * function: pager_delete to free the allocated memory
+ *
+ * Each line takes as many rows as display_slide gives it, every slide
+ * is followed by a rule of one row. Slides are measured once per width,
+ * seeking a row is a binary search, so drawing a window of the document
+ * only touches the lines in it.
+ *
+ */
+
+#include "common.h"
+#include "markdown.h"
+
+typedef struct _pager_t {
+    int cols;          // width the rows are counted for
+    int max_cols;      // widest line of the slides measured
+    slide_t **slide;   // slides measured
+    int *slide_row;    // first row of each slide, and the end of the last
+    int *slide_line;   // first entry of each slide in line_row
+    int slides;
+    int max_slides;
+    int *line_row;     // first row of each line
+    int lines;
+    int max_lines;
+    bool complete;     // all slides of the deck are measured
+} pager_t;
+
+pager_t *pager_init(void);
+int pager_measure(pager_t *p, deck_t *deck, int cols, int row);
+int pager_seek(pager_t *p, int row, int *ln);
+int pager_row(pager_t *p, int n, int ln);
+void pager_delete(pager_t *p);
+
+#endif // !defined( PAGER_H )
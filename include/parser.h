@@ -24,9 +24,42 @@
  *
  *
  * function: markdown_load is the main function which reads a file handle,
- *           and initializes deck, slides and lines
+ *           and initializes deck, slides, lines and the table of contents
+ *           of H1 and H2 headlines, a line "!include FILE" is replaced
+ *           by the lines of FILE, which are read once and cached by content
+ * function: markdown_index to load a deck lazily, only the slide boundaries
+ *           and headlines are scanned and each slide is parsed on demand,
+ *           the deck takes ownership of the file handle (falls back to
+ *           markdown_load if the input is not seekable)
+ * function: markdown_scan to find the boundaries of up to the given amount
+ *           of further slides, returns false once the input is exhausted
+ * function: markdown_parse to read, analyse and expand the lines of a slide
+ *           of a lazily loaded deck, a no-op if the slide is loaded
+ * function: markdown_cache to limit the memory of the parsed slides of a
+ *           lazily loaded deck, least recently used slides are unloaded
+ *           and parsed again when needed (0 for no limit)
+ * function: markdown_account to count the memory a loaded slide of a lazily
+ *           loaded deck holds now against the limit of markdown_cache,
+ *           e.g. after lines were compiled into its display list
+ * function: markdown_include_base to resolve the include directives of the
+ *           decks loaded next relative to the directory of the given file
+ *           (NULL for the working directory)
+ * function: markdown_include_scope to limit the files the include directives
+ *           of the decks loaded next may name, see include_scope
+ * function: markdown_notes to take the lines following a ??? line as the
+ *           notes of a slide in the decks loaded next, instead of as text
+ *           (off by default)
+ * function: markdown_search to index the slide text of the decks loaded
+ *           next, so their slides can be searched (NULL for no index)
+ * function: markdown_stats to print the fragment and slide cache counters
+ *           on STDERR
+ * function: markdown_invalid to print the byte offsets of the invalid UTF-8
+ *           sequences found so far on STDERR, each of them is shown as
+ *           U+FFFD
  * function: markdown_analyse which is used to identify line wide formatting
  *           rules in given line
+ * function: markdown_analyse_reset to forget lists and code fences carried
+ *           over from previously analysed lines
  * function: markdown_debug to print a report of the generated data structure
  * function: adjust_line_length to calculate line length excluding markup
  * function: is_utf8 detects multi-byte char
@@ -48,9 +81,31 @@
 #define EXPAND_TABS 4
 #define CODE_INDENT 4
 #define UNORDERED_LIST_MAX_LEVEL 3
+#define INCLUDE_DIRECTIVE L"!include "
+#define INCLUDE_DEPTH 16
+
+// files an include directive may name, symbolic links resolved
+enum include_scope {
+    INCLUDE_DECK,    // files in the directory of the deck (the default)
+    INCLUDE_CHAPTER, // the deck names chapters, each of them files in its
+                     // own directory
+    INCLUDE_ANY      // any file
+};
 
 deck_t *markdown_load(FILE *input, int noexpand);
+deck_t *markdown_index(FILE *input, int noexpand);
+bool markdown_scan(deck_t *deck, int slides);
+void markdown_parse(deck_t *deck, slide_t *slide);
+void markdown_cache(deck_t *deck, size_t budget);
+void markdown_account(deck_t *deck, slide_t *slide);
+void markdown_search(search_t *search);
+void markdown_notes(bool notes);
+void markdown_include_base(const char *file);
+void markdown_include_scope(int scope);
+void markdown_stats(deck_t *deck);
+void markdown_invalid(deck_t *deck, const char *name);
 int markdown_analyse(cstring_t *text, int prev);
+void markdown_analyse_reset(void);
 void markdown_debug(deck_t *deck, int debug);
 void expand_character_entities(line_t *line);
 void adjust_line_length(line_t *line);
@@ -0,0 +1,116 @@
+#if !defined( REMOTE_H )
+#define REMOTE_H
+
+/*
+ * Remote control of the viewer through a local socket.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * struct: remote_client_t a connection and the command it sends so far,
+ *         it gets the state whenever it changes once it sent follow
+ * struct: remote_command_t an action, queued until the viewer takes it
+ * struct: remote_reply_t a reply to send once the state is known
+ * struct: remote_t the listening socket, its clients and the commands
+ *
+ * function: remote_init to listen on a Unix socket at path, served by the
+ *           event loop ev; a socket left by a process which is gone is
+ *           replaced, any other file at path fails with EEXIST, returns
+ *           NULL and sets errno if it fails
+ * function: remote_pending to tell if commands are queued
+ * function: remote_take to take the oldest command, its client gets the
+ *           state of the next remote_state call as reply; returns false
+ *           if none is left but replies queued behind commands taken
+ * function: remote_state to tell the slide shown, its stops revealed, the
+ *           stops it has and the hash of the deck, the clients waiting for
+ *           it get it as reply, the followers get it if it changed
+ * function: remote_socket to make a socket non-blocking, closed on exec
+ *           and, where MSG_NOSIGNAL is missing, not raise SIGPIPE; the
+ *           socket is closed if that fails, returns it or -1
+ * function: remote_delete to close the socket and free the allocated memory,
+ *           the socket file is removed unless it is no longer the one
+ *           created by remote_init
+ *
+ * A command is a line of text, one of next [N], prev [N], first, last,
+ * goto N, reveal, reload, quit, status or follow. Each gets one line as
+ * reply, either the state, e.g. "slide 3/12 stop 1/2 deck 3f0c...", once
+ * the command was applied, or "error: ..." if it is invalid. Replies come
+ * in the order of the commands. After follow, the state is sent each time
+ * the slide or stop shown, or the deck, changes; a follower joining late
+ * gets the current state at once. The event loop is woken as soon as a command is queued,
+ * so it is applied in place of a key.
+ *
+ */
+
+#include <stdint.h>
+#include <sys/types.h>  // dev_t, ino_t
+
+#include "common.h"
+#include "event.h"
+#include "keymap.h"
+
+#define REMOTE_LINE 128 // longest command
+
+typedef struct _remote_client_t {
+    int fd;
+    char line[REMOTE_LINE];
+    int len;           // chars of the command read so far
+    bool follows;      // gets every change of the state
+} remote_client_t;
+
+typedef struct _remote_command_t {
+    action_t action;   // ACTION_NONE to reply only
+    int count;         // slides to move, or the slide to show
+    int fd;            // client to reply to, -1 if it is gone
+    const char *error; // reply instead of the state, if not NULL
+} remote_command_t;
+
+typedef struct _remote_reply_t {
+    int fd;
+    const char *error;
+} remote_reply_t;
+
+typedef struct _remote_t {
+    event_t *ev;
+    int fd;            // listening socket
+    char *path;
+    dev_t dev;         // socket file created at path
+    ino_t ino;
+    remote_client_t *client;
+    int clients;
+    int max_clients;
+    remote_command_t *command; // oldest first
+    int commands;
+    int max_commands;
+    remote_reply_t *waiting; // replies to the commands taken
+    int waits;
+    int max_waits;
+    int sc;            // state shown last, 0 if none was yet
+    int slides;
+    int stop;
+    int stops;
+    uint64_t hash;
+} remote_t;
+
+remote_t *remote_init(event_t *ev, const char *path);
+bool remote_pending(const remote_t *r);
+bool remote_take(remote_t *r, action_t *action, int *count);
+void remote_state(remote_t *r, int sc, int slides, int stop, int stops, uint64_t hash);
+int remote_socket(int fd);
+void remote_delete(remote_t *r);
+
+#endif // !defined( REMOTE_H )
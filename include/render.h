@@ -0,0 +1,123 @@
+#if !defined( RENDER_H )
+#define RENDER_H
+
+/*
+ * Output backends used by the viewer to draw slides and read keys.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * struct: render_t which defines an output backend
+ *
+ * function: render_new to allocate a backend with common defaults
+ * function: render_ncurses_init to create a backend drawing with ncurses
+ * function: render_vt100_init to create a backend writing VT100/ANSI
+ *           escape sequences directly to the terminal, keeping a front
+ *           and back cell buffer and emitting only the difference
+ *           with a single write() per frame
+ * function: render_vt100_tty to create the same backend on the tty at path
+ *           instead of the controlling terminal, its geometry is taken at
+ *           every frame; returns NULL and sets errno if path cannot be
+ *           opened or is no tty
+ * function: render_headless_init to create a backend drawing into an
+ *           in-memory cell grid of the given size, no terminal is needed
+ * function: render_headless_input to script the keys returned by getkey,
+ *           ERR is returned once all keys are consumed
+ * function: render_headless_grid to access the cells of the last frame
+ * function: render_headless_dump to print the last frame as plain text,
+ *           or with ANSI escape sequences for colors and underline
+ * function: render_geometry to get the terminal size of STDOUT, falls back
+ *           to $LINES and $COLUMNS, or 24x80
+ * function: render_t->open to enter screen mode, lines and cols are
+ *           updated to the terminal geometry
+ * function: render_t->close to leave screen mode, the backend can be
+ *           opened again later
+ * function: render_t->init_pair to define the colors of a color pair
+ * function: render_t->bkgd to set the attribute used for blank cells
+ * function: render_t->erase to clear the whole screen
+ * function: render_t->viewport to restrict drawing to rows top..top+height,
+ *           all y coordinates are relative to the viewport
+ * function: render_t->move to position the cursor, text printed on rows
+ *           outside of the viewport is dropped
+ * function: render_t->addnwstr to print n chars (n < 0 prints all)
+ * function: render_t->addstr to print a multi-byte string
+ * function: render_t->attron to enable attributes, a color pair replaces
+ *           the current one
+ * function: render_t->attroff to disable attributes
+ * function: render_t->getx to get the cursor column
+ * function: render_t->blit to replace the whole screen with the cells of
+ *           a grid, returns false without drawing anything if the grid
+ *           does not have the geometry of the screen
+ * function: render_t->flush to send the frame to the terminal
+ * function: render_t->getkey to wait for a key press, timeout is given
+ *           in tenths of seconds (< 0 blocks, 0 polls), returns ERR on
+ *           timeout; the viewer polls render_t->input instead of blocking
+ *           here, see event.h
+ * function: render_t->delete to free the allocated memory
+ *
+ * Attributes use the GA_* flags and the color pair layout of grid.h.
+ * A backend counts frames and the bytes it sends to the terminal, so
+ * different backends can be compared.
+ *
+ */
+
+#include <stdio.h>
+
+#include "common.h"
+#include "grid.h"
+
+typedef struct _render_t {
+    int lines;
+    int cols;
+    int colors;               // amount of colors supported
+    int input;                // descriptor keys are read from, -1 if none
+    unsigned long frames;     // frames flushed
+    unsigned long bytes;      // bytes written for all frames
+    unsigned long last_bytes; // bytes written for the last frame
+    void *data;               // backend private data
+    bool (*open)(struct _render_t *self);
+    void (*close)(struct _render_t *self);
+    void (*init_pair)(struct _render_t *self, int pair, int fg, int bg);
+    void (*bkgd)(struct _render_t *self, int attr);
+    void (*erase)(struct _render_t *self);
+    void (*viewport)(struct _render_t *self, int top, int height);
+    void (*move)(struct _render_t *self, int y, int x);
+    void (*addnwstr)(struct _render_t *self, const wchar_t *s, int n);
+    void (*addstr)(struct _render_t *self, const char *s);
+    void (*attron)(struct _render_t *self, int attr);
+    void (*attroff)(struct _render_t *self, int attr);
+    int (*getx)(struct _render_t *self);
+    bool (*blit)(struct _render_t *self, const grid_t *g);
+    void (*flush)(struct _render_t *self);
+    int (*getkey)(struct _render_t *self, int timeout);
+    void (*delete)(struct _render_t *self);
+} render_t;
+
+render_t *render_new(void);
+render_t *render_ncurses_init(void);
+render_t *render_vt100_init(void);
+render_t *render_vt100_tty(const char *path);
+render_t *render_headless_init(int lines, int cols);
+void render_headless_input(render_t *self, const char *keys);
+const grid_t *render_headless_grid(render_t *self);
+void render_headless_dump(render_t *self, FILE *out, bool ansi);
+void render_geometry(int *lines, int *cols);
+void render_addstr(render_t *self, const char *s);
+bool render_blit(render_t *self, const grid_t *g);
+void render_stats(render_t *self);
+
+#endif // !defined( RENDER_H )
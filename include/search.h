@@ -0,0 +1,108 @@
+#if !defined( SEARCH_H )
+#define SEARCH_H
+
+/*
+ * Trigram index over the text of the slides of a deck.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * struct: search_t the index, kept across reloads
+ *
+ * function: search_init to allocate an empty index
+ * function: search_begin to start indexing a deck, slide numbers of the
+ *           previous deck are forgotten, its slide contents are kept
+ * function: search_line to add a line to the slide being indexed
+ * function: search_slide to complete the slide being indexed, the next
+ *           line belongs to the following slide
+ * function: search_candidates to find the slides which may contain query,
+ *           they are stored in ascending order in slides, which is owned
+ *           by the index; returns the amount of slides, or -1 if query
+ *           is shorter than a trigram and any slide may contain it
+ * function: search_fold to fold a char for case insensitive matching
+ * function: search_match to find the first case insensitive match of a
+ *           folded query in text, returns NULL if there is none
+ * function: search_fuzzy to match a folded query against text as a
+ *           subsequence, returns a score which is higher the closer the
+ *           chars are together, or -1 if text does not contain all of them
+ * function: search_stats to print the index counters on STDERR
+ * function: search_delete to free the allocated memory
+ *
+ * Slides are indexed by content: a slide with the same text as a slide
+ * indexed before, in this deck or a previously loaded one, only records
+ * its slide number, so a reload only extracts the trigrams of changed
+ * slides. The index is a filter, a candidate slide has all trigrams of
+ * the query but not necessarily the query itself.
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <wchar.h>
+
+#include "common.h"
+
+#define SEARCH_GRAM 3 // chars per index key
+
+typedef struct _search_doc_t {
+    uint64_t hash;     // FNV-1a of the folded slide text
+    int *slides;       // slide numbers having this text
+    int size;
+    int alloc;
+    unsigned long generation; // deck the slide numbers belong to
+} search_doc_t;
+
+typedef struct _search_posting_t {
+    uint64_t key;      // three folded chars, 0 for an empty entry
+    int *docs;         // ids of the docs having the trigram, ascending
+    int size;
+    int alloc;
+} search_posting_t;
+
+typedef struct _search_t {
+    search_doc_t *docs;
+    int ndocs;
+    int max_docs;
+    int *doc_table;    // doc ids by hash, -1 for an empty entry
+    size_t doc_mask;
+    search_posting_t *postings; // posting lists by trigram
+    size_t postings_used;
+    size_t posting_mask;
+    unsigned long generation;   // decks indexed
+    int slide;         // number of the slide being indexed
+    wchar_t *text;     // folded text of the slide being indexed
+    size_t chars;
+    size_t max_chars;
+    uint64_t *keys;    // scratch for the trigrams of a doc
+    size_t max_keys;
+    int *result;       // candidate slides of the last query
+    int max_result;
+    unsigned long indexed, reused, compacted;
+} search_t;
+
+search_t *search_init(void);
+void search_begin(search_t *s);
+void search_line(search_t *s, const wchar_t *text, size_t n);
+void search_slide(search_t *s);
+int search_candidates(search_t *s, const wchar_t *query, int **slides);
+wchar_t search_fold(wchar_t c);
+const wchar_t *search_match(const wchar_t *text, const wchar_t *query);
+int search_fuzzy(const wchar_t *text, const wchar_t *query);
+void search_stats(search_t *s);
+void search_delete(search_t *s);
+
+#endif // !defined( SEARCH_H )
@@ -21,6 +21,8 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  *
  * function: url_init to initialize a new url object
+ * function: url_find_char to find the next occurrence of a char, remembering
+ *           the result so repeated searches on the same line stay linear
  */
 
 typedef struct _url_t {
@@ -40,5 +42,6 @@ void url_purge(void);
 void url_dump(void);
 int url_count_inline(const wchar_t *line);
 int url_len_inline(const wchar_t *value);
+const wchar_t *url_find_char(const wchar_t *i, wchar_t c, const wchar_t **cache);
 
 #endif // !defined( URL_H )
@@ -0,0 +1,52 @@
+#if !defined( UTF8_H )
+#define UTF8_H
+
+/*
+ * Conversion between UTF-8 and wide chars, independent of the locale.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * function: utf8_decode to validate and decode n bytes into wide chars,
+ *           out needs room for n chars; decoding stops at the first
+ *           invalid sequence (overlong, surrogate, out of range or
+ *           truncated) and its byte offset is stored in done, which is n
+ *           if all bytes were decoded; returns the amount of chars
+ * function: utf8_invalid to get the length of the invalid sequence at the
+ *           start of s, i.e. the bytes to skip before decoding again
+ * function: utf8_length to calculate the bytes needed to encode n chars
+ * function: utf8_encode to encode n chars, returns the end of the output
+ *
+ * With UTF8_PRINTABLE, chars that are neither printable nor space are
+ * decoded as L'\0', so the caller can drop them without losing track of
+ * their position. Runs of 7-bit ASCII are decoded 16 bytes at a time
+ * with SSE2, or 8 bytes at a time otherwise.
+ *
+ */
+
+#include <stddef.h>
+#include <wchar.h>
+
+#define UTF8_PRINTABLE 1
+#define UTF8_REPLACEMENT L'\xfffd'
+
+size_t utf8_decode(const char *s, size_t n, wchar_t *out, int flags, size_t *done);
+size_t utf8_invalid(const char *s, size_t n);
+size_t utf8_length(const wchar_t *in, size_t n);
+char *utf8_encode(char *out, const wchar_t *in, size_t n);
+
+#endif // !defined( UTF8_H )
@@ -23,10 +23,54 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  *
  *
- * function: ncurses_display initializes ncurses, defines colors, calculates
- *           window geometry and handles key strokes
- * function: add_line detects inline markdown formatting and prints line char
- *           by char
+ * function: ncurses_display initializes the output backend, defines colors,
+ *           calculates window geometry and handles key strokes, a search
+ *           jumps to the slides matching the query as it is typed and
+ *           highlights the matches, the table of contents and the overview
+ *           of slide summaries jump to the slide picked, the pager scrolls
+ *           through all slides as one document
+ * function: ncurses_frames to cache the slides ncurses_display renders in
+ *           cell buffers, shown again with a single copy; the slides shown
+ *           next are rendered while waiting for a key (NULL disables it)
+ * function: ncurses_keymap to set the actions of the keys, the bindings
+ *           of config.h are used if it is never called
+ * function: default_keymap to allocate a keymap with the bindings of config.h
+ * function: ncurses_events to wait for keys with an event loop serving
+ *           further sources, ncurses_display uses a loop of its own if it
+ *           is NULL
+ * function: ncurses_remote to apply the commands of a remote control as
+ *           if they were keys, and to tell it the state shown
+ * function: ncurses_follow to show the slides and stops another viewer
+ *           shows, the deck is reloaded once if the leader shows another
+ * function: ncurses_watch to reload the deck when its files change
+ * function: ncurses_presenter to show the presenter view on a second
+ *           backend, the state shown, the state shown next as the audience
+ *           will see it and the notes of the slide; its keys are taken as
+ *           well (NULL disables it)
+ * function: print_deck renders all slides fully revealed with a headless
+ *           backend and prints them to STDOUT
+ * function: layout_slide calculates the rows consumed by a slide and widens
+ *           max_cols to its widest line, returns 0 on success or the
+ *           minimum width needed if a single word does not fit, the word
+ *           is then counted broken like the terminal breaks it
+ * function: layout_deck calculates the rows consumed by each slide and the
+ *           widest line for a given terminal width, returns 0 on success
+ *           or the minimum width needed if a single word does not fit;
+ *           large decks are laid out on a thread per CPU if built with
+ *           HAVE_PTHREAD
+ * function: layout_check runs layout_deck for the backend geometry and
+ *           reports an error if the slides do not fit
+ * function: layout_check_slide lays out a single slide of a lazily loaded
+ *           deck, parsing it first if needed, returns false if it does not
+ *           fit the backend and is shown clipped
+ * function: setup_colors defines the color pairs, returns 1 if colors
+ *           are used
+ * function: display_slide draws header, footer and one slide up to its
+ *           current stop into the backend, without flushing the frame,
+ *           returns the amount of lines not shown (0 if all are shown)
+ * function: add_line detects inline markdown formatting and prints line ln of
+ *           a slide char by char, display_slide replays the display lists
+ *           compiled from it instead
  * function: fade_in, fade_out implementing color fading in 256 color mode
  * function: int_length to calculate decimal length of slide count
  *
@@ -45,6 +89,16 @@
 #include "parser.h"
 #include "cstack.h"
 #include "url.h"
+#include "render.h"
+#include "search.h"
+#include "pager.h"
+#include "display.h"
+#include "frame.h"
+#include "event.h"
+#include "keymap.h"
+#include "remote.h"
+#include "follow.h"
+#include "watch.h"
 
 #define CP_FG     1
 #define CP_HEADER 2
@@ -52,12 +106,33 @@
 #define CP_TITLE  4
 #define CP_CODE   5
 
-int ncurses_display(deck_t *deck, int reload, int noreload, int slidenum);
-void add_line(WINDOW *window, int y, int x, line_t *line, int max_cols, int colors);
-void inline_display(WINDOW *window, const wchar_t *c, const int colors);
+#define SCAN_SLIDES 256 // slides of a lazily loaded deck to scan between key polls
+#define SEARCH_QUERY 256 // chars of a search query
+#define OVERVIEW_WIDTH 32 // minimum columns of a slide in the overview
+#define FRAME_CACHE (4 << 20) // default bytes of rendered slides to keep
+#define LAYOUT_THREADS 8 // most threads laying out a deck
+#define LAYOUT_SLIDES 256 // fewest slides per thread worth starting it for
+#define LAYOUT_BLOCK 32  // slides a layout thread takes at once
+
+int ncurses_display(deck_t *deck, render_t *render, int reload, int noreload, int slidenum);
+void ncurses_frames(frames_t *f);
+void ncurses_events(event_t *ev);
+void ncurses_keymap(keymap_t *km);
+void ncurses_remote(remote_t *r);
+void ncurses_follow(follow_t *f);
+void ncurses_watch(watch_t *w);
+void ncurses_presenter(render_t *p);
+keymap_t *default_keymap(void);
+bool print_deck(deck_t *deck, render_t *render, int slidenum, bool ansi);
+int layout_deck(deck_t *deck, int cols, int *max_lines, int *max_cols, int *max_lines_slide);
+int layout_slide(slide_t *slide, int cols, int *max_cols);
+bool layout_check(deck_t *deck, render_t *render, int slidenum, int *max_lines, int *max_cols, int *max_lines_slide);
+bool layout_check_slide(deck_t *deck, render_t *render, slide_t *slide, int slidenum, int *max_cols);
+int setup_colors(render_t *render);
+int display_slide(render_t *render, deck_t *deck, slide_t *slide, int sc, int max_cols, int slidenum, int colors, int *stop);
+void add_line(render_t *render, int y, int x, slide_t *slide, int ln, int max_cols, int colors);
+void inline_display(render_t *render, const wchar_t *c, const int colors);
 int int_length (int val);
-int get_slide_number(char init);
 void setup_list_strings(void);
-bool evaluate_binding(const int bindings[], char c);
 
 #endif // !defined( VIEWER_H )
@@ -0,0 +1,74 @@
+#if !defined( WATCH_H )
+#define WATCH_H
+
+/*
+ * Watching the files of a deck to reload it when they change.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * struct: watch_file_t a file of the deck, or a directory of chapters
+ * struct: watch_t the files watched and whether they changed
+ *
+ * function: watch_init to watch the n files or directories at paths,
+ *           served by the event loop ev; a directory stands for its *.md
+ *           files, as a deck of chapters does
+ * function: watch_pending to tell if the files changed since the change
+ *           taken last
+ * function: watch_take to take a change, returns true once per change
+ * function: watch_delete to stop watching and free the allocated memory
+ *
+ * On Linux the directories of the files are watched with inotify, so a
+ * file replaced by an editor is noticed as well. Elsewhere, or if inotify
+ * fails, the files are polled every WATCH_POLL milliseconds for another
+ * inode, size or modification time. A change is pending once the files
+ * were left alone for WATCH_DELAY milliseconds, an editor saving in
+ * several steps causes a single reload.
+ *
+ */
+
+#include <stdint.h>
+
+#include "common.h"
+#include "event.h"
+
+#define WATCH_POLL 1000 // milliseconds between polls without inotify
+#define WATCH_DELAY 100 // milliseconds without changes before a reload
+
+typedef struct _watch_file_t {
+    char *path;
+    char *name;       // file in the directory watched, NULL for chapters
+    int wd;           // inotify watch of the directory, -1 for none
+} watch_file_t;
+
+typedef struct _watch_t {
+    event_t *ev;
+    watch_file_t *file;
+    int files;
+    int fd;           // inotify descriptor, -1 while polling
+    int poll;         // id of the poll timer, 0 for none
+    int delay;        // id of the timer making a change pending, 0 for none
+    uint64_t stamp;   // inodes, sizes and times polled last
+    bool changed;
+} watch_t;
+
+watch_t *watch_init(event_t *ev, char **paths, int n);
+bool watch_pending(const watch_t *w);
+bool watch_take(watch_t *w);
+void watch_delete(watch_t *w);
+
+#endif // !defined( WATCH_H )
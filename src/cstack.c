@@ -45,7 +45,8 @@ cstack_t *cstack_init() {
 
 void cstack_push(cstack_t *self, wchar_t c) {
     if(self->size + sizeof(c) > self->alloc) {
-        self->alloc += (sizeof(wchar_t));
+        // double the allocation, pushing stays linear in the stack depth
+        self->alloc = self->alloc ? self->alloc * 2 : 16 * sizeof(wchar_t);
         if((self->content = realloc(self->content, self->alloc)) == NULL) {
             fprintf(stderr, "%s\n", "cstack_push() failed to reallocate memory.");
             exit(EXIT_FAILURE);
@@ -19,11 +19,12 @@
  *
  */
 
-#include <wchar.h> // wcslen, wcscat, wmemmove
+#include <wchar.h> // wcslen, wmemcpy, wmemmove
 #include <stdio.h> // fprintf
 #include <stdlib.h> // malloc, realloc
 
 #include "cstring.h"
+#include "utf8.h"
 
 cstring_t *cstring_init() {
     cstring_t *x = NULL;
@@ -32,6 +33,7 @@ cstring_t *cstring_init() {
         x->size = x->alloc = 0;
         x->expand = cstring_expand;
         x->expand_arr = cstring_expand_arr;
+        x->expand_utf8 = cstring_expand_utf8;
         x->strip = cstring_strip;
         x->reset = cstring_reset;
         x->delete = cstring_delete;
@@ -42,30 +44,58 @@ cstring_t *cstring_init() {
     return x;
 }
 
-void cstring_expand(cstring_t *self, wchar_t x) {
-    if((self->size + 2) * sizeof(wchar_t) > self->alloc) {
-        self->alloc += (REALLOC_ADD * sizeof(wchar_t));
-        if((self->value = realloc(self->value, self->alloc)) == NULL) {
-            fprintf(stderr, "%s\n", "cstring_expand() failed to reallocate memory.");
-            exit(EXIT_FAILURE);
-        }
+// grow the buffer geometrically, so appending stays linear in the length
+static void cstring_reserve(cstring_t *self, size_t size) {
+    size_t alloc = self->alloc ? self->alloc : REALLOC_ADD * sizeof(wchar_t);
+
+    if((size + 1) * sizeof(wchar_t) <= self->alloc)
+        return;
+
+    while((size + 1) * sizeof(wchar_t) > alloc)
+        alloc *= 2;
+
+    if((self->value = realloc(self->value, alloc)) == NULL) {
+        fprintf(stderr, "%s\n", "cstring_reserve() failed to reallocate memory.");
+        exit(EXIT_FAILURE);
     }
-    self->value[self->size] = x;
-    self->value[self->size+1] = L'\0';
-    self->size = wcslen(self->value);
+    self->alloc = alloc;
+}
+
+void cstring_expand(cstring_t *self, wchar_t x) {
+    // a null char would end the string early
+    if(x == L'\0')
+        return;
+
+    cstring_reserve(self, self->size + 1);
+    self->value[self->size++] = x;
+    self->value[self->size] = L'\0';
 }
 
 void cstring_expand_arr(cstring_t *self, wchar_t *x) {
-    if((self->size + wcslen(x) + 1) * sizeof(wchar_t) > self->alloc) {
-        self->alloc = ((self->size + wcslen(x) + 1) * sizeof(wchar_t));
-        if((self->value = realloc(self->value, self->alloc)) == NULL) {
-            fprintf(stderr, "%s\n", "cstring_expand_arr() failed to reallocate memory.");
-            exit(EXIT_FAILURE);
-        }
+    size_t len = wcslen(x);
+
+    cstring_reserve(self, self->size + len);
+    wmemcpy(&self->value[self->size], x, len);
+    self->size += len;
+    self->value[self->size] = L'\0';
+}
+
+void cstring_expand_utf8(cstring_t *self, const char *x, size_t n) {
+    size_t done;
+
+    // n bytes never decode to more than n chars
+    cstring_reserve(self, self->size + n);
+
+    while(n > 0) {
+        self->size += utf8_decode(x, n, &self->value[self->size], 0, &done);
+
+        // skip invalid bytes
+        done += utf8_invalid(&x[done], n - done);
+        x += done;
+        n -= done;
     }
-    self->value = wcscat(self->value, x);
-    self->size = wcslen(self->value);
-    self->value[self->size+1] = L'\0';
+
+    self->value[self->size] = L'\0';
 }
 
 void cstring_strip(cstring_t *self, int pos, int len) {
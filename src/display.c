@@ -0,0 +1,244 @@
+/*
+ * Display lists, the compiled output of the lines of a slide.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <wchar.h>
+
+#include "display.h"
+#include "grid.h"
+#include "url.h"
+
+// a cell the line being compiled did not draw
+#define UNSET ((wchar_t) -1)
+
+static grid_t *grid = NULL;     // cells of the line being compiled,
+                                // all of them unset between lines
+static int rows = 0;            // rows of grid the line may use
+static render_t *record = NULL; // backend drawing into grid
+
+static void record_move(render_t *self, int y, int x) {
+    grid_move(grid, y, x);
+}
+
+static void record_addnwstr(render_t *self, const wchar_t *s, int n) {
+    grid_addnwstr(grid, s, n);
+}
+
+static void record_attron(render_t *self, int attr) {
+    if(GA_PAIR(attr))
+        grid->attr = (grid->attr & ~0xff) | GA_PAIR(attr);
+    grid->attr |= attr & ~0xff;
+}
+
+static void record_attroff(render_t *self, int attr) {
+    if(GA_PAIR(attr))
+        grid->attr &= ~0xff;
+    grid->attr &= ~(attr & ~0xff);
+}
+
+static int record_getx(render_t *self) {
+    return grid->x;
+}
+
+display_t *display_init(void) {
+    display_t *d = calloc(1, sizeof(display_t));
+
+    if(!d) {
+        fprintf(stderr, "%s\n", "display_init() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+
+    return d;
+}
+
+void display_prepare(display_t *d, int cols, int max_cols, int colors) {
+    if(d->cols == cols && d->max_cols == max_cols && d->colors == colors)
+        return;
+
+    d->cols = cols;
+    d->max_cols = max_cols;
+    d->colors = colors;
+    d->lines = d->runs = d->urls = d->chars = 0;
+}
+
+render_t *display_record(display_t *d, int n, int attr) {
+    int i;
+
+    if(!record) {
+        record = render_new();
+        record->move = record_move;
+        record->addnwstr = record_addnwstr;
+        record->attron = record_attron;
+        record->attroff = record_attroff;
+        record->getx = record_getx;
+    }
+
+    if(!grid || grid->lines < n || grid->cols != d->cols) {
+        if(!grid)
+            grid = grid_init(n, d->cols);
+        else
+            grid_resize(grid, MAX(n, grid->lines), d->cols);
+        for(i = 0; i < grid->lines * grid->cols; i++)
+            grid->cells[i].c = UNSET;
+    }
+
+    record->lines = rows = n;
+    record->cols = d->cols;
+    record->colors = d->colors;
+
+    grid_viewport(grid, 0, rows);
+    grid->attr = d->lines ? d->line_attr[d->lines - 1] : attr;
+
+    return record;
+}
+
+static void add_chars(display_t *d, const wchar_t *s, int n) {
+    if(d->chars + n > d->max_chars) {
+        d->max_chars = MAX(d->chars + n, d->max_chars * 2);
+        if(!(d->text = realloc(d->text, d->max_chars * sizeof(wchar_t)))) {
+            fprintf(stderr, "%s\n", "display_commit() failed to allocate memory.");
+            exit(EXIT_FAILURE);
+        }
+    }
+    wmemcpy(&d->text[d->chars], s, n);
+    d->chars += n;
+}
+
+static void add_run(display_t *d, int dy, int x, int attr) {
+    display_run_t *run;
+
+    if(d->runs == d->max_runs) {
+        d->max_runs = d->max_runs ? d->max_runs * 2 : 64;
+        if(!(d->run = realloc(d->run, d->max_runs * sizeof(display_run_t)))) {
+            fprintf(stderr, "%s\n", "display_commit() failed to allocate memory.");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    run = &d->run[d->runs++];
+    run->dy = dy;
+    run->x = x;
+    run->attr = attr;
+    run->start = d->chars;
+    run->n = 0;
+}
+
+static void add_url(display_t *d, const wchar_t *name, const wchar_t *target) {
+    int *url;
+
+    if(d->urls == d->max_urls) {
+        d->max_urls = d->max_urls ? d->max_urls * 2 : 8;
+        if(!(d->url = realloc(d->url, d->max_urls * 4 * sizeof(int)))) {
+            fprintf(stderr, "%s\n", "display_commit() failed to allocate memory.");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    url = &d->url[d->urls++ * 4];
+    url[0] = d->chars;
+    url[1] = wcslen(name);
+    add_chars(d, name, url[1]);
+    url[2] = d->chars;
+    url[3] = wcslen(target);
+    add_chars(d, target, url[3]);
+}
+
+void display_commit(display_t *d, int urls) {
+    cell_t *cell;
+    int y, x, last;
+
+    if(d->lines + 1 >= d->max_lines) {
+        d->max_lines = d->max_lines ? d->max_lines * 2 : 64;
+        if(!(d->line_run = realloc(d->line_run, (d->max_lines + 1) * sizeof(int))) ||
+           !(d->line_url = realloc(d->line_url, (d->max_lines + 1) * sizeof(int))) ||
+           !(d->line_attr = realloc(d->line_attr, d->max_lines * sizeof(int)))) {
+            fprintf(stderr, "%s\n", "display_commit() failed to allocate memory.");
+            exit(EXIT_FAILURE);
+        }
+    }
+    d->line_run[d->lines] = d->runs;
+    d->line_url[d->lines] = d->urls;
+
+    // runs of drawn cells of the same attribute, the line is drawn from
+    // row 0 on, so no row below the cursor has been drawn
+    last = MIN(grid->y, rows - 1);
+    for(y = 0; y <= last; y++) {
+        cell = &grid->cells[y * grid->cols];
+        for(x = 0; x < grid->cols; x++) {
+            if(cell[x].c == UNSET)
+                continue;
+            if(x == 0 || cell[x - 1].c == UNSET || cell[x - 1].attr != cell[x].attr)
+                add_run(d, y, x, cell[x].attr);
+            // the right half of a double width char is drawn by the left one
+            if(cell[x].c) {
+                add_chars(d, &cell[x].c, 1);
+                d->run[d->runs - 1].n++;
+            }
+        }
+        for(x = 0; x < grid->cols; x++)
+            cell[x].c = UNSET;
+    }
+
+    for(; urls < url_get_amount(); urls++)
+        add_url(d, url_get_name(urls), url_get_target(urls));
+
+    d->line_attr[d->lines++] = grid->attr;
+    d->line_run[d->lines] = d->runs;
+    d->line_url[d->lines] = d->urls;
+}
+
+void display_replay(display_t *d, render_t *render, int ln, int y, bool links) {
+    display_run_t *run, *end;
+    int *url, i;
+
+    for(run = &d->run[d->line_run[ln]], end = &d->run[d->line_run[ln + 1]]; run < end; run++) {
+        (render->attroff)(render, GA_UNDERLINE | GA_REVERSE);
+        (render->attron)(render, run->attr);
+        (render->move)(render, y + run->dy, run->x);
+        (render->addnwstr)(render, &d->text[run->start], run->n);
+    }
+    (render->attroff)(render, GA_UNDERLINE | GA_REVERSE);
+    (render->attron)(render, d->line_attr[ln]);
+
+    for(i = d->line_url[ln]; links && i < d->line_url[ln + 1]; i++) {
+        url = &d->url[i * 4];
+        url_add(&d->text[url[0]], url[1], &d->text[url[2]], url[3], 0, 0);
+    }
+}
+
+size_t display_bytes(const display_t *d) {
+    return sizeof(display_t) +
+           (d->max_lines ? (3 * d->max_lines + 2) * sizeof(int) : 0) +
+           d->max_runs * sizeof(display_run_t) +
+           d->max_urls * 4 * sizeof(int) +
+           d->max_chars * sizeof(wchar_t);
+}
+
+void display_delete(display_t *d) {
+    free(d->line_run);
+    free(d->line_url);
+    free(d->line_attr);
+    free(d->run);
+    free(d->url);
+    free(d->text);
+    free(d);
+}
@@ -0,0 +1,251 @@
+/*
+ * Event loop waiting for keys, file descriptors and timers.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <errno.h>
+#include <stdio.h>  // fprintf
+#include <stdlib.h> // calloc, malloc, realloc, free
+#include <string.h> // memmove
+#include <time.h>   // clock_gettime
+
+#include "event.h"
+
+event_t *event_init(void) {
+    event_t *ev = calloc(1, sizeof(event_t));
+
+    if(!ev || !(ev->pfd = malloc(sizeof(struct pollfd)))) {
+        fprintf(stderr, "%s\n", "event_init() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+    ev->max_pfd = 1;
+    ev->next_id = 1;
+
+    return ev;
+}
+
+static long long event_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static event_source_t *event_find(event_t *ev, int fd) {
+    int i;
+
+    for(i = 0; i < ev->sources; i++)
+        if(ev->source[i].fd == fd)
+            return &ev->source[i];
+
+    return NULL;
+}
+
+void event_watch(event_t *ev, int fd, event_ready_t ready, void *data) {
+    event_source_t *s = event_find(ev, fd);
+
+    if(!s) {
+        if(ev->sources == ev->max_sources) {
+            ev->max_sources = ev->max_sources ? ev->max_sources * 2 : 4;
+            if(!(ev->source = realloc(ev->source, ev->max_sources * sizeof(event_source_t))) ||
+               !(ev->pfd = realloc(ev->pfd, (ev->max_sources + 1) * sizeof(struct pollfd)))) {
+                fprintf(stderr, "%s\n", "event_watch() failed to allocate memory.");
+                exit(EXIT_FAILURE);
+            }
+            ev->max_pfd = ev->max_sources + 1;
+        }
+        s = &ev->source[ev->sources++];
+        s->fd = fd;
+    }
+    s->ready = ready;
+    s->data = data;
+}
+
+void event_unwatch(event_t *ev, int fd) {
+    event_source_t *s = event_find(ev, fd);
+
+    if(s) {
+        ev->sources--;
+        memmove(s, s + 1, (&ev->source[ev->sources] - s) * sizeof(event_source_t));
+    }
+}
+
+int event_timer(event_t *ev, int ms, event_expired_t expired, void *data) {
+    long long due = event_now() + ms;
+    int i;
+
+    if(ev->timers == ev->max_timers) {
+        ev->max_timers = ev->max_timers ? ev->max_timers * 2 : 4;
+        if(!(ev->timer = realloc(ev->timer, ev->max_timers * sizeof(event_timer_t)))) {
+            fprintf(stderr, "%s\n", "event_timer() failed to allocate memory.");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // keep them ordered by due, timers due at once expire in order added
+    for(i = ev->timers; i > 0 && ev->timer[i - 1].due > due; i--)
+        ev->timer[i] = ev->timer[i - 1];
+    ev->timer[i].id = ev->next_id++;
+    ev->timer[i].due = due;
+    ev->timer[i].expired = expired;
+    ev->timer[i].data = data;
+    ev->timers++;
+
+    return ev->timer[i].id;
+}
+
+void event_cancel(event_t *ev, int id) {
+    int i;
+
+    for(i = 0; i < ev->timers; i++) {
+        if(ev->timer[i].id == id) {
+            ev->timers--;
+            memmove(&ev->timer[i], &ev->timer[i + 1], (ev->timers - i) * sizeof(event_timer_t));
+            return;
+        }
+    }
+}
+
+void event_idle(event_t *ev, event_idle_t idle, void *data) {
+    ev->idle = idle;
+    ev->idle_data = data;
+}
+
+void event_wake(event_t *ev) {
+    ev->wake = true;
+}
+
+void event_push(event_t *ev, int key) {
+    if(ev->keys < EVENT_KEYS)
+        ev->key[ev->keys++] = key;
+}
+
+// call the timers which are due, each is dropped before it is called
+static void event_expire(event_t *ev, long long now) {
+    event_timer_t t;
+
+    while(ev->timers && ev->timer[0].due <= now) {
+        t = ev->timer[0];
+        ev->timers--;
+        memmove(&ev->timer[0], &ev->timer[1], ev->timers * sizeof(event_timer_t));
+        (t.expired)(ev, t.data);
+    }
+}
+
+// milliseconds to wait for the deadline or the next timer, -1 for ever
+static int event_wait(event_t *ev, long long now, long long deadline) {
+    long long until = deadline;
+
+    if(ev->timers && (until < 0 || ev->timer[0].due < until))
+        until = ev->timer[0].due;
+
+    return until < 0 ? -1 : (int) MAX(until - now, 0LL);
+}
+
+int event_key(event_t *ev, render_t *render, int timeout) {
+    long long now = event_now();
+    long long deadline = timeout < 0 ? -1 : now + timeout;
+    bool busy = ev->idle != NULL;
+    event_source_t *s;
+    int c, i, n, wait;
+
+    while(true) {
+
+        // keys pushed, e.g. by a source
+        if(ev->keys) {
+            c = ev->key[0];
+            ev->keys--;
+            memmove(&ev->key[0], &ev->key[1], ev->keys * sizeof(int));
+            break;
+        }
+
+        // keys read already, a resize, or scripted keys
+        if((render->input >= 0 || busy) && (c = (render->getkey)(render, 0)) != ERR)
+            break;
+
+        now = event_now();
+        event_expire(ev, now);
+        if(ev->wake) {
+            c = EVENT_WAKE;
+            break;
+        }
+        if(deadline >= 0 && now >= deadline) {
+            c = ERR;
+            break;
+        }
+
+        // nothing to poll, the backend waits itself
+        if(render->input < 0) {
+            if(busy) {
+                busy = (ev->idle)(ev, ev->idle_data);
+                continue;
+            }
+            wait = event_wait(ev, now, deadline);
+            c = (render->getkey)(render, wait < 0 ? -1 : (wait + 99) / 100);
+            break;
+        }
+
+        ev->pfd[0].fd = render->input;
+        ev->pfd[0].events = POLLIN;
+        for(i = 0; i < ev->sources; i++) {
+            ev->pfd[i + 1].fd = ev->source[i].fd;
+            ev->pfd[i + 1].events = POLLIN;
+        }
+        n = ev->sources + 1;
+
+        // only look for input between the steps of idle work
+        if(poll(ev->pfd, n, busy ? 0 : event_wait(ev, now, deadline)) < 0) {
+            if(errno == EINTR)
+                continue; // a signal, e.g. the terminal was resized
+            c = ERR;
+            break;
+        }
+
+        // a key arrived, or the input is closed if there is none
+        if(ev->pfd[0].revents) {
+            c = (render->getkey)(render, 0);
+            break;
+        }
+
+        // the sources may change while they are served
+        for(i = 1; i < n; i++)
+            if(ev->pfd[i].revents && (s = event_find(ev, ev->pfd[i].fd)))
+                (s->ready)(ev, s->fd, s->data);
+
+        if(ev->wake) {
+            c = EVENT_WAKE;
+            break;
+        }
+
+        if(busy)
+            busy = (ev->idle)(ev, ev->idle_data);
+    }
+
+    ev->idle = NULL;
+    if(c == EVENT_WAKE)
+        ev->wake = false;
+    return c;
+}
+
+void event_delete(event_t *ev) {
+    free(ev->source);
+    free(ev->timer);
+    free(ev->pfd);
+    free(ev);
+}
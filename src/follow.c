@@ -0,0 +1,165 @@
+/*
+ * Following the slides another viewer shows.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <errno.h>
+#include <stdio.h>      // fprintf, sscanf
+#include <stdlib.h>     // calloc, free
+#include <string.h>     // strdup
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>     // close, read
+
+#include "follow.h"
+
+// SO_NOSIGPIPE is set on the socket where there is no MSG_NOSIGNAL
+#if !defined( MSG_NOSIGNAL )
+#define MSG_NOSIGNAL 0
+#endif
+
+static void follow_connect(event_t *ev, void *data);
+
+follow_t *follow_init(event_t *ev, const char *path) {
+    struct sockaddr_un addr;
+    follow_t *f;
+
+    if(strlen(path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return NULL;
+    }
+
+    f = calloc(1, sizeof(follow_t));
+    if(!f || !(f->path = strdup(path))) {
+        fprintf(stderr, "%s\n", "follow_init() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+    f->ev = ev;
+    f->fd = -1;
+    follow_connect(ev, f);
+
+    return f;
+}
+
+// parse a state sent by the leader, other lines are ignored
+static void follow_line(follow_t *f) {
+    unsigned long long hash;
+    int sc, stop;
+
+    f->line[f->len] = '\0';
+    if(sscanf(f->line, "slide %d/%*d stop %d/%*d deck %llx", &sc, &stop, &hash) != 3 || sc < 1)
+        return;
+
+    f->sc = sc;
+    f->stop = stop;
+    f->hash = hash;
+    if(follow_pending(f))
+        event_wake(f->ev);
+}
+
+static void follow_close(follow_t *f) {
+    event_unwatch(f->ev, f->fd);
+    close(f->fd);
+    f->fd = -1;
+    f->timer = event_timer(f->ev, FOLLOW_RETRY, follow_connect, f);
+}
+
+static void follow_read(event_t *ev, int fd, void *data) {
+    follow_t *f = data;
+    char buf[512];
+    ssize_t n;
+    int i;
+
+    if((n = read(fd, buf, sizeof(buf))) <= 0) {
+        if(n == 0 || (errno != EAGAIN && errno != EINTR))
+            follow_close(f);
+        return;
+    }
+
+    for(i = 0; i < n; i++) {
+        if(buf[i] == '\n') {
+            follow_line(f);
+            f->len = 0;
+        } else if(f->len < REMOTE_LINE - 1) {
+            f->line[f->len++] = buf[i];
+        }
+    }
+}
+
+// connect to the leader, or try again later
+static void follow_connect(event_t *ev, void *data) {
+    static const char command[] = "follow\n";
+    struct sockaddr_un addr;
+    follow_t *f = data;
+
+    f->timer = 0;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, f->path);
+
+    // a leader which does not accept, e.g. because it hangs, must not block
+    // the follower
+    if((f->fd = remote_socket(socket(AF_UNIX, SOCK_STREAM, 0))) < 0) {
+        f->timer = event_timer(ev, FOLLOW_RETRY, follow_connect, f);
+        return;
+    }
+
+    // the state arrives as reply, the one of a previous leader is void
+    f->len = 0;
+    event_watch(ev, f->fd, follow_read, f);
+    // a connect which would block (EAGAIN while the backlog of the leader
+    // is full, or EINPROGRESS) fails and is tried again later
+    if(connect(f->fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+       send(f->fd, command, sizeof(command) - 1, MSG_NOSIGNAL) < 0)
+        follow_close(f);
+}
+
+bool follow_pending(const follow_t *f) {
+    return f->sc && (f->sc != f->taken_sc || f->stop != f->taken_stop ||
+                     f->hash != f->taken_hash);
+}
+
+follow_step_t follow_take(follow_t *f, uint64_t hash, int *sc, int *stop) {
+    if(!follow_pending(f))
+        return FOLLOW_NONE;
+
+    // the leader may have reloaded a deck which changed
+    if(hash && f->hash && hash != f->hash && f->reloaded != f->hash) {
+        f->reloaded = f->hash;
+        return FOLLOW_RELOAD;
+    }
+
+    f->taken_sc = *sc = f->sc;
+    f->taken_stop = *stop = f->stop;
+    f->taken_hash = f->hash;
+
+    return FOLLOW_SHOW;
+}
+
+void follow_delete(follow_t *f) {
+    if(f->timer)
+        event_cancel(f->ev, f->timer);
+    if(f->fd >= 0) {
+        event_unwatch(f->ev, f->fd);
+        close(f->fd);
+    }
+
+    free(f->path);
+    free(f);
+}
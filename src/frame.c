@@ -0,0 +1,150 @@
+/*
+ * Cache of slides rendered into cell buffers.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <wchar.h>
+
+#include "frame.h"
+
+frames_t *frames_init(size_t budget) {
+    frames_t *f = calloc(1, sizeof(frames_t));
+
+    if(!f) {
+        fprintf(stderr, "%s\n", "frames_init() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+    f->budget = budget;
+
+    return f;
+}
+
+static bool key_equal(const frame_key_t *a, const frame_key_t *b) {
+    return a->slide == b->slide && a->stop == b->stop &&
+           a->lines == b->lines && a->cols == b->cols &&
+           a->max_cols == b->max_cols && a->slides == b->slides &&
+           a->more == b->more;
+}
+
+static void frame_unlink(frames_t *f, frame_t *frame) {
+    if(frame->newer)
+        frame->newer->older = frame->older;
+    else
+        f->recent = frame->older;
+    if(frame->older)
+        frame->older->newer = frame->newer;
+    else
+        f->oldest = frame->newer;
+    frame->newer = frame->older = NULL;
+}
+
+static void frame_push(frames_t *f, frame_t *frame) {
+    frame->older = f->recent;
+    frame->newer = NULL;
+    if(f->recent)
+        f->recent->newer = frame;
+    f->recent = frame;
+    if(!f->oldest)
+        f->oldest = frame;
+}
+
+static void frame_drop(frames_t *f, frame_t *frame) {
+    frame_unlink(f, frame);
+    f->resident -= frame->bytes;
+    grid_delete(frame->grid);
+    free(frame);
+}
+
+frame_t *frames_find(frames_t *f, const frame_key_t *key) {
+    frame_t *frame;
+
+    for(frame = f->recent; frame; frame = frame->older) {
+        if(key_equal(&frame->key, key))
+            return frame;
+    }
+
+    return NULL;
+}
+
+frame_t *frames_get(frames_t *f, const frame_key_t *key) {
+    frame_t *frame = frames_find(f, key);
+
+    if(!frame) {
+        f->misses++;
+        return NULL;
+    }
+
+    f->hits++;
+    if(frame != f->recent) {
+        frame_unlink(f, frame);
+        frame_push(f, frame);
+    }
+
+    return frame;
+}
+
+frame_t *frames_add(frames_t *f, const frame_key_t *key, const grid_t *g,
+                    int hidden, int passed, bool ahead) {
+    frame_t *frame;
+
+    if((frame = frames_find(f, key)))
+        frame_drop(f, frame);
+
+    if(!(frame = malloc(sizeof(frame_t)))) {
+        fprintf(stderr, "%s\n", "frames_add() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+    frame->key = *key;
+    frame->grid = grid_init(g->lines, g->cols);
+    grid_copy(frame->grid, g);
+    frame->hidden = hidden;
+    frame->passed = passed;
+    frame->bytes = sizeof(frame_t) + sizeof(grid_t) + sizeof(cell_t) * g->lines * g->cols;
+
+    frame_push(f, frame);
+    f->resident += frame->bytes;
+    if(ahead)
+        f->ahead++;
+
+    // the frame just added is kept in any case
+    while(f->resident > f->budget && f->oldest != frame) {
+        frame_drop(f, f->oldest);
+        f->evictions++;
+    }
+
+    return frame;
+}
+
+void frames_clear(frames_t *f) {
+    while(f->oldest)
+        frame_drop(f, f->oldest);
+}
+
+void frames_stats(frames_t *f) {
+    fwprintf(stderr, L"frame cache hits: %lu, misses: %lu\n", f->hits, f->misses);
+    fwprintf(stderr, L"frame cache rendered ahead: %lu, evictions: %lu\n", f->ahead, f->evictions);
+    fwprintf(stderr, L"frame cache bytes: %zu (budget: %zu)\n", f->resident, f->budget);
+}
+
+void frames_delete(frames_t *f) {
+    frames_clear(f);
+    free(f);
+}
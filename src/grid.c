@@ -0,0 +1,145 @@
+/*
+ * An in-memory grid of character cells with attributes.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#define _GNU_SOURCE // wcwidth
+
+#include <wchar.h>
+#include <stdio.h> // fprintf
+#include <stdlib.h> // malloc, free
+#include <string.h> // memcpy
+
+#include "grid.h"
+
+static void grid_alloc(grid_t *g, int lines, int cols) {
+    g->lines = lines > 0 ? lines : 1;
+    g->cols = cols > 0 ? cols : 1;
+    g->cells = malloc(sizeof(cell_t) * g->lines * g->cols);
+    if(!g->cells) {
+        fprintf(stderr, "%s\n", "grid_alloc() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+    grid_erase(g);
+}
+
+grid_t *grid_init(int lines, int cols) {
+    grid_t *g = NULL;
+    if((g = malloc(sizeof(grid_t))) != NULL) {
+        g->attr = 0;
+        grid_alloc(g, lines, cols);
+    } else {
+        fprintf(stderr, "%s\n", "grid_init() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+    return g;
+}
+
+void grid_resize(grid_t *g, int lines, int cols) {
+    if(lines == g->lines && cols == g->cols) {
+        grid_erase(g);
+        return;
+    }
+    free(g->cells);
+    grid_alloc(g, lines, cols);
+}
+
+void grid_erase(grid_t *g) {
+    int i;
+    for(i = 0; i < g->lines * g->cols; i++) {
+        g->cells[i].c = L' ';
+        g->cells[i].attr = 0;
+    }
+    g->top = 0;
+    g->bottom = g->lines;
+    g->y = g->x = 0;
+}
+
+void grid_viewport(grid_t *g, int top, int height) {
+    g->top = top < 0 ? 0 : (top > g->lines ? g->lines : top);
+    g->bottom = g->top + height > g->lines ? g->lines : g->top + height;
+    g->y = g->top;
+    g->x = 0;
+}
+
+void grid_move(grid_t *g, int y, int x) {
+    g->y = g->top + y;
+    g->x = x < 0 ? 0 : (x >= g->cols ? g->cols - 1 : x);
+}
+
+// place one char at the cursor and advance, wrapping like a ncurses window
+static void grid_addwch(grid_t *g, wchar_t c) {
+    int w = wcwidth(c);
+    cell_t *cell;
+
+    if(w < 1)
+        return;
+
+    // double width char does not fit in the rest of the row
+    if(w > 1 && g->x + w > g->cols) {
+        while(g->x < g->cols)
+            grid_addwch(g, L' ');
+    }
+
+    if(g->y < g->top || g->y >= g->bottom)
+        return;
+
+    cell = &g->cells[g->y * g->cols + g->x];
+    cell->c = c;
+    cell->attr = g->attr;
+    if(w > 1) {
+        cell[1].c = L'\0';
+        cell[1].attr = g->attr;
+    }
+
+    g->x += w;
+    if(g->x >= g->cols) {
+        // stay in the last cell of the viewport, as ncurses does
+        if(g->y + 1 >= g->bottom) {
+            g->x = g->cols - 1;
+            g->y = g->bottom;
+        } else {
+            g->x = 0;
+            g->y++;
+        }
+    }
+}
+
+void grid_addnwstr(grid_t *g, const wchar_t *s, int n) {
+    for(; n != 0 && *s; s++, n--)
+        grid_addwch(g, *s);
+}
+
+void grid_copy(grid_t *dst, const grid_t *src) {
+    if(dst->lines != src->lines || dst->cols != src->cols) {
+        free(dst->cells);
+        grid_alloc(dst, src->lines, src->cols);
+    }
+    memcpy(dst->cells, src->cells, sizeof(cell_t) * src->lines * src->cols);
+    dst->top = src->top;
+    dst->bottom = src->bottom;
+    dst->y = src->y;
+    dst->x = src->x;
+    dst->attr = src->attr;
+}
+
+void grid_delete(grid_t *g) {
+    free(g->cells);
+    free(g);
+}
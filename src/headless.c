@@ -0,0 +1,216 @@
+/*
+ * An output backend rendering into an in-memory cell grid, without any
+ * terminal attached.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <wchar.h>
+#include <stdio.h>  // fprintf
+#include <stdlib.h> // malloc, free
+#include <string.h> // strdup
+
+#if defined( WIN32 )
+#include <curses.h>
+#else
+#include <ncurses.h> // ERR, so key codes match the ncurses backend
+#endif
+
+#include "render.h"
+
+#define HL_MAX_PAIRS 256
+
+typedef struct _headless_data_t {
+    grid_t *grid;
+    short pairs[HL_MAX_PAIRS][2];
+    int bkgd;          // attribute of blank cells
+    char *keys;        // scripted key presses
+    const char *next;  // next key to return
+} headless_data_t;
+
+#define HL(self) ((headless_data_t *)(self)->data)
+
+static bool headless_open(render_t *self) {
+    return true;
+}
+
+static void headless_close(render_t *self) {
+}
+
+static void headless_init_pair(render_t *self, int pair, int fg, int bg) {
+    if(pair > 0 && pair < HL_MAX_PAIRS) {
+        HL(self)->pairs[pair][0] = fg;
+        HL(self)->pairs[pair][1] = bg;
+    }
+}
+
+static void headless_bkgd(render_t *self, int attr) {
+    HL(self)->bkgd = attr;
+}
+
+static void headless_erase(render_t *self) {
+    grid_t *g = HL(self)->grid;
+    if(g->lines != self->lines || g->cols != self->cols)
+        grid_resize(g, self->lines, self->cols);
+    grid_erase(g);
+}
+
+static void headless_viewport(render_t *self, int top, int height) {
+    grid_viewport(HL(self)->grid, top, height);
+}
+
+static void headless_move(render_t *self, int y, int x) {
+    grid_move(HL(self)->grid, y, x);
+}
+
+static void headless_addnwstr(render_t *self, const wchar_t *s, int n) {
+    grid_addnwstr(HL(self)->grid, s, n);
+}
+
+static void headless_attron(render_t *self, int attr) {
+    grid_t *g = HL(self)->grid;
+    if(GA_PAIR(attr))
+        g->attr = (g->attr & ~0xff) | GA_PAIR(attr);
+    g->attr |= attr & ~0xff;
+}
+
+static void headless_attroff(render_t *self, int attr) {
+    grid_t *g = HL(self)->grid;
+    if(GA_PAIR(attr))
+        g->attr &= ~0xff;
+    g->attr &= ~(attr & ~0xff);
+}
+
+static int headless_getx(render_t *self) {
+    return HL(self)->grid->x;
+}
+
+static bool headless_blit(render_t *self, const grid_t *g) {
+    if(g->lines != self->lines || g->cols != self->cols)
+        return false;
+
+    grid_copy(HL(self)->grid, g);
+    return true;
+}
+
+static void headless_flush(render_t *self) {
+    self->frames++;
+}
+
+static int headless_getkey(render_t *self, int timeout) {
+    headless_data_t *d = HL(self);
+
+    // no more scripted keys, behave like a closed terminal
+    if(!d->next || !*d->next)
+        return ERR;
+
+    return (unsigned char) *d->next++;
+}
+
+static void headless_delete(render_t *self) {
+    headless_data_t *d = HL(self);
+
+    grid_delete(d->grid);
+    free(d->keys);
+    free(d);
+    free(self);
+}
+
+render_t *render_headless_init(int lines, int cols) {
+    render_t *x = render_new();
+    headless_data_t *d = NULL;
+
+    if((d = calloc(1, sizeof(headless_data_t))) == NULL) {
+        fprintf(stderr, "%s\n", "render_headless_init() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+    d->grid = grid_init(lines, cols);
+
+    x->lines = d->grid->lines;
+    x->cols = d->grid->cols;
+    x->colors = 1;
+    x->data = d;
+    x->open = headless_open;
+    x->close = headless_close;
+    x->init_pair = headless_init_pair;
+    x->bkgd = headless_bkgd;
+    x->erase = headless_erase;
+    x->viewport = headless_viewport;
+    x->move = headless_move;
+    x->addnwstr = headless_addnwstr;
+    x->attron = headless_attron;
+    x->attroff = headless_attroff;
+    x->getx = headless_getx;
+    x->blit = headless_blit;
+    x->flush = headless_flush;
+    x->getkey = headless_getkey;
+    x->delete = headless_delete;
+    return x;
+}
+
+void render_headless_input(render_t *self, const char *keys) {
+    headless_data_t *d = HL(self);
+
+    free(d->keys);
+    d->keys = keys ? strdup(keys) : NULL;
+    d->next = d->keys;
+}
+
+const grid_t *render_headless_grid(render_t *self) {
+    return HL(self)->grid;
+}
+
+void render_headless_dump(render_t *self, FILE *out, bool ansi) {
+    headless_data_t *d = HL(self);
+    grid_t *g = d->grid;
+    cell_t *cell;
+    int y, x, eol, attr, prev, pair;
+
+    for(y = 0; y < g->lines; y++) {
+        cell = &g->cells[y * g->cols];
+
+        // trailing blanks are only visible in color
+        eol = g->cols;
+        if(!ansi)
+            while(eol > 0 && cell[eol - 1].c == L' ')
+                eol--;
+
+        prev = -1;
+        for(x = 0; x < eol; x++) {
+            if(ansi) {
+                attr = GA_PAIR(cell[x].attr) ? cell[x].attr : cell[x].attr | GA_PAIR(d->bkgd);
+                if(attr != prev) {
+                    fprintf(out, "\033[0");
+                    if(attr & GA_UNDERLINE)
+                        fprintf(out, ";4");
+                    if(attr & GA_REVERSE)
+                        fprintf(out, ";7");
+                    pair = GA_PAIR(attr);
+                    if(pair && pair < HL_MAX_PAIRS)
+                        fprintf(out, ";3%d;4%d", d->pairs[pair][0], d->pairs[pair][1]);
+                    fprintf(out, "m");
+                    prev = attr;
+                }
+            }
+            // skip right half of double width chars
+            if(cell[x].c)
+                fprintf(out, "%lc", (wint_t) cell[x].c);
+        }
+        fprintf(out, "%s\n", ansi ? "\033[0m" : "");
+    }
+}
@@ -0,0 +1,292 @@
+/*
+ * Reading decks, plain or compressed with gzip or zstd.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#define _GNU_SOURCE // fopencookie
+
+#include <errno.h>
+#include <limits.h> // UINT_MAX
+#include <stdbool.h>
+#include <stdlib.h> // calloc, malloc, free
+#include <string.h> // memcpy
+
+#if defined( HAVE_ZLIB )
+#include <zlib.h>
+#endif
+
+#if defined( HAVE_ZSTD )
+#include <zstd.h>
+#endif
+
+#include "input.h"
+
+// bytes decompressed at once, the parser reads lines from this buffer
+#define INPUT_BUFFER 65536
+
+// the input of a stream, the magic bytes read to recognize its format
+// are returned first
+typedef struct _source_t {
+    FILE *file;
+    unsigned char head[4];
+    size_t head_size;
+    size_t head_pos;
+} source_t;
+
+static size_t source_read(source_t *s, void *buf, size_t size) {
+    size_t n = s->head_size - s->head_pos;
+
+    if(n > size)
+        n = size;
+    memcpy(buf, &s->head[s->head_pos], n);
+    s->head_pos += n;
+
+    if(n < size)
+        n += fread((char *) buf + n, 1, size - n, s->file);
+    return n;
+}
+
+// plain text of a pipe
+static ssize_t plain_read(void *cookie, char *buf, size_t size) {
+    source_t *s = cookie;
+    size_t n = source_read(s, buf, size);
+
+    if(n == 0 && ferror(s->file)) {
+        errno = EIO;
+        return -1;
+    }
+    return n;
+}
+
+static int plain_close(void *cookie) {
+    source_t *s = cookie;
+    int ret = fclose(s->file);
+
+    free(s);
+    return ret;
+}
+
+static FILE *plain_open(const source_t *src) {
+    cookie_io_functions_t io = { plain_read, NULL, NULL, plain_close };
+    source_t *s;
+
+    if((s = malloc(sizeof(source_t))) == NULL) {
+        fprintf(stderr, "%s\n", "plain_open() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+    *s = *src;
+
+    return fopencookie(s, "r", io);
+}
+
+#if defined( HAVE_ZLIB )
+typedef struct _gzip_input_t {
+    source_t src;
+    z_stream stream;
+    bool member;       // inside a gzip member, the input must not end here
+    unsigned char in[INPUT_BUFFER];
+} gzip_input_t;
+
+static ssize_t gzip_read(void *cookie, char *buf, size_t size) {
+    gzip_input_t *z = cookie;
+    uInt avail = size > UINT_MAX ? UINT_MAX : size;
+    uInt in, out;
+    int ret;
+
+    z->stream.next_out = (Bytef *) buf;
+    z->stream.avail_out = avail;
+
+    while(z->stream.avail_out == avail) {
+        if(z->stream.avail_in == 0) {
+            z->stream.next_in = z->in;
+            z->stream.avail_in = source_read(&z->src, z->in, sizeof(z->in));
+            if(z->stream.avail_in == 0 && ferror(z->src.file)) {
+                errno = EIO;
+                return -1;
+            }
+            if(z->stream.avail_in == 0 && !z->member)
+                return 0;
+        }
+
+        in = z->stream.avail_in;
+        out = z->stream.avail_out;
+        ret = inflate(&z->stream, Z_NO_FLUSH);
+        if(ret == Z_STREAM_END) {
+            // another member may follow
+            inflateReset(&z->stream);
+            z->member = false;
+        } else if(ret == Z_OK || ret == Z_BUF_ERROR) {
+            z->member = true;
+        } else {
+            errno = EIO;
+            return -1;
+        }
+
+        // output of input read already may be due once the input ends,
+        // the member is truncated only if nothing is left
+        if(ret != Z_STREAM_END && z->stream.avail_in == in && z->stream.avail_out == out) {
+            errno = EIO;
+            return -1;
+        }
+    }
+
+    return avail - z->stream.avail_out;
+}
+
+static int gzip_close(void *cookie) {
+    gzip_input_t *z = cookie;
+    int ret = fclose(z->src.file);
+
+    inflateEnd(&z->stream);
+    free(z);
+    return ret;
+}
+
+static FILE *gzip_open(const source_t *src) {
+    cookie_io_functions_t io = { gzip_read, NULL, NULL, gzip_close };
+    gzip_input_t *z;
+
+    if((z = calloc(1, sizeof(gzip_input_t))) == NULL) {
+        fprintf(stderr, "%s\n", "gzip_open() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+    z->src = *src;
+
+    // gzip framing only
+    if(inflateInit2(&z->stream, 16 + MAX_WBITS) != Z_OK) {
+        fprintf(stderr, "%s\n", "gzip_open() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+
+    return fopencookie(z, "r", io);
+}
+#endif // defined( HAVE_ZLIB )
+
+#if defined( HAVE_ZSTD )
+typedef struct _zstd_input_t {
+    source_t src;
+    ZSTD_DStream *stream;
+    ZSTD_inBuffer in;
+    size_t pending; // result of the last decompression, 0 at a frame end
+} zstd_input_t;
+
+static ssize_t zstd_read(void *cookie, char *buf, size_t size) {
+    zstd_input_t *z = cookie;
+    ZSTD_outBuffer out = { buf, size, 0 };
+    size_t pos;
+
+    while(out.pos == 0) {
+        if(z->in.pos == z->in.size) {
+            z->in.size = source_read(&z->src, (void *) z->in.src, ZSTD_DStreamInSize());
+            z->in.pos = 0;
+            if(z->in.size == 0 && ferror(z->src.file)) {
+                errno = EIO;
+                return -1;
+            }
+            if(z->in.size == 0 && !z->pending)
+                return 0;
+        }
+
+        pos = z->in.pos;
+        z->pending = ZSTD_decompressStream(z->stream, &out, &z->in);
+        if(ZSTD_isError(z->pending)) {
+            errno = EIO;
+            return -1;
+        }
+
+        // the decoder may still hold output once the input ends, the
+        // frame is truncated only if nothing is left
+        if(z->in.size == 0 && z->in.pos == pos && out.pos == 0) {
+            errno = EIO;
+            return -1;
+        }
+    }
+
+    return out.pos;
+}
+
+static int zstd_close(void *cookie) {
+    zstd_input_t *z = cookie;
+    int ret = fclose(z->src.file);
+
+    ZSTD_freeDStream(z->stream);
+    free((void *) z->in.src);
+    free(z);
+    return ret;
+}
+
+static FILE *zstd_open(const source_t *src) {
+    cookie_io_functions_t io = { zstd_read, NULL, NULL, zstd_close };
+    zstd_input_t *z;
+
+    if((z = calloc(1, sizeof(zstd_input_t))) == NULL ||
+       (z->in.src = malloc(ZSTD_DStreamInSize())) == NULL) {
+        fprintf(stderr, "%s\n", "zstd_open() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+    z->src = *src;
+    z->stream = ZSTD_createDStream();
+    ZSTD_initDStream(z->stream);
+
+    return fopencookie(z, "r", io);
+}
+#endif // defined( HAVE_ZSTD )
+
+FILE *input_open(const char *file) {
+    FILE *input = fopen(file, "r");
+
+    return input ? input_probe(input) : NULL;
+}
+
+FILE *input_probe(FILE *input) {
+    source_t src = { input, { 0 }, 0, 0 };
+    unsigned char *magic = src.head;
+    long start = ftell(input);
+
+    // a pipe cannot be read again, the bytes go to the stream returned
+    src.head_size = fread(src.head, 1, sizeof(src.head), input);
+
+    if(src.head_size >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+#if defined( HAVE_ZLIB )
+        input = gzip_open(&src);
+#else
+        fclose(input);
+        input = NULL;
+        errno = ENOTSUP;
+#endif
+    } else if(src.head_size == 4 &&
+              magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) {
+#if defined( HAVE_ZSTD )
+        input = zstd_open(&src);
+#else
+        fclose(input);
+        input = NULL;
+        errno = ENOTSUP;
+#endif
+    } else if(start < 0 || fseek(input, start, SEEK_SET) != 0) {
+        clearerr(input);
+        input = plain_open(&src);
+    }
+    // a plain file is read again from the start, it can still be seeked
+
+    if(input)
+        setvbuf(input, NULL, _IOFBF, INPUT_BUFFER);
+
+    return input;
+}
@@ -0,0 +1,169 @@
+/*
+ * Table mapping keys to the actions of the viewer.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>  // fopen, getline
+#include <stdlib.h> // calloc, strtol, free
+#include <string.h> // strcmp, strtok
+
+#include "keymap.h"
+
+static const struct {
+    const char *name;
+    action_t action;
+} action_names[] = {
+    { "none",        ACTION_NONE },
+    { "prev",        ACTION_PREV },
+    { "next",        ACTION_NEXT },
+    { "first",       ACTION_FIRST },
+    { "last",        ACTION_LAST },
+    { "goto",        ACTION_GOTO },
+    { "reload",      ACTION_RELOAD },
+    { "quit",        ACTION_QUIT },
+    { "search",      ACTION_SEARCH },
+    { "search-next", ACTION_SEARCH_NEXT },
+    { "search-prev", ACTION_SEARCH_PREV },
+    { "toc",         ACTION_TOC },
+    { "overview",    ACTION_OVERVIEW },
+    { "pager",       ACTION_PAGER },
+    { "reveal",      ACTION_REVEAL },
+    { NULL,          ACTION_NONE }
+};
+
+static const struct {
+    const char *name;
+    int key;
+} key_names[] = {
+    { "space",     ' ' },
+    { "enter",     '\n' },
+    { "tab",       '\t' },
+    { "backspace", KEY_BACKSPACE },
+    { "up",        KEY_UP },
+    { "down",      KEY_DOWN },
+    { "left",      KEY_LEFT },
+    { "right",     KEY_RIGHT },
+    { "pageup",    KEY_PPAGE },
+    { "pagedown",  KEY_NPAGE },
+    { "home",      KEY_HOME },
+    { "end",       KEY_END },
+    { NULL,        0 }
+};
+
+keymap_t *keymap_init(void) {
+    keymap_t *km = calloc(1, sizeof(keymap_t));
+
+    if(!km) {
+        fprintf(stderr, "%s\n", "keymap_init() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+
+    return km;
+}
+
+void keymap_bind(keymap_t *km, const int keys[], action_t action) {
+    for(; *keys; keys++)
+        if(*keys > 0 && *keys < KEYMAP_KEYS)
+            km->action[*keys] = action;
+}
+
+// key code of a name, -1 if it is none
+static int key_parse(const char *s) {
+    char *end;
+    long code;
+    int i;
+
+    if(s[0] && !s[1])
+        return (unsigned char) s[0];
+
+    if(s[0] == '^' && s[1] && !s[2])
+        return s[1] == '?' ? 127 : s[1] & 0x1f;
+
+    for(i = 0; key_names[i].name; i++)
+        if(!strcmp(s, key_names[i].name))
+            return key_names[i].key;
+
+    code = strtol(s, &end, 10);
+    return (*end || code <= 0 || code >= KEYMAP_KEYS) ? -1 : code;
+}
+
+static int action_parse(const char *s) {
+    int i;
+
+    for(i = 0; action_names[i].name; i++)
+        if(!strcmp(s, action_names[i].name))
+            return action_names[i].action;
+
+    return -1;
+}
+
+int keymap_load(keymap_t *km, const char *file) {
+    FILE *in = fopen(file, "r");
+    char *line = NULL;
+    size_t size = 0;
+    char *cmd, *key, *name, *extra;
+    int ln = 0, errors = 0;
+    int c, action;
+
+    if(!in)
+        return -1;
+
+    while(getline(&line, &size, in) != -1) {
+        ln++;
+        if(!(cmd = strtok(line, " \t\r\n")) || *cmd == '#')
+            continue;
+        key = strtok(NULL, " \t\r\n");
+        name = strtok(NULL, " \t\r\n");
+        extra = strtok(NULL, " \t\r\n");
+
+        if(!strcmp(cmd, "map") && key && name && !extra) {
+            if((c = key_parse(key)) < 0 || (c >= '0' && c <= '9')) {
+                fprintf(stderr, "%s:%d: invalid key '%s'\n", file, ln, key);
+            } else if((action = action_parse(name)) < 0) {
+                fprintf(stderr, "%s:%d: unknown action '%s'\n", file, ln, name);
+            } else {
+                km->action[c] = action;
+                continue;
+            }
+        } else if(!strcmp(cmd, "unmap") && key && !name) {
+            if((c = key_parse(key)) < 0) {
+                fprintf(stderr, "%s:%d: invalid key '%s'\n", file, ln, key);
+            } else {
+                km->action[c] = ACTION_NONE;
+                continue;
+            }
+        } else {
+            fprintf(stderr, "%s:%d: expected 'map KEY ACTION' or 'unmap KEY'\n", file, ln);
+        }
+        errors++;
+    }
+
+    free(line);
+    fclose(in);
+
+    return errors;
+}
+
+action_t keymap_action(const keymap_t *km, int c) {
+    return (c > 0 && c < KEYMAP_KEYS) ? km->action[c] : ACTION_NONE;
+}
+
+void keymap_delete(keymap_t *km) {
+    free(km);
+}
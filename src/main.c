@@ -17,26 +17,52 @@
  *
  */
 
+#include <dirent.h> // scandir
 #include <errno.h>
 #include <getopt.h>
+#include <limits.h> // PATH_MAX
 #include <locale.h> // setlocale
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h> // access
 
 #include "main.h"
 
 void usage() {
-    fprintf(stderr, "%s", "Usage: mdp [OPTION]... [FILE]\n");
+    fprintf(stderr, "%s", "Usage: mdp [OPTION]... [FILE]...\n");
     fprintf(stderr, "%s", "A command-line based markdown presentation tool.\n\n");
+    fprintf(stderr, "%s", "  -a, --include-any follow include directives to files outside the directory\n");
+    fprintf(stderr, "%s", "                    of the deck\n");
     fprintf(stderr, "%s", "  -d, --debug       enable debug messages on STDERR\n");
     fprintf(stderr, "%s", "                    add it multiple times to increases debug level\n");
     fprintf(stderr, "%s", "  -e, --expand      enable character entity expansion\n");
+    fprintf(stderr, "%s", "  -f, --frames=SIZE keep at most SIZE bytes of rendered slides to show them\n");
+    fprintf(stderr, "%s", "                    again at once, 0 disables it (default 4M)\n");
+    fprintf(stderr, "%s", "  -F, --follow=PATH show the slides of the viewer started with --remote=PATH,\n");
+    fprintf(stderr, "%s", "                    the deck is reloaded if it differs from the one shown\n");
     fprintf(stderr, "%s", "  -h, --help        display this help and exit\n");
+    fprintf(stderr, "%s", "  -k, --keymap=FILE read key bindings from FILE instead of\n");
+    fprintf(stderr, "%s", "                    $XDG_CONFIG_HOME/smdp/keymap\n");
+    fprintf(stderr, "%s", "  -l, --lazy        parse slides when shown, for a fast start with large files\n");
+    fprintf(stderr, "%s", "  -m, --cache=SIZE  like --lazy, but keep at most SIZE bytes of parsed slides\n");
+    fprintf(stderr, "%s", "                    in memory, a K, M or G suffix may follow\n");
+    fprintf(stderr, "%s", "  -o, --presenter=TTY\n");
+    fprintf(stderr, "%s", "                    show the next slide and the notes of the slide on the\n");
+    fprintf(stderr, "%s", "                    terminal TTY, e.g. /dev/pts/3, keys typed there work too\n");
+    fprintf(stderr, "%s", "  -p, --print       print all slides as plain text to STDOUT and exit\n");
+    fprintf(stderr, "%s", "  -P, --print-ansi  print all slides with ANSI colors to STDOUT and exit\n");
+    fprintf(stderr, "%s", "  -r, --remote=PATH accept commands like next, prev or goto N on the Unix\n");
+    fprintf(stderr, "%s", "                    socket PATH, each is answered with the state shown\n");
     fprintf(stderr, "%s", "  -s, --noslidenum  do not show slide number at the bottom\n");
+    fprintf(stderr, "%s", "  -t, --vt100       write VT100 escape sequences directly instead of using ncurses\n");
     fprintf(stderr, "%s", "  -v, --version     display the version number and license\n");
+    fprintf(stderr, "%s", "  -w, --watch       reload the deck when its files change\n");
     fprintf(stderr, "%s", "  -x, --noslidemax  show slide number, but not total number of slides\n");
-    fprintf(stderr, "%s", "\nWith no FILE, or when FILE is -, read standard input.\n\n");
+    fprintf(stderr, "%s", "\nWith no FILE, or when FILE is -, read standard input.\n");
+    fprintf(stderr, "%s", "FILE may be compressed with gzip or zstd. Several FILEs, or a directory\n");
+    fprintf(stderr, "%s", "of *.md files, are shown as one deck, each file starting a new slide.\n\n");
     exit(EXIT_FAILURE);
 }
 
@@ -50,33 +76,206 @@ void version() {
     exit(EXIT_SUCCESS);
 }
 
+size_t parse_size(const char *arg) {
+    char *end;
+    unsigned long long size = strtoull(arg, &end, 10);
+
+    switch(*end) {
+        case 'G': case 'g': size *= 1024; // fall through
+        case 'M': case 'm': size *= 1024; // fall through
+        case 'K': case 'k': size *= 1024; end++; break;
+        default: break;
+    }
+
+    // reject trailing garbage
+    return (end == arg || *end) ? 0 : size;
+}
+
+// bindings of config.h, changed by the keymap file given or the one in the
+// config directory, which may not exist
+static keymap_t *load_keymap(const char *prog, const char *file) {
+    keymap_t *km = default_keymap();
+    char path[PATH_MAX];
+    const char *dir;
+    int errors;
+
+    if(!file) {
+        if((dir = getenv("XDG_CONFIG_HOME")) && *dir)
+            snprintf(path, sizeof(path), "%s/smdp/keymap", dir);
+        else if((dir = getenv("HOME")))
+            snprintf(path, sizeof(path), "%s/.config/smdp/keymap", dir);
+        else
+            return km;
+        if(access(path, F_OK))
+            return km;
+        file = path;
+    }
+
+    if((errors = keymap_load(km, file)) < 0) {
+        fprintf(stderr, "%s: %s: %s\n", prog, file, strerror(errno));
+        exit(EXIT_FAILURE);
+    } else if(errors) {
+        exit(EXIT_FAILURE);
+    }
+
+    return km;
+}
+
+static int is_chapter(const struct dirent *entry) {
+    size_t len = strlen(entry->d_name);
+
+    return entry->d_name[0] != '.' && len > 3 && !strcmp(&entry->d_name[len - 3], ".md");
+}
+
+static void add_chapter(FILE *out, const char *dir, const char *name, int *chapters) {
+    fprintf(out, "%s%s%s%s%s\n",
+            (*chapters)++ ? "\n---\n\n" : "", "!include ",
+            dir ? dir : "", dir ? "/" : "", name);
+}
+
+// a deck of several files, a directory stands for its *.md files in sorted
+// order, the files are included by a generated deck, each starting a slide
+static FILE *open_chapters(char **files, int n, const char **failed) {
+    struct dirent **list;
+    struct stat st;
+    FILE *out, *input = NULL;
+    char *text = NULL;
+    size_t size = 0;
+    int chapters = 0;
+    int i, j, count;
+
+    if((out = open_memstream(&text, &size)) == NULL)
+        return NULL;
+
+    for(i = 0; i < n; i++) {
+        *failed = files[i];
+
+        // standard input could not be read again
+        if(!strcmp(files[i], "-")) {
+            errno = EINVAL;
+            break;
+        }
+        if(stat(files[i], &st) != 0)
+            break;
+
+        if(!S_ISDIR(st.st_mode)) {
+            add_chapter(out, NULL, files[i], &chapters);
+            continue;
+        }
+
+        if((count = scandir(files[i], &list, is_chapter, alphasort)) < 0)
+            break;
+        for(j = 0; j < count; j++) {
+            add_chapter(out, files[i], list[j]->d_name, &chapters);
+            free(list[j]);
+        }
+        free(list);
+
+        if(count == 0) {
+            errno = ENOENT;
+            break;
+        }
+    }
+    fclose(out);
+
+    // the deck is read from memory, which can be seeked like a file,
+    // with room for the null byte written on flush
+    if(i == n && (input = fmemopen(NULL, size + 1, "w+")) != NULL) {
+        fwrite(text, 1, size, input);
+        rewind(input);
+    }
+    free(text);
+
+    return input;
+}
+
+// open the files of a deck, chapters is set if there is more than one,
+// failed is set to the file which could not be opened
+FILE *open_deck(char **files, int n, const char **failed, bool *chapters) {
+    struct stat st;
+
+    *chapters = n > 1 || (stat(files[0], &st) == 0 && S_ISDIR(st.st_mode));
+    if(*chapters)
+        return open_chapters(files, n, failed);
+
+    *failed = files[0];
+    return input_open(files[0]);
+}
+
 int main(int argc, char *argv[]) {
     int noexpand = 1;  // disable character entity expansion
     int reload = 0;    // reload page N (0 means no reload)
     int noreload = 1;  // reload disabled until we know input is a file
     int slidenum = 2;  // 0:don't show; 1:show #; 2:show #/#
+    int vt100 = 0;     // use ncurses for output
+    int print = 0;     // 0:interactive; 1:print plain text; 2:print ANSI
+    int lazy = 0;      // parse all slides before the first is shown
+    int any = 0;       // include files in the directory of the deck only
+    size_t cache = 0;  // no limit of parsed slides in memory
+    size_t budget = FRAME_CACHE; // bytes of rendered slides in memory
+    const char *keys = NULL;     // keymap file, the default one if NULL
+    const char *control = NULL;  // socket of the remote control, none if NULL
+    const char *leader = NULL;   // socket of the viewer to follow, none if NULL
+    const char *tty = NULL;      // terminal of the presenter view, none if NULL
+    int autoreload = 0;          // reload only if asked to by a key
 
     // define command-line options
     struct option longopts[] = {
+        { "include-any", no_argument, 0, 'a' },
         { "debug",      no_argument, 0, 'd' },
         { "expand",     no_argument, 0, 'e' },
+        { "frames",     required_argument, 0, 'f' },
+        { "follow",     required_argument, 0, 'F' },
         { "help",       no_argument, 0, 'h' },
+        { "keymap",     required_argument, 0, 'k' },
+        { "lazy",       no_argument, 0, 'l' },
+        { "cache",      required_argument, 0, 'm' },
         { "version",    no_argument, 0, 'v' },
         { "noslidenum", no_argument, 0, 's' },
         { "noslidemax", no_argument, 0, 'x' },
+        { "vt100",      no_argument, 0, 't' },
+        { "print",      no_argument, 0, 'p' },
+        { "print-ansi", no_argument, 0, 'P' },
+        { "presenter",  required_argument, 0, 'o' },
+        { "remote",     required_argument, 0, 'r' },
+        { "watch",      no_argument, 0, 'w' },
         { 0, 0, 0, 0 }
     };
 
     // parse command-line options
     int opt, debug = 0;
-    while ((opt = getopt_long(argc, argv, ":defhitvsxc", longopts, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, ":adef:F:hik:lm:o:r:tvswxcpP", longopts, NULL)) != -1) {
         switch(opt) {
+            case 'a': any = 1;      break;
             case 'd': debug += 1;   break;
             case 'e': noexpand = 0; break;
+            case 'f':
+                // 0 is valid here, unlike the result of a failed parse
+                if(!(budget = parse_size(optarg)) && strcmp(optarg, "0")) {
+                    fprintf(stderr, "%s: invalid frame cache size '%s'\n", argv[0], optarg);
+                    usage();
+                }
+                break;
+            case 'F': leader = optarg; break;
             case 'h': usage();      break;
+            case 'k': keys = optarg; break;
+            case 'l': lazy = 1;     break;
+            case 'm':
+                lazy = 1;
+                if(!(cache = parse_size(optarg))) {
+                    fprintf(stderr, "%s: invalid cache size '%s'\n", argv[0], optarg);
+                    usage();
+                }
+                break;
             case 'v': version();    break;
             case 's': slidenum = 0; break;
+            case 'w': autoreload = 1; break;
             case 'x': slidenum = 1; break;
+            case 't': vt100 = 1;    break;
+            case 'p': print = 1;    break;
+            case 'P': print = 2;    break;
+            case 'o': tty = optarg; break;
+            case 'r': control = optarg; break;
             case ':': fprintf(stderr, "%s: '%c' requires an argument\n", argv[0], optopt); usage(); break;
             case '?':
             default : fprintf(stderr, "%s: option '%c' is invalid\n", argv[0], optopt); usage(); break;
@@ -90,27 +289,118 @@ int main(int argc, char *argv[]) {
     // setup list string
     setup_list_strings();
 
-    // open file or set input to STDIN
-    char *file = NULL;
+    // open files or set input to STDIN
+    char **files = &argv[optind];
+    int nfiles = argc - optind;
+    const char *file = NULL;
+    const char *failed = NULL;
+    bool chapters = false;
     FILE *input;
-    if (optind < argc) {
-        do {
-            file = argv[optind];
-        } while(++optind < argc);
+    if (nfiles > 1 || (nfiles == 1 && strcmp(files[0], "-"))) {
+        input = open_deck(files, nfiles, &failed, &chapters);
+        if(!input) {
+            fprintf(stderr, "%s: %s: %s\n", argv[0], failed, strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        // enable reload because input is a file
+        noreload = 0;
+        file = files[0];
 
-        if(!strcmp(file, "-")) {
-            input = stdin;
+        if(chapters) {
+            // parse chapters when they are reached
+            lazy = 1;
+            markdown_include_scope(INCLUDE_CHAPTER);
         } else {
-            input = fopen(file,"r");
-            if(!input) {
-                fprintf(stderr, "%s: %s: %s\n", argv[0], file, strerror(errno));
+            // included files are relative to the deck
+            markdown_include_base(file);
+        }
+    } else {
+        // standard input may be compressed too
+        input = input_probe(stdin);
+        if(!input) {
+            fprintf(stderr, "%s: %s: %s\n", argv[0], "-", strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // a deck may only show files next to it, unless told otherwise
+    if(any)
+        markdown_include_scope(INCLUDE_ANY);
+
+    // notes are hidden only if they can be shown to the presenter
+    markdown_notes(tty != NULL);
+
+    // setup output backend
+    render_t *render;
+    search_t *search = NULL;
+    frames_t *frames = NULL;
+    event_t *events = NULL;
+    keymap_t *keymap = NULL;
+    remote_t *remote = NULL;
+    follow_t *follow = NULL;
+    watch_t *watch = NULL;
+    render_t *presenter = NULL;
+    if(print) {
+        int lines, cols;
+        render_geometry(&lines, &cols);
+        render = render_headless_init(lines, cols);
+        noreload = 1;
+    } else {
+        render = vt100 ? render_vt100_init() : render_ncurses_init();
+
+        // index the slides for searching, unchanged slides are kept
+        // across reloads
+        search = search_init();
+        markdown_search(search);
+
+        // keep rendered slides to show them again with a single copy
+        frames = budget ? frames_init(budget) : NULL;
+        ncurses_frames(frames);
+
+        // actions of the keys
+        keymap = load_keymap(argv[0], keys);
+        ncurses_keymap(keymap);
+
+        // wait for keys, timers and other input in one loop
+        events = event_init();
+        ncurses_events(events);
+
+        // commands of clickers and scripts, served by the same loop
+        if(control) {
+            remote = remote_init(events, control);
+            if(!remote) {
+                fprintf(stderr, "%s: %s: %s\n", argv[0], control, strerror(errno));
                 exit(EXIT_FAILURE);
             }
-            // enable reload because input is a file
-            noreload = 0;
+            ncurses_remote(remote);
+        }
+
+        // show what another viewer shows
+        if(leader) {
+            follow = follow_init(events, leader);
+            if(!follow) {
+                fprintf(stderr, "%s: %s: %s\n", argv[0], leader, strerror(errno));
+                exit(EXIT_FAILURE);
+            }
+            ncurses_follow(follow);
+        }
+
+        // reload the deck when it is saved, a pipe is read only once
+        if(autoreload && file) {
+            watch = watch_init(events, files, nfiles);
+            ncurses_watch(watch);
+        }
+
+        // the presenter view, drawn from the slides rendered for the
+        // audience
+        if(tty) {
+            presenter = render_vt100_tty(tty);
+            if(!presenter) {
+                fprintf(stderr, "%s: %s: %s\n", argv[0], tty, strerror(errno));
+                exit(EXIT_FAILURE);
+            }
+            ncurses_presenter(presenter);
         }
-    } else {
-        input = stdin;
     }
 
     // reload loop
@@ -119,9 +409,9 @@ int main(int argc, char *argv[]) {
         // reopen input file on reload
         if(noreload == 0 && reload > 0) {
             if(file) {
-                input = fopen(file,"r");
+                input = open_deck(files, nfiles, &failed, &chapters);
                 if(!input) {
-                    fprintf(stderr, "%s: %s: %s\n", argv[0], file, strerror(errno));
+                    fprintf(stderr, "%s: %s: %s\n", argv[0], failed, strerror(errno));
                     exit(EXIT_FAILURE);
                 }
             } else {
@@ -132,10 +422,30 @@ int main(int argc, char *argv[]) {
 
         // load deck object from input
         deck_t *deck;
-        deck = markdown_load(input, noexpand);
+        if(lazy && noreload == 0) {
+            // the deck keeps the file open to parse slides on demand
+            deck = markdown_index(input, noexpand);
+            markdown_cache(deck, cache);
+        } else {
+            deck = markdown_load(input, noexpand);
 
-        // close file
-        fclose(input);
+            // close file
+            fclose(input);
+        }
+
+        // print slides without terminal interaction
+        if(print) {
+            if(debug > 0) {
+                markdown_debug(deck, debug);
+            }
+            reload = print_deck(deck, render, slidenum, print == 2) ? 0 : -1;
+            markdown_invalid(deck, file ? file : "-");
+            if(debug > 0) {
+                markdown_stats(deck);
+            }
+            free_deck(deck);
+            break;
+        }
 
         // replace stdin with current tty if input was a pipe
         // if input was a pipe reload is disabled, so we simply check that
@@ -151,12 +461,48 @@ int main(int argc, char *argv[]) {
             markdown_debug(deck, debug);
         }
 
-        reload = ncurses_display(deck, reload, noreload, slidenum);
+        reload = ncurses_display(deck, render, reload, noreload, slidenum);
+
+        // the terminal is restored, so warnings are visible now
+        markdown_invalid(deck, file ? file : "-");
+
+        if(debug > 0) {
+            markdown_stats(deck);
+        }
 
         free_deck(deck);
 
     // reload if supported and requested
     } while(noreload == 0 && reload > 0);
 
+    if(debug > 0) {
+        render_stats(render);
+        if(search)
+            search_stats(search);
+        if(frames)
+            frames_stats(frames);
+    }
+
+    if(search)
+        search_delete(search);
+    if(frames)
+        frames_delete(frames);
+    if(follow)
+        follow_delete(follow);
+    if(watch)
+        watch_delete(watch);
+    if(remote)
+        remote_delete(remote);
+    if(events)
+        event_delete(events);
+    if(keymap)
+        keymap_delete(keymap);
+    if(presenter)
+        (presenter->delete)(presenter);
+    (render->delete)(render);
+
+    if(reload < 0)
+        return EXIT_FAILURE;
+
     return EXIT_SUCCESS;
 }
@@ -21,8 +21,11 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <wchar.h> // wmemcpy
 
+#include "display.h"
 #include "markdown.h"
+#include "utf8.h"
 
 line_t *new_line() {
     line_t *x = malloc(sizeof(line_t));
@@ -42,8 +45,19 @@ line_t *next_line(line_t *prev) {
 slide_t *new_slide() {
     slide_t *x = malloc(sizeof(slide_t));
     x->line = NULL;
+    x->pack = NULL;
+    x->first = 0;
     x->prev = x->next = NULL;
-    x->lines = x->stop = 0;
+    x->lines = x->stop = x->lines_consumed = 0;
+    x->offset = 0;
+    x->length = 0;
+    x->skip = 0;
+    x->loaded = true;
+    x->stop_last = false;
+    x->newer = x->older = NULL;
+    x->bytes = 0;
+    x->display = NULL;
+    x->notes = NULL;
     return x;
 }
 
@@ -59,6 +73,16 @@ deck_t *new_deck() {
     x->header = NULL;
     x->slide = new_slide();
     x->slides = x->headers = 0;
+    x->pack = NULL;
+    x->input = NULL;
+    x->index = NULL;
+    x->invalid = 0;
+    x->search = NULL;
+    x->hash = 0;
+    x->toc = NULL;
+    x->headings = x->max_headings = 0;
+    x->summary = NULL;
+    x->summaries = x->max_summaries = 0;
     return x;
 }
 
@@ -80,10 +104,213 @@ void free_deck(deck_t *deck) {
     slide = deck->slide;
     while (slide) {
         free_line(slide->line);
+        if(slide->pack != deck->pack)
+            free_pack(slide->pack);
+        if(slide->display)
+            display_delete(slide->display);
+        if(slide->notes)
+            (slide->notes->delete)(slide->notes);
         next = slide->next;
         free(slide);
         slide = next;
     }
     free_line(deck->header);
+    free_pack(deck->pack);
+    if(deck->input)
+        fclose(deck->input);
+    free(deck->index);
+    while(deck->headings > 0)
+        free(deck->toc[--deck->headings].text);
+    free(deck->toc);
+    while(deck->summaries > 0) {
+        free(deck->summary[--deck->summaries].title);
+        free(deck->summary[deck->summaries].text);
+    }
+    free(deck->summary);
     free(deck);
 }
+
+pack_t *new_pack(void) {
+    pack_t *x = malloc(sizeof(pack_t));
+    if(!x) {
+        fprintf(stderr, "%s\n", "new_pack() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+    x->text = NULL;
+    x->start = NULL;
+    x->size = x->bits = x->length = NULL;
+    x->lines = x->max_lines = 0;
+    x->bytes = x->max_bytes = 0;
+    return x;
+}
+
+// make room for the given amount of lines and bytes, the first allocation
+// fits exactly, later ones double so packing slide by slide stays linear
+static void pack_reserve(pack_t *pack, int lines, size_t bytes) {
+    size_t x;
+    int n;
+
+    if(bytes > pack->max_bytes) {
+        for(x = pack->max_bytes ? pack->max_bytes : bytes; x < bytes; x *= 2);
+        if((pack->text = realloc(pack->text, x)) == NULL) {
+            fprintf(stderr, "%s\n", "pack_slide() failed to allocate memory.");
+            exit(EXIT_FAILURE);
+        }
+        pack->max_bytes = x;
+    }
+
+    if(lines > pack->max_lines) {
+        for(n = pack->max_lines ? pack->max_lines : lines; n < lines; n *= 2);
+        pack->start = realloc(pack->start, n * sizeof(size_t));
+        pack->size = realloc(pack->size, n * sizeof(int));
+        pack->bits = realloc(pack->bits, n * sizeof(int));
+        pack->length = realloc(pack->length, n * sizeof(int));
+        if(!pack->start || !pack->size || !pack->bits || !pack->length) {
+            fprintf(stderr, "%s\n", "pack_slide() failed to allocate memory.");
+            exit(EXIT_FAILURE);
+        }
+        pack->max_lines = n;
+    }
+}
+
+void pack_slide(pack_t *pack, slide_t *slide) {
+    line_t *line;
+    size_t bytes = pack->bytes;
+    int lines = pack->lines;
+    char *out;
+    int i;
+
+    for(line = slide->line; line; line = line->next) {
+        lines++;
+        if(line->text && line->text->value)
+            bytes += utf8_length(line->text->value, line->text->size) + 1;
+    }
+    pack_reserve(pack, lines, bytes);
+
+    slide->pack = pack;
+    slide->first = pack->lines;
+
+    for(line = slide->line; line; line = line->next) {
+        i = pack->lines++;
+        pack->start[i] = pack->bytes;
+        pack->bits[i] = line->bits;
+        pack->length[i] = line->length;
+
+        if(line->text && line->text->value) {
+            out = utf8_encode(&pack->text[pack->bytes], line->text->value, line->text->size);
+            pack->size[i] = out - &pack->text[pack->bytes];
+            pack->bytes += pack->size[i];
+            pack->text[pack->bytes++] = '\0';
+        } else {
+            pack->size[i] = -1;
+        }
+    }
+
+    slide->lines = pack->lines - slide->first;
+
+    // the lines are not needed anymore
+    free_line(slide->line);
+    slide->line = NULL;
+}
+
+cstring_t *pack_decode(const pack_t *pack, int i, cstring_t *text) {
+    if(pack->size[i] < 0)
+        return NULL;
+
+    // keep the buffer of the previous line
+    if(text->value)
+        (text->strip)(text, 0, text->size);
+    (text->expand_utf8)(text, &pack->text[pack->start[i]], pack->size[i]);
+
+    return text;
+}
+
+void free_pack(pack_t *pack) {
+    if(pack == NULL)
+        return;
+    free(pack->text);
+    free(pack->start);
+    free(pack->size);
+    free(pack->bits);
+    free(pack->length);
+    free(pack);
+}
+
+void toc_add(deck_t *deck, int slide, int level, const wchar_t *text, size_t n) {
+    heading_t *h;
+
+    if(deck->headings == deck->max_headings) {
+        deck->max_headings = deck->max_headings ? deck->max_headings * 2 : 64;
+        if((deck->toc = realloc(deck->toc, deck->max_headings * sizeof(heading_t))) == NULL) {
+            fprintf(stderr, "%s\n", "toc_add() failed to allocate memory.");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    h = &deck->toc[deck->headings];
+    if((h->text = malloc((n + 1) * sizeof(wchar_t))) == NULL) {
+        fprintf(stderr, "%s\n", "toc_add() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+    wmemcpy(h->text, text, n);
+    h->text[n] = L'\0';
+    h->slide = slide;
+    h->level = level;
+    deck->headings++;
+}
+
+summary_t *summary_at(deck_t *deck, int slide) {
+    summary_t *s;
+
+    if(slide > deck->max_summaries) {
+        deck->max_summaries = MAX(slide, deck->max_summaries * 2);
+        if((deck->summary = realloc(deck->summary, deck->max_summaries * sizeof(summary_t))) == NULL) {
+            fprintf(stderr, "%s\n", "summary_at() failed to allocate memory.");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    for(; deck->summaries < slide; deck->summaries++) {
+        s = &deck->summary[deck->summaries];
+        s->title = s->text = NULL;
+        s->size = s->rows = s->lines = 0;
+        s->pending = false;
+    }
+
+    return &deck->summary[slide - 1];
+}
+
+void summary_row(summary_t *s, const wchar_t *text, size_t n) {
+    n = MIN(n, (size_t) SUMMARY_COLS);
+
+    if((s->text = realloc(s->text, (s->size + n + 1) * sizeof(wchar_t))) == NULL) {
+        fprintf(stderr, "%s\n", "summary_row() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+    wmemcpy(&s->text[s->size], text, n);
+    s->size += n;
+    s->text[s->size++] = L'\0';
+    s->rows++;
+}
+
+void summary_title(summary_t *s, const wchar_t *text, size_t n) {
+    if(s->title)
+        return;
+
+    n = MIN(n, (size_t) SUMMARY_COLS);
+    if((s->title = malloc((n + 1) * sizeof(wchar_t))) == NULL) {
+        fprintf(stderr, "%s\n", "summary_title() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+    wmemcpy(s->title, text, n);
+    s->title[n] = L'\0';
+}
+
+void summary_drop(summary_t *s) {
+    if(s->rows == 0)
+        return;
+
+    // back to the end of the row before
+    for(s->size--; s->size > 0 && s->text[s->size - 1]; s->size--);
+    s->rows--;
+}
@@ -0,0 +1,162 @@
+/*
+ * Row map of a deck shown as one continuous document.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pager.h"
+#include "parser.h"
+
+pager_t *pager_init(void) {
+    pager_t *p = calloc(1, sizeof(pager_t));
+
+    if(!p || !(p->slide_row = malloc(sizeof(int)))) {
+        fprintf(stderr, "%s\n", "pager_init() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+    p->slide_row[0] = 0;
+
+    return p;
+}
+
+// the slide following the last one measured, NULL after the last slide
+static slide_t *slide_after(pager_t *p, deck_t *deck) {
+    slide_t *slide;
+
+    if(!p->slides)
+        return deck->slide;
+
+    slide = p->slide[p->slides - 1];
+
+    // the scan of a lazily loaded deck may not have found it yet
+    if(!slide->next)
+        markdown_scan(deck, 1);
+
+    return slide->next;
+}
+
+static void measure_slide(pager_t *p, slide_t *slide) {
+    int row = p->slide_row[p->slides];
+    int length, ln;
+
+    if(p->slides + 1 >= p->max_slides) {
+        p->max_slides = p->max_slides ? p->max_slides * 2 : 64;
+        if(!(p->slide = realloc(p->slide, p->max_slides * sizeof(slide_t *))) ||
+           !(p->slide_row = realloc(p->slide_row, (p->max_slides + 1) * sizeof(int))) ||
+           !(p->slide_line = realloc(p->slide_line, (p->max_slides + 1) * sizeof(int)))) {
+            fprintf(stderr, "%s\n", "pager_measure() failed to allocate memory.");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if(p->lines + slide->lines > p->max_lines) {
+        p->max_lines = MAX(p->lines + slide->lines, p->max_lines * 2);
+        if(!(p->line_row = realloc(p->line_row, p->max_lines * sizeof(int)))) {
+            fprintf(stderr, "%s\n", "pager_measure() failed to allocate memory.");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    p->slide[p->slides] = slide;
+    p->slide_line[p->slides] = p->lines;
+
+    // as many rows per line as display_slide takes
+    for(ln = 0; ln < slide->lines; ln++) {
+        length = slide->pack->length[slide->first + ln];
+        p->line_row[p->lines++] = row;
+        p->max_cols = MAX(MIN(length, p->cols), p->max_cols);
+        row += length / p->cols + 1;
+    }
+
+    // and the rule
+    p->slides++;
+    p->slide_row[p->slides] = row + 1;
+    p->slide_line[p->slides] = p->lines;
+}
+
+int pager_measure(pager_t *p, deck_t *deck, int cols, int row) {
+    slide_t *slide;
+
+    // start over for another width
+    if(cols != p->cols) {
+        p->cols = cols;
+        p->max_cols = 0;
+        p->slides = p->lines = 0;
+        p->complete = false;
+    }
+
+    while(!p->complete && p->slide_row[p->slides] <= row) {
+        if(!(slide = slide_after(p, deck))) {
+            p->complete = true;
+            break;
+        }
+        markdown_parse(deck, slide);
+        measure_slide(p, slide);
+    }
+
+    return p->slide_row[p->slides];
+}
+
+int pager_seek(pager_t *p, int row, int *ln) {
+    int lo = 0, hi = p->slides - 1, mid;
+    int first, last;
+
+    // the last slide starting at or before row
+    while(lo < hi) {
+        mid = (lo + hi + 1) / 2;
+        if(p->slide_row[mid] <= row)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+
+    // the rule below it
+    first = p->slide_line[lo];
+    last = p->slide_line[lo + 1] - 1;
+    if(last < first || row >= p->slide_row[lo + 1] - 1) {
+        *ln = -1;
+        return lo;
+    }
+
+    // the last line starting at or before row
+    while(first < last) {
+        mid = (first + last + 1) / 2;
+        if(p->line_row[mid] <= row)
+            first = mid;
+        else
+            last = mid - 1;
+    }
+    *ln = first - p->slide_line[lo];
+
+    return lo;
+}
+
+int pager_row(pager_t *p, int n, int ln) {
+    return ln < 0 ? p->slide_row[n + 1] - 1 : p->line_row[p->slide_line[n] + ln];
+}
+
+void pager_delete(pager_t *p) {
+    free(p->slide);
+    free(p->slide_row);
+    free(p->slide_line);
+    free(p->line_row);
+    free(p);
+}
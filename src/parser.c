@@ -28,8 +28,23 @@
 #include <wchar.h>
 #include <wctype.h>
 #include <string.h>
+#include <stdint.h> // uint64_t
+#include <unistd.h> // ssize_t
+#include <sys/stat.h>
 
+#include "display.h"
 #include "parser.h"
+#include "url.h"
+#include "utf8.h"
+
+#if defined( __APPLE__ )
+#define ST_MTIM st_mtimespec
+#else
+#define ST_MTIM st_mtim
+#endif
+
+// offset basis of the FNV-1a hashes of decks and included files
+#define FNV_BASIS 0xcbf29ce484222325ULL
 
 // char entry translation table
 static struct named_character_entity {
@@ -100,148 +115,915 @@ static struct named_character_entity {
    { L'\0', NULL },
 };
 
-deck_t *markdown_load(FILE *input, int noexpand) {
+// state of markdown_analyse carried from line to line
+static int unordered_list_level = 0;
+static int unordered_list_level_offset[] = {-1, -1, -1, -1};
+static int num_tilde_characters = 0;
+static int num_backticks = 0;
+
+// a copy of the markdown_analyse state
+typedef struct _analyse_t {
+    int unordered_list_level;
+    int unordered_list_level_offset[UNORDERED_LIST_MAX_LEVEL + 1];
+    int num_tilde_characters;
+    int num_backticks;
+} analyse_t;
+
+// what happens to a line of input
+enum {
+    LOAD_SKIP,  // dropped, e.g. code fence markers
+    LOAD_TEXT,  // added to the slide
+    LOAD_STOP,  // sets the stop bit of the last line added
+    LOAD_SLIDE, // hr separating two slides
+    LOAD_NOTE   // added to the notes of the slide
+};
 
-    wchar_t c = L'\0';    // char
-    int i = 0;    // increment
-    int hc = 0;   // header count
-    int lc = 0;   // line count
-    int sc = 1;   // slide count
-    int bits = 0; // markdown bits
-    int prev = 0; // markdown bits of previous line
+// state of loading line by line, shared by eager and lazy loading
+typedef struct _loader_t {
+    slide_t *slide;  // slide lines are added to
+    line_t *line;    // last line added
+    int lc;          // line count of the slide
+    int bits;        // markdown bits of the last line read
+    bool started;    // any line was added to the deck
+    bool empty;      // last line added is empty
+    bool notes;      // lines are notes, a ??? line was read
+    int noexpand;
+} loader_t;
+
+// state of the slide boundary scan of a lazily loaded deck
+typedef struct _index_t {
+    loader_t loader;
+    analyse_t analyse;
+    slide_t *last;   // slide holding the last line found
+    long offset;     // input offset the scan continues at
+    int skip;        // lines of the include directive at offset read already
+    bool done;       // end of input reached
+    slide_t *recent; // most recently used loaded slide
+    slide_t *oldest; // least recently used loaded slide
+    size_t budget;   // bytes of loaded slides to keep, 0 for no limit
+    size_t resident; // bytes of loaded slides
+    uint64_t hash;   // FNV-1a of the input scanned so far
+    long hashed;     // input offset the hash reaches
+    unsigned long hits, misses, evictions;
+} index_t;
+
+// the lines of an included file, read once per content
+typedef struct _fragment_t {
+    uint64_t hash;     // FNV-1a of the file content
+    size_t size;       // bytes of the file content
+    wchar_t *text;     // lines, each terminated by a NUL
+    size_t *start;     // position of each line in text
+    size_t chars;      // chars used in text
+    int lines;
+    int refs;          // included files with this content
+    unsigned long invalid; // invalid UTF-8 sequences found in the content
+    long invalid_offset[INVALID_OFFSETS]; // byte offsets of the first ones
+    struct _fragment_t *next;
+} fragment_t;
+
+// an included file, checked for changes whenever it is included again
+typedef struct _include_t {
+    char *path;
+    char *dir;         // nested includes are relative to this
+    struct timespec mtime;
+    off_t size;
+    unsigned long generation; // decks loaded when it was last checked
+    fragment_t *fragment;
+    struct _include_t *next;
+} include_t;
+
+// fragment cache, kept across reloads
+static fragment_t *fragments = NULL;
+static include_t *includes = NULL;
+static char *include_base = NULL; // directory of the deck, NULL for the working directory
+static int include_scope = INCLUDE_DECK;
+
+// ??? lines start notes only for a presenter view, a deck written for
+// another viewer may have them as text
+static bool notes_enabled = false;
+static unsigned long include_generation = 0;
+static unsigned long fragments_parsed = 0;
+static unsigned long fragments_included = 0;
+
+// index of the slide text of the decks loaded next, kept across reloads
+static search_t *search_index = NULL;
+
+// input of a loader pass, read line by line and decoded from UTF-8
+typedef struct _reader_t {
+    FILE *input;
+    char *buf;        // bytes of the last line read
+    size_t alloc;     // bytes allocated for buf
+    wchar_t *chars;   // decoded chars of the last line read
+    size_t max_chars; // chars allocated
+    long offset;      // input offset of the next line
+    unsigned long *invalid; // invalid sequences found, NULL to ignore them
+    long *invalid_offset;   // byte offsets of the first ones
+    uint64_t *hash;   // FNV-1a of the input read, NULL to skip it
+    long *hashed;     // input offset the hash reaches, lines read again
+                      // are not hashed twice
+    bool includes;    // resolve include directives
+    include_t *stack[INCLUDE_DEPTH]; // files included, innermost last
+    int next[INCLUDE_DEPTH];         // next line of each of them
+    int depth;
+    long include_offset; // input offset of the outermost include directive
+    int included;        // lines read from it so far
+} reader_t;
+
+static void reader_init(reader_t *rd, FILE *input, long offset, deck_t *deck) {
+    rd->input = input;
+    rd->buf = NULL;
+    rd->alloc = 0;
+    rd->chars = NULL;
+    rd->max_chars = 0;
+    rd->offset = offset;
+    rd->invalid = deck ? &deck->invalid : NULL;
+    rd->invalid_offset = deck ? deck->invalid_offset : NULL;
+    rd->hash = NULL;
+    rd->hashed = NULL;
+    rd->includes = true;
+    rd->depth = 0;
+    rd->include_offset = offset;
+    rd->included = 0;
+}
 
-    deck_t *deck = new_deck();
-    slide_t *slide = deck->slide;
-    line_t *line = NULL;
-    line_t *tmp = NULL;
-    cstring_t *text = cstring_init();
+static void reader_free(reader_t *rd) {
+    free(rd->buf);
+    free(rd->chars);
+}
+
+// input offset of the next line, if it is one of the lines of an include
+// directive, the offset of the directive and the lines to skip
+static long reader_tell(reader_t *rd, int *skip) {
+    *skip = rd->depth ? rd->included : 0;
+    return rd->depth ? rd->include_offset : rd->offset;
+}
+
+// position the input of a lazily loaded deck for another pass
+static FILE *index_seek(deck_t *deck, long offset) {
+    if(fseek(deck->input, offset, SEEK_SET) != 0) {
+        fprintf(stderr, "markdown_parse() failed to read input: %s\n", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    return deck->input;
+}
+
+// memory held by the lines of a slide and its display list
+static size_t slide_bytes(slide_t *slide) {
+    pack_t *pack = slide->pack;
+
+    return sizeof(pack_t) +
+           pack->max_bytes +
+           pack->max_lines * (sizeof(size_t) + 3 * sizeof(int)) +
+           (slide->notes ? slide->notes->alloc * sizeof(wchar_t) : 0) +
+           (slide->display ? display_bytes(slide->display) : 0);
+}
+
+static void cache_unlink(index_t *index, slide_t *slide) {
+    if(slide->newer)
+        slide->newer->older = slide->older;
+    else if(index->recent == slide)
+        index->recent = slide->older;
+    if(slide->older)
+        slide->older->newer = slide->newer;
+    else if(index->oldest == slide)
+        index->oldest = slide->newer;
+    slide->newer = slide->older = NULL;
+}
+
+// mark a loaded slide as most recently used
+static void cache_use(index_t *index, slide_t *slide) {
+    if(index->recent == slide)
+        return;
+
+    cache_unlink(index, slide);
+    slide->older = index->recent;
+    if(index->recent)
+        index->recent->newer = slide;
+    index->recent = slide;
+    if(!index->oldest)
+        index->oldest = slide;
+}
+
+// unload least recently used slides until the budget is met, the two most
+// recently used ones (shown and prefetched) are always kept
+static void cache_evict(index_t *index) {
+    slide_t *slide;
+
+    while(index->budget &&
+          index->resident > index->budget &&
+          (slide = index->oldest) &&
+          slide != index->recent &&
+          slide != index->recent->older) {
+
+        cache_unlink(index, slide);
+        index->resident -= slide->bytes;
+        index->evictions++;
+
+        free_pack(slide->pack);
+        slide->pack = NULL;
+        if(slide->notes)
+            (slide->notes->delete)(slide->notes);
+        slide->notes = NULL;
+        if(slide->display)
+            display_delete(slide->display);
+        slide->display = NULL;
+        slide->lines = 0;
+        slide->bytes = 0;
+        slide->loaded = false;
+    }
+}
+
+static void analyse_save(analyse_t *a) {
+    int i;
+
+    a->unordered_list_level = unordered_list_level;
+    for(i = 0; i <= UNORDERED_LIST_MAX_LEVEL; i++)
+        a->unordered_list_level_offset[i] = unordered_list_level_offset[i];
+    a->num_tilde_characters = num_tilde_characters;
+    a->num_backticks = num_backticks;
+}
+
+static void analyse_restore(const analyse_t *a) {
+    int i;
+
+    unordered_list_level = a->unordered_list_level;
+    for(i = 0; i <= UNORDERED_LIST_MAX_LEVEL; i++)
+        unordered_list_level_offset[i] = a->unordered_list_level_offset[i];
+    num_tilde_characters = a->num_tilde_characters;
+    num_backticks = a->num_backticks;
+}
+
+static void loader_init(loader_t *ld, slide_t *slide, int noexpand) {
+    ld->slide = slide;
+    ld->line = NULL;
+    ld->lc = 0;
+    ld->bits = 0;
+    ld->started = false;
+    ld->empty = false;
+    ld->notes = false;
+    ld->noexpand = noexpand;
 
     // initialize bits as empty line
-    SET_BIT(bits, IS_EMPTY);
+    SET_BIT(ld->bits, IS_EMPTY);
+}
 
-    while ((c = fgetwc(input)) != WEOF) {
-        if (ferror(input)) {
-            fprintf(stderr, "markdown_load() failed to read input: %s\n", strerror(errno));
+// continue an FNV-1a hash with n more bytes
+static uint64_t fnv_hash(uint64_t hash, const char *s, size_t n) {
+    while(n--) {
+        hash ^= (unsigned char) *s++;
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+// remember the byte offset of an invalid sequence
+static void load_invalid(reader_t *rd, long offset) {
+    if(!rd->invalid)
+        return;
+
+    if(*rd->invalid < INVALID_OFFSETS)
+        rd->invalid_offset[*rd->invalid] = offset;
+    (*rd->invalid)++;
+}
+
+// decode the bytes of the last line read, each invalid sequence is
+// replaced by a single U+FFFD, chars neither printable nor space by L'\0'
+static size_t load_decode(reader_t *rd, size_t bytes) {
+    size_t n = 0;
+    size_t pos = 0;
+    size_t done;
+
+    // n bytes never decode to more than n chars
+    if(bytes > rd->max_chars) {
+        rd->max_chars = MAX(bytes, rd->max_chars * 2);
+        if((rd->chars = realloc(rd->chars, rd->max_chars * sizeof(wchar_t))) == NULL) {
+            fprintf(stderr, "%s\n", "load_decode() failed to reallocate memory.");
             exit(EXIT_FAILURE);
         }
+    }
 
-        if(c == L'\n') {
+    for(;;) {
+        n += utf8_decode(&rd->buf[pos], bytes - pos, &rd->chars[n], UTF8_PRINTABLE, &done);
+        pos += done;
+        if(pos == bytes)
+            break;
 
-            // markdown analyse
-            prev = bits;
-            bits = markdown_analyse(text, prev);
+        load_invalid(rd, rd->offset + pos);
+        rd->chars[n++] = iswprint(UTF8_REPLACEMENT) ? UTF8_REPLACEMENT : L'?';
+        pos += utf8_invalid(&rd->buf[pos], bytes - pos);
+    }
 
-            // if first line in file is markdown hr
-            if(!line && CHECK_BIT(bits, IS_HR)) {
+    return n;
+}
 
-                // clear text
-                (text->reset)(text);
+// read one line of input into text
+// returns false at the end of input, an unterminated last line is dropped
+static bool read_line(reader_t *rd, cstring_t *text) {
 
-            } else if(line && CHECK_BIT(bits, IS_STOP)) {
+    wchar_t c = L'\0';     // char
+    bool escape = false;   // char follows a backslash
+    ssize_t bytes;         // bytes read
+    size_t n;              // chars decoded
+    size_t j;
+    int i = 0;    // increment
 
-                // set stop bit on last line
-                SET_BIT(line->bits, IS_STOP);
+    while((bytes = getline(&rd->buf, &rd->alloc, rd->input)) >= 0) {
+        n = load_decode(rd, bytes);
+        if(rd->hash && rd->offset >= *rd->hashed) {
+            *rd->hash = fnv_hash(*rd->hash, rd->buf, bytes);
+            *rd->hashed = rd->offset + bytes;
+        }
+        rd->offset += bytes;
 
-                // clear text
-                (text->reset)(text);
+        for(j = 0; j < n; j++) {
+            c = rd->chars[j];
 
-            // if text is markdown hr
-            } else if(CHECK_BIT(bits, IS_HR) &&
-                      CHECK_BIT(line->bits, IS_EMPTY)) {
+            if(escape) {
 
-                slide->lines = lc;
+                // if !IS_CODE add next char to line
+                // and do not increase line count
+                escape = false;
+                if(c)
+                    (text->expand)(text, c);
 
-                // clear text
-                (text->reset)(text);
+            } else if(c == L'\n') {
 
-                // create next slide
-                slide = next_slide(slide);
-                sc++;
+                return true;
 
-            } else if((CHECK_BIT(bits, IS_TILDE_CODE) ||
-		       CHECK_BIT(bits, IS_GFM_CODE)) &&
-                      CHECK_BIT(bits, IS_EMPTY)) {
-                // remove tilde code markers
-                (text->reset)(text);
+            } else if(c == L'\t') {
 
-            } else {
+                // expand tab to spaces
+                for (i = 0;  i < EXPAND_TABS;  i++) {
+                    (text->expand)(text, L' ');
+                }
+
+            } else if(c == L'\\') {
 
-                // if slide ! has line
-                if(!slide->line || !line) {
+                // add char to line
+                (text->expand)(text, c);
 
-                    // create new line
-                    line = new_line();
-                    slide->line = line;
-                    lc = 1;
+                // only the indent matters, so do not scan a whole line of
+                // blanks again for every backslash
+                for(i = 0; i < text->size && i < CODE_INDENT && iswspace(text->value[i]); i++);
+                escape = i < CODE_INDENT;
 
-                } else {
+            } else if(c) {
+
+                // add char to line
+                (text->expand)(text, c);
+            }
+        }
+    }
 
-                    // create next line
-                    line = next_line(line);
-                    lc++;
+    if(ferror(rd->input)) {
+        fprintf(stderr, "markdown_load() failed to read input: %s\n", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
 
-                }
+    return false;
+}
+
+static void fragment_add(fragment_t *f, cstring_t *text, size_t *max_chars, int *max_lines) {
+    size_t chars = f->chars;
+
+    if(f->lines == *max_lines) {
+        *max_lines = *max_lines ? *max_lines * 2 : 16;
+        f->start = realloc(f->start, *max_lines * sizeof(size_t));
+    }
+    if(chars + text->size + 1 > *max_chars) {
+        *max_chars = MAX(chars + text->size + 1, *max_chars * 2);
+        f->text = realloc(f->text, *max_chars * sizeof(wchar_t));
+    }
+    if(!f->start || !f->text) {
+        fprintf(stderr, "%s\n", "fragment_add() failed to reallocate memory.");
+        exit(EXIT_FAILURE);
+    }
 
-                // add text to line
-                line->text = text;
+    f->start[f->lines++] = chars;
+    wmemcpy(&f->text[chars], text->value ? text->value : L"", text->size);
+    f->text[chars + text->size] = L'\0';
+    f->chars += text->size + 1;
+}
 
-                // add bits to line
-                line->bits = bits;
+// read the lines of an included file the way the lines of a deck are read,
+// nested include directives are followed when the lines are used
+static fragment_t *fragment_parse(char *buf, size_t n, uint64_t hash) {
+    fragment_t *f = calloc(1, sizeof(fragment_t));
+    cstring_t *text = cstring_init();
+    size_t max_chars = 0;
+    int max_lines = 0;
+    FILE *input = NULL;
+    reader_t rd;
+    bool more;
+
+    if(!f || (n > 0 && (input = fmemopen(buf, n, "r")) == NULL)) {
+        fprintf(stderr, "%s\n", "fragment_parse() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+    f->hash = hash;
+    f->size = n;
 
-                // calc offset
-                line->offset = next_nonblank(text, 0);
+    // invalid sequences are reported for each deck including the file
+    reader_init(&rd, input, 0, NULL);
+    rd.invalid = &f->invalid;
+    rd.invalid_offset = f->invalid_offset;
+    rd.includes = false;
 
-                // expand character entities if enabled
-                if(line->text->value &&
-                   !noexpand &&
-                   !CHECK_BIT(line->bits, IS_CODE))
-                    expand_character_entities(line);
+    while(input) {
+        more = read_line(&rd, text);
 
-                // adjust line length dynamicaly - excluding markup
-                if(line->text->value)
-                    adjust_line_length(line);
+        // keep an unterminated last line, unlike in a deck
+        if(more || text->size > 0)
+            fragment_add(f, text, &max_chars, &max_lines);
+        (text->reset)(text);
 
-                // new text
-                text = cstring_init();
-            }
+        if(!more)
+            break;
+    }
 
-        } else if(c == L'\t') {
+    if(input)
+        fclose(input);
+    reader_free(&rd);
+    (text->delete)(text);
+    fragments_parsed++;
 
-            // expand tab to spaces
-            for (i = 0;  i < EXPAND_TABS;  i++) {
-                (text->expand)(text, L' ');
-            }
+    return f;
+}
 
-        } else if(c == L'\\') {
+static void fragment_release(fragment_t *f) {
+    fragment_t **p;
 
-            // add char to line
-            (text->expand)(text, c);
+    if(--f->refs > 0)
+        return;
 
-            // if !IS_CODE add next char to line
-            // and do not increase line count
-            if(next_nonblank(text, 0) < CODE_INDENT) {
+    for(p = &fragments; *p != f; p = &(*p)->next);
+    *p = f->next;
 
-                c = fgetwc(input);
-                (text->expand)(text, c);
+    free(f->text);
+    free(f->start);
+    free(f);
+}
+
+// directory of a file, NULL for the working directory
+static char *include_dir(const char *path) {
+    const char *slash = strrchr(path, '/');
+
+    if(!slash)
+        return NULL;
+
+    return strndup(path, slash > path ? slash - path : 1);
+}
+
+// the file named by an include directive, relative to dir
+static char *include_path(const char *dir, const wchar_t *name) {
+    size_t n = wcstombs(NULL, name, 0);
+    size_t len = dir && name[0] != L'/' ? strlen(dir) + 1 : 0;
+    char *path;
+
+    if(n == (size_t) -1)
+        return NULL;
+
+    if((path = malloc(len + n + 1)) == NULL) {
+        fprintf(stderr, "%s\n", "include_path() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+    if(len)
+        sprintf(path, "%s/", dir);
+    wcstombs(&path[len], name, n + 1);
+
+    return path;
+}
+
+// whether a deck may include the file, it must be in the directory of the
+// deck, or of the chapter including it, symbolic links resolved
+static bool include_allowed(reader_t *rd, const char *path) {
+    const char *dir = include_base;
+    char *real, *root;
+    size_t len;
+    bool inside;
+
+    if(include_scope == INCLUDE_ANY)
+        return true;
+
+    if(include_scope == INCLUDE_CHAPTER) {
+        // the chapters themselves are named on the command line
+        if(rd->depth == 0)
+            return true;
+        dir = rd->stack[0]->dir;
+    }
+
+    real = realpath(path, NULL);
+    root = realpath(dir ? dir : ".", NULL);
+    len = root ? strlen(root) : 0;
+
+    // a root of / ends with the slash
+    inside = real && root && !strncmp(real, root, len) &&
+             (real[len] == '/' || (len == 1 && real[0] == '/'));
+
+    free(real);
+    free(root);
+
+    return inside;
+}
+
+// find an included file, it is only read again if it has changed since
+// the last deck was loaded, and only parsed again if its content is new
+static include_t *include_get(const char *path) {
+    include_t *inc;
+    fragment_t *f;
+    struct stat st;
+    FILE *file;
+    uint64_t hash;
+    char *buf;
+    size_t n;
+
+    for(inc = includes; inc && strcmp(inc->path, path); inc = inc->next);
+
+    // the lines of a deck stay the same while it is shown
+    if(inc && inc->generation == include_generation)
+        return inc;
+
+    // no devices or pipes, which might never end
+    if(stat(path, &st) != 0 || !S_ISREG(st.st_mode))
+        return NULL;
+
+    if(inc && inc->size == st.st_size &&
+       inc->mtime.tv_sec == st.ST_MTIM.tv_sec && inc->mtime.tv_nsec == st.ST_MTIM.tv_nsec) {
+        inc->generation = include_generation;
+        return inc;
+    }
+
+    if((file = fopen(path, "r")) == NULL)
+        return NULL;
+    if((buf = malloc(st.st_size + 1)) == NULL) {
+        fprintf(stderr, "%s\n", "include_get() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+    n = fread(buf, 1, st.st_size, file);
+    fclose(file);
+
+    // the same content is parsed only once, whatever file it is in
+    hash = fnv_hash(FNV_BASIS, buf, n);
+    for(f = fragments; f && (f->hash != hash || f->size != n); f = f->next);
+    if(!f) {
+        f = fragment_parse(buf, n, hash);
+        f->next = fragments;
+        fragments = f;
+    }
+    f->refs++;
+    free(buf);
+
+    if(inc) {
+        fragment_release(inc->fragment);
+    } else {
+        if((inc = calloc(1, sizeof(include_t))) == NULL ||
+           (inc->path = strdup(path)) == NULL) {
+            fprintf(stderr, "%s\n", "include_get() failed to allocate memory.");
+            exit(EXIT_FAILURE);
+        }
+        inc->dir = include_dir(path);
+        inc->next = includes;
+        includes = inc;
+    }
+    inc->fragment = f;
+    inc->mtime = st.ST_MTIM;
+    inc->size = st.st_size;
+    inc->generation = include_generation;
+
+    return inc;
+}
+
+// the file included by a line, NULL if it is no include directive or the
+// file cannot be read, the line is kept as it is then
+static include_t *include_find(reader_t *rd, cstring_t *text) {
+    size_t len = wcslen(INCLUDE_DIRECTIVE);
+    const wchar_t *name;
+    wchar_t *copy;
+    include_t *inc = NULL;
+    char *path;
+    int i;
+
+    if(text->size <= len || wcsncmp(text->value, INCLUDE_DIRECTIVE, len))
+        return NULL;
+
+    for(name = &text->value[len]; iswspace(*name); name++);
+    for(len = wcslen(name); len > 0 && iswspace(name[len - 1]); len--);
+    if(len == 0 || rd->depth == INCLUDE_DEPTH)
+        return NULL;
+
+    if((copy = malloc((len + 1) * sizeof(wchar_t))) == NULL) {
+        fprintf(stderr, "%s\n", "include_find() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+    wmemcpy(copy, name, len);
+    copy[len] = L'\0';
+    path = include_path(rd->depth ? rd->stack[rd->depth - 1]->dir : include_base, copy);
+    free(copy);
+
+    if(path && include_allowed(rd, path)) {
+        // a file including itself would never end
+        for(i = 0; i < rd->depth && strcmp(rd->stack[i]->path, path); i++);
+        if(i == rd->depth)
+            inc = include_get(path);
+    }
+    free(path);
+
+    return inc;
+}
+
+// read the next line of the deck into text, the lines of an included file
+// replace its include directive
+// returns false at the end of input
+static bool load_line(reader_t *rd, cstring_t *text) {
+    include_t *inc;
+    fragment_t *f;
+    long offset = rd->offset;
+    int d;
+
+    for(;;) {
+        if(rd->depth > 0) {
+            d = rd->depth - 1;
+            f = rd->stack[d]->fragment;
+            if(rd->next[d] == f->lines) {
+                rd->depth--;
+                continue;
             }
+            if(f->text[f->start[rd->next[d]]])
+                (text->expand_arr)(text, &f->text[f->start[rd->next[d]]]);
+            rd->next[d]++;
+        } else {
+            offset = rd->offset;
+            if(!read_line(rd, text))
+                return false;
+        }
 
-        } else if(iswprint(c) || iswspace(c)) {
+        if(!rd->includes || (inc = include_find(rd, text)) == NULL) {
+            rd->included++;
+            return true;
+        }
 
-            // add char to line
-            (text->expand)(text, c);
+        if(rd->depth == 0) {
+            rd->include_offset = offset;
+            rd->included = 0;
         }
+        rd->stack[rd->depth] = inc;
+        rd->next[rd->depth++] = 0;
+        fragments_included++;
+        (text->reset)(text);
     }
+}
+
+// skip the lines of an include directive read by a previous pass
+static void load_skip(reader_t *rd, int lines) {
+    cstring_t *text = cstring_init();
+    unsigned long *invalid = rd->invalid;
+
+    // invalid sequences of the directive were reported already
+    rd->invalid = NULL;
+    while(lines-- > 0 && load_line(rd, text))
+        (text->reset)(text);
+    rd->invalid = invalid;
+
     (text->delete)(text);
+}
 
-    slide->lines = lc;
-    deck->slides = sc;
+// expand the character entities of a line found by the scan of a lazily
+// loaded deck, as load_text does for a line which is parsed
+static void scan_expand(loader_t *ld, cstring_t *text) {
+    line_t line;
+
+    if(text->value && !ld->noexpand && !CHECK_BIT(ld->bits, IS_CODE)) {
+        line.text = text;
+        expand_character_entities(&line);
+    }
+}
+
+// add a line of text to the search index of the deck
+static void load_search(deck_t *deck, cstring_t *text) {
+    if(text->value)
+        search_line(deck->search, text->value, text->size);
+    else
+        search_line(deck->search, L"", 0);
+}
+
+// add a headline of slide sc to the table of contents, prev is the line
+// of text before it, if any, which holds the text of a headline that is
+// underlined with = or -
+static void load_heading(deck_t *deck, int bits, cstring_t *text, cstring_t *prev, int sc) {
+    size_t start, end;
+
+    if((!CHECK_BIT(bits, IS_H1) && !CHECK_BIT(bits, IS_H2)) ||
+       CHECK_BIT(bits, IS_CODE))
+        return;
+
+    if(CHECK_BIT(bits, IS_EMPTY)) {
+        if(!prev || !prev->value)
+            return;
+        text = prev;
+    }
+
+    // skip hashes and blanks around the text
+    for(start = 0; start < text->size &&
+        (text->value[start] == L'#' || iswspace(text->value[start])); start++);
+    for(end = text->size; end > start && iswspace(text->value[end - 1]); end--);
+
+    if(end > start)
+        toc_add(deck, sc, CHECK_BIT(bits, IS_H1) ? 1 : 2, &text->value[start], end - start);
+}
+
+// copy up to SUMMARY_COLS chars of a line to out, as they are shown:
+// without indentation, quote markers and in-line markup
+static size_t summary_strip(const wchar_t *in, size_t n, wchar_t *out, bool code) {
+    size_t i = 0, len = 0;
+    bool escaped = false;
+
+    while(i < n && (iswspace(in[i]) || (!code && in[i] == L'>')))
+        i++;
+
+    for(; i < n && len < SUMMARY_COLS; i++) {
+        if(!code && !escaped && wcschr(L"\\*_`", in[i])) {
+            escaped = in[i] == L'\\';
+            continue;
+        }
+        escaped = false;
+        out[len++] = in[i];
+    }
+
+    while(len > 0 && iswspace(out[len - 1]))
+        len--;
+
+    return len;
+}
+
+// add a line of text of slide sc to its summary, a headline becomes the
+// title, other lines become rows until there are SUMMARY_ROWS of them
+static void load_summary(deck_t *deck, int bits, cstring_t *text, int sc) {
+    summary_t *s = summary_at(deck, sc);
+    wchar_t row[SUMMARY_COLS];
+    size_t n, i = 0;
+    bool pending = s->pending;
+
+    s->pending = false;
+    if(!text->value || (CHECK_BIT(bits, IS_EMPTY) &&
+       !CHECK_BIT(bits, IS_H1) && !CHECK_BIT(bits, IS_H2)))
+        return;
+
+    // header lines of the deck
+    if(sc == 1 && s->lines == 0 && text->value[0] == L'%')
+        return;
+
+    if((CHECK_BIT(bits, IS_H1) || CHECK_BIT(bits, IS_H2)) &&
+       !CHECK_BIT(bits, IS_CODE)) {
+
+        if(CHECK_BIT(bits, IS_EMPTY)) {
+            // an underline turns the row before into the title, the
+            // chars of a dropped row are kept behind the others
+            if(pending) {
+                summary_drop(s);
+                summary_title(s, &s->text[s->size], wcslen(&s->text[s->size]));
+            }
+            return;
+        }
+
+        while(i < text->size && text->value[i] == L'#')
+            i++;
+        n = summary_strip(&text->value[i], text->size - i, row, false);
+        summary_title(s, row, n);
+        s->lines++;
+        return;
+    }
+
+    s->lines++;
+    if(s->rows == SUMMARY_ROWS)
+        return;
+
+    n = summary_strip(text->value, text->size, row, CHECK_BIT(bits, IS_CODE));
+    if(n > 0) {
+        summary_row(s, row, n);
+        s->pending = true;
+    }
+}
+
+// a line of ??? outside of code starts the notes of a slide
+static bool is_notes(const cstring_t *text, int bits) {
+    size_t i;
+
+    if(!notes_enabled || CHECK_BIT(bits, IS_CODE) || text->size < 3 || wcsncmp(text->value, L"???", 3))
+        return false;
+    for(i = 3; i < text->size; i++)
+        if(!iswspace(text->value[i]))
+            return false;
+
+    return true;
+}
+
+// markdown analyse a line and decide what happens to it
+static int load_classify(loader_t *ld, cstring_t *text) {
+
+    ld->bits = markdown_analyse(text, ld->bits);
+
+    // if first line in file is markdown hr
+    if(!ld->started && CHECK_BIT(ld->bits, IS_HR))
+        return LOAD_SKIP;
+
+    // notes end with the slide, at a hr following an empty line
+    if(ld->notes && !(CHECK_BIT(ld->bits, IS_HR) && ld->empty)) {
+        ld->empty = CHECK_BIT(ld->bits, IS_EMPTY);
+        return LOAD_NOTE;
+    }
+    if(is_notes(text, ld->bits)) {
+        ld->notes = true;
+        return LOAD_SKIP;
+    }
+
+    // set stop bit on last line
+    if(ld->started && CHECK_BIT(ld->bits, IS_STOP))
+        return LOAD_STOP;
+
+    // if text is markdown hr
+    if(CHECK_BIT(ld->bits, IS_HR) && ld->empty) {
+        ld->notes = false;
+        return LOAD_SLIDE;
+    }
+
+    // remove tilde code markers
+    if((CHECK_BIT(ld->bits, IS_TILDE_CODE) ||
+        CHECK_BIT(ld->bits, IS_GFM_CODE)) &&
+       CHECK_BIT(ld->bits, IS_EMPTY))
+        return LOAD_SKIP;
+
+    return LOAD_TEXT;
+}
+
+// add a line to the slide, text is owned by the line afterwards
+static void load_text(loader_t *ld, cstring_t *text) {
+    slide_t *slide = ld->slide;
+    line_t *line = ld->line;
+
+    // if slide ! has line
+    if(!slide->line || !line) {
+
+        // create new line
+        line = new_line();
+        slide->line = line;
+        ld->lc = 1;
+
+    } else {
+
+        // create next line
+        line = next_line(line);
+        ld->lc++;
+
+    }
+
+    // add text to line
+    line->text = text;
+
+    // add bits to line
+    line->bits = ld->bits;
+
+    // calc offset
+    line->offset = next_nonblank(text, 0);
+
+    // expand character entities if enabled
+    if(line->text->value &&
+       !ld->noexpand &&
+       !CHECK_BIT(line->bits, IS_CODE))
+        expand_character_entities(line);
+
+    // adjust line length dynamicaly - excluding markup
+    if(line->text->value)
+        adjust_line_length(line);
+
+    ld->line = line;
+    ld->started = true;
+    ld->empty = CHECK_BIT(line->bits, IS_EMPTY);
+}
+
+// add a line to the notes of the slide
+static void load_note(slide_t *slide, cstring_t *text) {
+    size_t i;
+
+    if(!slide->notes)
+        slide->notes = cstring_init();
+    for(i = 0; i < text->size; i++)
+        (slide->notes->expand)(slide->notes, text->value[i]);
+    (slide->notes->expand)(slide->notes, L'\n');
+}
+
+// move leading %-lines of the first slide into the deck header
+static void load_header(deck_t *deck) {
+    line_t *line;
+    line_t *header;
+    int hc = 0;   // header count
 
     // detect header
     line = deck->slide->line;
     if(line && line->text->size > 0 && line->text->value[0] == L'%') {
 
-        // assign header to deck
-        deck->header = line;
+        header = line;
 
         // find first non-header line
         while(line && line->text->size > 0 && line->text->value[0] == L'%') {
@@ -256,81 +1038,93 @@ deck_t *markdown_load(FILE *input, int noexpand) {
             line->prev->next = NULL;
             line->prev = NULL;
 
+            // assign header to deck, replacing the one of a previous
+            // parse of the first slide
+            free_line(deck->header);
+            deck->header = header;
+
             // remove header lines from slide
             deck->slide->line = line;
 
             // adjust counts
-            deck->headers += hc;
+            deck->headers = hc;
             deck->slide->lines -= hc;
-        } else {
-
-            // remove header from deck
-            deck->header = NULL;
         }
     }
+}
 
-    slide = deck->slide;
-    while(slide) {
-        line = slide->line;
+// post-process the lines of a slide once all of them are loaded
+static void load_finish(slide_t *slide) {
+    line_t *line = slide->line;
+    line_t *tmp = NULL;
 
-        // ignore mdpress format attributes
-        if(line &&
-           slide->lines > 1 &&
-           !CHECK_BIT(line->bits, IS_EMPTY) &&
-           line->text->value[line->offset] == L'=' &&
-           line->text->value[line->offset + 1] == L' ') {
+    // end of the list item already propagated for each level,
+    // so long lists are scanned once instead of once per item
+    line_t *until_level_1 = NULL, *until_level_2 = NULL, *until_level_3 = NULL;
 
-            // remove line from linked list
-            slide->line = line->next;
-            line->next->prev = NULL;
+    // ignore mdpress format attributes
+    if(line &&
+       slide->lines > 1 &&
+       !CHECK_BIT(line->bits, IS_EMPTY) &&
+       line->text->value[line->offset] == L'=' &&
+       line->text->value[line->offset + 1] == L' ') {
 
-            // maintain loop condition
-            tmp = line;
-            line = line->next;
+        // remove line from linked list
+        slide->line = line->next;
+        line->next->prev = NULL;
 
-            // adjust line count
-            slide->lines -= 1;
+        // maintain loop condition
+        tmp = line;
+        line = line->next;
 
-            // delete line
-            (tmp->text->delete)(tmp->text);
-            free(tmp);
-        }
+        // adjust line count
+        slide->lines -= 1;
 
-        while(line) {
-            // combine underlined H1/H2 in single line
-            if((CHECK_BIT(line->bits, IS_H1) ||
-                CHECK_BIT(line->bits, IS_H2)) &&
-               CHECK_BIT(line->bits, IS_EMPTY) &&
-               line->prev &&
-               !CHECK_BIT(line->prev->bits, IS_EMPTY)) {
+        // delete line
+        (tmp->text->delete)(tmp->text);
+        free(tmp);
+    }
 
+    while(line) {
+        // exclude pandoc URL targets from line length
+        if(line->text->value)
+            line->length -= url_len_inline(line->text->value);
 
-                // remove line from linked list
-                line->prev->next = line->next;
-                if(line->next)
-                    line->next->prev = line->prev;
+        // combine underlined H1/H2 in single line
+        if((CHECK_BIT(line->bits, IS_H1) ||
+            CHECK_BIT(line->bits, IS_H2)) &&
+           CHECK_BIT(line->bits, IS_EMPTY) &&
+           line->prev &&
+           !CHECK_BIT(line->prev->bits, IS_EMPTY)) {
 
-                // set bits on previous line
-                if(CHECK_BIT(line->bits, IS_H1)) {
-                    SET_BIT(line->prev->bits, IS_H1);
-                } else {
-                    SET_BIT(line->prev->bits, IS_H2);
-                }
 
-                // adjust line count
-                slide->lines -= 1;
+            // remove line from linked list
+            line->prev->next = line->next;
+            if(line->next)
+                line->next->prev = line->prev;
+
+            // set bits on previous line
+            if(CHECK_BIT(line->bits, IS_H1)) {
+                SET_BIT(line->prev->bits, IS_H1);
+            } else {
+                SET_BIT(line->prev->bits, IS_H2);
+            }
+
+            // adjust line count
+            slide->lines -= 1;
 
-                // maintain loop condition
-                tmp = line;
-                line = line->prev;
+            // maintain loop condition
+            tmp = line;
+            line = line->prev;
 
-                // delete line
-                (tmp->text->delete)(tmp->text);
-                free(tmp);
+            // delete line
+            (tmp->text->delete)(tmp->text);
+            free(tmp);
 
-            // pass enclosing flag IS_UNORDERED_LIST_3
-            // to nested levels for unordered lists
-            } else if(CHECK_BIT(line->bits, IS_UNORDERED_LIST_3)) {
+        // pass enclosing flag IS_UNORDERED_LIST_3
+        // to nested levels for unordered lists
+        } else if(CHECK_BIT(line->bits, IS_UNORDERED_LIST_3)) {
+            if(!until_level_3) {
                 tmp = line->next;
                 line_t *list_last_level_3 = line;
 
@@ -345,10 +1139,13 @@ deck_t *markdown_load(FILE *input, int noexpand) {
                 for(tmp = line; tmp != list_last_level_3; tmp = tmp->next) {
                     SET_BIT(tmp->bits, IS_UNORDERED_LIST_3);
                 }
+                until_level_3 = list_last_level_3;
+            }
 
-            // pass enclosing flag IS_UNORDERED_LIST_2
-            // to nested levels for unordered lists
-            } else if(CHECK_BIT(line->bits, IS_UNORDERED_LIST_2)) {
+        // pass enclosing flag IS_UNORDERED_LIST_2
+        // to nested levels for unordered lists
+        } else if(CHECK_BIT(line->bits, IS_UNORDERED_LIST_2)) {
+            if(!until_level_2) {
                 tmp = line->next;
                 line_t *list_last_level_2 = line;
 
@@ -364,10 +1161,13 @@ deck_t *markdown_load(FILE *input, int noexpand) {
                 for(tmp = line; tmp != list_last_level_2; tmp = tmp->next) {
                     SET_BIT(tmp->bits, IS_UNORDERED_LIST_2);
                 }
+                until_level_2 = list_last_level_2;
+            }
 
-            // pass enclosing flag IS_UNORDERED_LIST_1
-            // to nested levels for unordered lists
-            } else if(CHECK_BIT(line->bits, IS_UNORDERED_LIST_1)) {
+        // pass enclosing flag IS_UNORDERED_LIST_1
+        // to nested levels for unordered lists
+        } else if(CHECK_BIT(line->bits, IS_UNORDERED_LIST_1)) {
+            if(!until_level_1) {
                 tmp = line->next;
                 line_t *list_last_level_1 = line;
 
@@ -384,24 +1184,432 @@ deck_t *markdown_load(FILE *input, int noexpand) {
                 for(tmp = line; tmp != list_last_level_1; tmp = tmp->next) {
                     SET_BIT(tmp->bits, IS_UNORDERED_LIST_1);
                 }
+                until_level_1 = list_last_level_1;
             }
+        }
 
-            line = line->next;
+        if(line == until_level_1)
+            until_level_1 = NULL;
+        if(line == until_level_2)
+            until_level_2 = NULL;
+        if(line == until_level_3)
+            until_level_3 = NULL;
+
+        line = line->next;
+    }
+}
+
+// post-process a complete slide of an eagerly loaded deck and move its
+// lines into the pack shared by all slides
+static void load_pack(deck_t *deck, slide_t *slide) {
+    if(slide == deck->slide)
+        load_header(deck);
+
+    load_finish(slide);
+    pack_slide(deck->pack, slide);
+}
+
+deck_t *markdown_load(FILE *input, int noexpand) {
+
+    int sc = 1;   // slide count
+
+    deck_t *deck = new_deck();
+    slide_t *slide = deck->slide; // first slide not packed yet
+    cstring_t *text = cstring_init();
+    uint64_t hash = FNV_BASIS;
+    long hashed = 0;
+    loader_t ld;
+    reader_t rd;
+
+    loader_init(&ld, deck->slide, noexpand);
+    reader_init(&rd, input, MAX(ftell(input), 0L), deck);
+    rd.hash = &hash;
+    rd.hashed = &hashed;
+    deck->pack = new_pack();
+
+    // forget lists and code fences of a previously loaded file
+    markdown_analyse_reset();
+
+    // check included files for changes
+    include_generation++;
+
+    if((deck->search = search_index))
+        search_begin(deck->search);
+
+    while(load_line(&rd, text)) {
+        switch(load_classify(&ld, text)) {
+            case LOAD_TEXT:
+                load_text(&ld, text);
+                if(deck->search)
+                    load_search(deck, text);
+                load_heading(deck, ld.bits, text,
+                             ld.line->prev && !CHECK_BIT(ld.line->prev->bits, IS_EMPTY) ?
+                             ld.line->prev->text : NULL, sc);
+                load_summary(deck, ld.bits, text, sc);
+
+                // new text
+                text = cstring_init();
+
+                // no stop can follow the last line of a previous slide
+                // anymore, so they are complete
+                for(; slide != ld.slide; slide = slide->next)
+                    load_pack(deck, slide);
+                break;
+
+            case LOAD_STOP:
+                SET_BIT(ld.line->bits, IS_STOP);
+                (text->reset)(text);
+                break;
+
+            case LOAD_SLIDE:
+                ld.slide->lines = ld.lc;
+                ld.lc = 0;
+
+                // create next slide
+                ld.slide = next_slide(ld.slide);
+                sc++;
+                if(deck->search)
+                    search_slide(deck->search);
+                (text->reset)(text);
+                break;
+
+            case LOAD_NOTE:
+                load_note(ld.slide, text);
+                (text->reset)(text);
+                break;
+
+            default:
+                // clear text
+                (text->reset)(text);
+                break;
         }
-        slide = slide->next;
     }
+    (text->delete)(text);
+    reader_free(&rd);
+
+    // the input was read completely
+    if(!ferror(input))
+        deck->hash = hash;
+
+    ld.slide->lines = ld.lc;
+    deck->slides = sc;
+    if(deck->search)
+        search_slide(deck->search);
+
+    for(; slide; slide = slide->next)
+        load_pack(deck, slide);
 
     return deck;
 }
 
-int markdown_analyse(cstring_t *text, int prev) {
+deck_t *markdown_index(FILE *input, int noexpand) {
+
+    deck_t *deck;
+    index_t *index;
+    long offset;
+
+    // slides are read again on demand, which needs a seekable input
+    if(fseek(input, 0, SEEK_CUR) != 0 || (offset = ftell(input)) < 0) {
+        deck = markdown_load(input, noexpand);
+        fclose(input);
+        return deck;
+    }
+
+    if((index = malloc(sizeof(index_t))) == NULL) {
+        fprintf(stderr, "%s\n", "markdown_index() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+
+    deck = new_deck();
+    deck->input = input;
+    deck->index = index;
+    deck->slides = 1;
+    deck->slide->offset = offset;
+    deck->slide->loaded = false;
+
+    loader_init(&index->loader, deck->slide, noexpand);
+    markdown_analyse_reset();
+    analyse_save(&index->analyse);
+    include_generation++;
+    if((deck->search = search_index))
+        search_begin(deck->search);
+    index->last = NULL;
+    index->offset = offset;
+    index->hash = FNV_BASIS;
+    index->hashed = offset;
+    index->skip = 0;
+    index->done = false;
+    index->recent = index->oldest = NULL;
+    index->budget = index->resident = 0;
+    index->hits = index->misses = index->evictions = 0;
+
+    // the first slide is shown right away, the second one is prefetched
+    markdown_scan(deck, 2);
+    markdown_parse(deck, deck->slide);
+
+    return deck;
+}
+
+bool markdown_scan(deck_t *deck, int slides) {
+
+    index_t *index = deck->index;
+    loader_t *ld;
+    cstring_t *text, *prev, *tmp;
+    reader_t rd;
+    int found = 0;
+
+    if(!index || index->done)
+        return false;
+
+    // only query if the scan is complete
+    if(slides <= 0)
+        return true;
+
+    ld = &index->loader;
+    analyse_restore(&index->analyse);
+    reader_init(&rd, index_seek(deck, index->offset), index->offset, deck);
+    rd.hash = &index->hash;
+    rd.hashed = &index->hashed;
+    load_skip(&rd, index->skip);
+    text = cstring_init();
+
+    // the scan stops after a hr only, so no headline is cut off
+    prev = cstring_init();
+
+    while(found < slides) {
+        if(!load_line(&rd, text)) {
+            index->done = true;
+            deck->hash = index->hash;
+            if(deck->search)
+                search_slide(deck->search);
+            break;
+        }
+        ld->slide->length++;
+
+        switch(load_classify(ld, text)) {
+            case LOAD_TEXT:
+                scan_expand(ld, text);
+                if(deck->search)
+                    load_search(deck, text);
+                load_heading(deck, ld->bits, text, ld->empty ? NULL : prev, deck->slides);
+                load_summary(deck, ld->bits, text, deck->slides);
+
+                ld->started = true;
+                ld->empty = CHECK_BIT(ld->bits, IS_EMPTY);
+                index->last = ld->slide;
+
+                // keep the line, the underline of a headline may follow
+                tmp = prev;
+                prev = text;
+                text = tmp;
+                break;
+
+            case LOAD_STOP:
+                // the last line is in one of the previous slides
+                if(index->last != ld->slide)
+                    index->last->stop_last = true;
+                break;
+
+            case LOAD_SLIDE:
+                // the hr is not part of either slide
+                ld->slide->length--;
+
+                ld->slide = next_slide(ld->slide);
+                ld->slide->offset = reader_tell(&rd, &ld->slide->skip);
+                ld->slide->loaded = false;
+                deck->slides++;
+                found++;
+                if(deck->search)
+                    search_slide(deck->search);
+                break;
+        }
+        (text->reset)(text);
+    }
+    (text->delete)(text);
+    (prev->delete)(prev);
+
+    analyse_save(&index->analyse);
+    index->offset = reader_tell(&rd, &index->skip);
+    reader_free(&rd);
+
+    return !index->done;
+}
 
-    // static variables can not be redeclaired, but changed outside of a declaration
-    // the program remembers their value on every function calls
-    static int unordered_list_level = 0;
-    static int unordered_list_level_offset[] = {-1, -1, -1, -1};
-    static int num_tilde_characters = 0;
-    static int num_backticks = 0;
+void markdown_parse(deck_t *deck, slide_t *slide) {
+
+    index_t *index = deck->index;
+    cstring_t *text;
+    reader_t rd;
+    loader_t ld;
+    int n;
+
+    if(!index)
+        return;
+
+    if(slide->loaded) {
+        index->hits++;
+        cache_use(index, slide);
+        return;
+    }
+    index->misses++;
+
+    // the scan has not reached the end of this slide yet
+    if(slide == index->loader.slide)
+        markdown_scan(deck, 1);
+
+    loader_init(&ld, slide, index->loader.noexpand);
+
+    // any other slide follows a hr, which follows an empty line
+    if(slide != deck->slide)
+        ld.started = ld.empty = true;
+
+    // no list or code fence continues across a hr
+    markdown_analyse_reset();
+    // invalid sequences were reported by the scan already
+    reader_init(&rd, index_seek(deck, slide->offset), slide->offset, NULL);
+    load_skip(&rd, slide->skip);
+    text = cstring_init();
+
+    for(n = 0; n < slide->length && load_line(&rd, text); n++) {
+        switch(load_classify(&ld, text)) {
+            case LOAD_TEXT:
+                load_text(&ld, text);
+                text = cstring_init();
+                break;
+
+            case LOAD_STOP:
+                // a stop before the first line belongs to the previous slide
+                if(ld.line)
+                    SET_BIT(ld.line->bits, IS_STOP);
+                (text->reset)(text);
+                break;
+
+            case LOAD_NOTE:
+                load_note(slide, text);
+                (text->reset)(text);
+                break;
+
+            default:
+                (text->reset)(text);
+                break;
+        }
+    }
+    (text->delete)(text);
+    reader_free(&rd);
+
+    slide->lines = ld.lc;
+    if(slide->stop_last && ld.line)
+        SET_BIT(ld.line->bits, IS_STOP);
+    slide->loaded = true;
+
+    if(slide == deck->slide)
+        load_header(deck);
+
+    load_finish(slide);
+
+    pack_slide(new_pack(), slide);
+
+    slide->bytes = slide_bytes(slide);
+    index->resident += slide->bytes;
+    cache_use(index, slide);
+    cache_evict(index);
+}
+
+void markdown_account(deck_t *deck, slide_t *slide) {
+    index_t *index = deck->index;
+    size_t bytes;
+
+    if(!index || !slide->loaded)
+        return;
+
+    bytes = slide_bytes(slide);
+    index->resident += bytes - slide->bytes;
+    slide->bytes = bytes;
+
+    // the slide is in use, it must not be unloaded
+    cache_use(index, slide);
+    cache_evict(index);
+}
+
+void markdown_cache(deck_t *deck, size_t budget) {
+    index_t *index = deck->index;
+
+    if(!index)
+        return;
+
+    index->budget = budget;
+    cache_evict(index);
+}
+
+void markdown_search(search_t *search) {
+    search_index = search;
+}
+
+void markdown_include_base(const char *file) {
+    free(include_base);
+    include_base = file ? include_dir(file) : NULL;
+}
+
+void markdown_include_scope(int scope) {
+    include_scope = scope;
+}
+
+void markdown_notes(bool notes) {
+    notes_enabled = notes;
+}
+
+void markdown_stats(deck_t *deck) {
+    index_t *index = deck->index;
+
+    if(fragments_included > 0) {
+        fwprintf(stderr, L"fragments included: %lu\n", fragments_included);
+        fwprintf(stderr, L"fragments parsed: %lu\n", fragments_parsed);
+    }
+
+    if(!index)
+        return;
+
+    fwprintf(stderr, L"slide cache hits: %lu\n", index->hits);
+    fwprintf(stderr, L"slide cache misses: %lu\n", index->misses);
+    fwprintf(stderr, L"slide cache evictions: %lu\n", index->evictions);
+    fwprintf(stderr, L"slide cache resident bytes: %zu (budget: %zu)\n",
+             index->resident, index->budget);
+}
+
+static void invalid_report(const char *name, unsigned long invalid, const long *offset) {
+    unsigned long i;
+
+    for(i = 0; i < invalid && i < INVALID_OFFSETS; i++)
+        fwprintf(stderr, L"%s: invalid UTF-8 sequence at byte offset %ld\n",
+                 name, offset[i]);
+
+    if(invalid > INVALID_OFFSETS)
+        fwprintf(stderr, L"%s: %lu more invalid UTF-8 sequences\n",
+                 name, invalid - INVALID_OFFSETS);
+}
+
+void markdown_invalid(deck_t *deck, const char *name) {
+    include_t *inc;
+
+    invalid_report(name, deck->invalid, deck->invalid_offset);
+
+    // the files included by the deck loaded last
+    for(inc = includes; inc; inc = inc->next)
+        if(inc->generation == include_generation)
+            invalid_report(inc->path, inc->fragment->invalid, inc->fragment->invalid_offset);
+}
+
+void markdown_analyse_reset(void) {
+    int i;
+
+    unordered_list_level = 0;
+    for(i = 0; i <= UNORDERED_LIST_MAX_LEVEL; i++)
+        unordered_list_level_offset[i] = -1;
+    num_tilde_characters = 0;
+    num_backticks = 0;
+}
+
+int markdown_analyse(cstring_t *text, int prev) {
 
     int i = 0;      // increment
     int bits = 0;   // markdown bits
@@ -676,7 +1884,7 @@ void markdown_debug(deck_t *deck, int debug) {
     }
 
     slide_t *slide = deck->slide;
-    line_t *line;
+    int i;
 
     // print slide/line count to STDERR
     while(slide) {
@@ -689,12 +1897,10 @@ void markdown_debug(deck_t *deck, int debug) {
 
             // also print bits and line length
             fwprintf(stderr, L"  slide %i:\n", sc);
-            line = slide->line;
             lc = 0;
-            while(line) {
+            for(i = slide->first; slide->pack && i < slide->first + slide->lines; i++) {
                 lc++;
-                fwprintf(stderr, L"    line %i: bits = %i, length = %i\n", lc, line->bits, line->length);
-                line = line->next;
+                fwprintf(stderr, L"    line %i: bits = %i, length = %i\n", lc, slide->pack->bits[i], slide->pack->length[i]);
             }
         }
 
@@ -702,81 +1908,83 @@ void markdown_debug(deck_t *deck, int debug) {
     }
 }
 
-void expand_character_entities(line_t *line)
-{
-    wchar_t *ampersand;
-    wchar_t *prev, *curr;
-
-    ampersand = NULL;
-    curr = &line->text->value[0];
-
-    // for each char in line
-    for(prev = NULL; *curr; prev = curr++) {
-        if (*curr == L'&' && (prev == NULL || *prev != L'\\')) {
-            ampersand = curr;
-            continue;
-        }
-        if (ampersand == NULL) {
-            continue;
-        }
-        if (*curr == L'#') {
-            if (prev == ampersand)
-                continue;
-            ampersand = NULL;
-            continue;
+// decode the name of a character entity between '&' and ';'
+// returns L'\0' if it is not a valid entity
+static wchar_t character_entity(const wchar_t *name, size_t len) {
+    unsigned long ucs = 0;
+    int base = 10, digit;
+    size_t i = 1;
+
+    if(name[0] == L'#') { // &#nnnn; or &#xhhhh;
+        if(len > 1 && name[1] == L'x') {
+            base = 16;
+            i = 2;
         }
-        if (iswalpha(*curr) || iswxdigit(*curr)) {
-            continue;
+        if(i >= len)
+            return L'\0';
+
+        for(; i < len; i++) {
+            if(name[i] >= L'0' && name[i] <= L'9') {
+                digit = name[i] - L'0';
+            } else if(base == 16 && name[i] >= L'a' && name[i] <= L'f') {
+                digit = name[i] - L'a' + 10;
+            } else if(base == 16 && name[i] >= L'A' && name[i] <= L'F') {
+                digit = name[i] - L'A' + 10;
+            } else {
+                return L'\0';
+            }
+            ucs = ucs * base + digit;
+
+            // beyond unicode
+            if(ucs > 0x10FFFF)
+                return L'\0';
         }
-        if (*curr == L';') {
-            int cnt;
-            wchar_t ucs = L'\0';
-            if (ampersand + 1 >= curr || ampersand + 16 < curr) { // what is a good limit?
+        return (wchar_t) ucs;
+    }
+
+    // &name;
+    for(i = 0; named_character_entities[i].name; i++) {
+        if(wcslen(named_character_entities[i].name) == len &&
+           !wcsncmp(named_character_entities[i].name, name, len))
+            return named_character_entities[i].ucs;
+    }
+    return L'\0';
+}
+
+void expand_character_entities(line_t *line)
+{
+    wchar_t *value = line->text->value;
+    wchar_t *ampersand = NULL; // start of the entity in the output
+    wchar_t *in, *out;
+    wchar_t ucs;
+    size_t len;
+
+    // entities are replaced in place, chars after a replaced entity are
+    // moved down while reading, so the line is only passed once
+    for(in = out = value; *in; in++) {
+        *out = *in;
+        if (*in == L'&' && (out == value || out[-1] != L'\\')) {
+            ampersand = out;
+        } else if (ampersand == NULL) {
+            // regular char
+        } else if (*in == L'#') {
+            if (out - 1 != ampersand)
                 ampersand = NULL;
-                continue;
-            }
-            if (ampersand[1] == L'#') { // &#nnnn; or &#xhhhh;
-                if (ampersand + 2 >= curr) {
-                    ampersand = NULL;
-                    continue;
-                }
-                if (ampersand[2] != L'x') { // &#nnnn;
-                    cnt = wcsspn(&ampersand[2], L"0123456789");
-                    if (ampersand + 2 + cnt != curr) {
-                        ampersand = NULL;
-                        continue;
-                    }
-                    ucs = wcstoul(&ampersand[2], NULL, 10);
-                } else { // &#xhhhh;
-                    if (ampersand + 3 >= curr) {
-                        ampersand = NULL;
-                        continue;
-                    }
-                    cnt = wcsspn(&ampersand[3], L"0123456789abcdefABCDEF");
-                    if (ampersand + 3 + cnt != curr) {
-                        ampersand = NULL;
-                        continue;
-                    }
-                    ucs = wcstoul(&ampersand[3], NULL, 16);
-                }
-            } else { // &name;
-                for (cnt = 0; cnt < sizeof(named_character_entities)/sizeof(named_character_entities[0]); ++cnt) {
-                    if (wcsncmp(named_character_entities[cnt].name, &ampersand[1], curr - ampersand - 1))
-                        continue;
-                    ucs = named_character_entities[cnt].ucs;
-                    break;
-                }
-                if (ucs == L'\0') {
-                    ampersand = NULL;
-                    continue;
-                }
+        } else if (*in == L';') {
+            len = out - ampersand - 1;
+            if (len > 0 && len < 16 && // what is a good limit?
+                (ucs = character_entity(&ampersand[1], len)) != L'\0') {
+                *ampersand = ucs;
+                out = ampersand;
             }
-            *ampersand = ucs;
-            cstring_strip(line->text, ampersand + 1 - &line->text->value[0], curr - ampersand);
-            curr = ampersand;
+            ampersand = NULL;
+        } else if (!iswalpha(*in) && !iswxdigit(*in)) {
             ampersand = NULL;
         }
+        out++;
     }
+    *out = L'\0';
+    line->text->size -= in - out;
 }
 
 void adjust_line_length(line_t *line) {
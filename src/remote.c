@@ -0,0 +1,409 @@
+/*
+ * Remote control of the viewer through a local socket.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>     // INT_MAX
+#include <stdio.h>      // fprintf, snprintf
+#include <stdlib.h>     // calloc, realloc, strtol, free
+#include <string.h>     // strcmp, strtok, strdup
+#include <sys/socket.h>
+#include <sys/stat.h>   // lstat
+#include <sys/un.h>
+#include <unistd.h>     // close, read, unlink
+
+#include "remote.h"
+
+#define REMOTE_BACKLOG 8 // connections not accepted yet
+
+// SO_NOSIGPIPE is set on the socket where there is no MSG_NOSIGNAL
+#if !defined( MSG_NOSIGNAL )
+#define MSG_NOSIGNAL 0
+#endif
+
+// argument of a command
+enum { ARG_NONE, ARG_COUNT, ARG_NUMBER };
+
+static const struct {
+    const char *name;
+    action_t action;
+    int arg;
+} command_names[] = {
+    { "next",   ACTION_NEXT,   ARG_COUNT },
+    { "prev",   ACTION_PREV,   ARG_COUNT },
+    { "first",  ACTION_FIRST,  ARG_NONE },
+    { "last",   ACTION_LAST,   ARG_NONE },
+    { "goto",   ACTION_GOTO,   ARG_NUMBER },
+    { "reveal", ACTION_REVEAL, ARG_NONE },
+    { "reload", ACTION_RELOAD, ARG_NONE },
+    { "quit",   ACTION_QUIT,   ARG_NONE },
+    { "status", ACTION_NONE,   ARG_NONE },
+    { "follow", ACTION_NONE,   ARG_NONE },
+    { NULL,     ACTION_NONE,   ARG_NONE }
+};
+
+static void remote_accept(event_t *ev, int fd, void *data);
+static void remote_read(event_t *ev, int fd, void *data);
+
+int remote_socket(int fd) {
+#if defined( SO_NOSIGPIPE )
+    int on = 1;
+#endif
+    int flags, err;
+
+    if(fd < 0)
+        return -1;
+
+    if((flags = fcntl(fd, F_GETFL)) < 0 ||
+       fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0 ||
+       fcntl(fd, F_SETFD, FD_CLOEXEC) < 0
+#if defined( SO_NOSIGPIPE )
+       || setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on)) < 0
+#endif
+       ) {
+        err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+
+    return fd;
+}
+
+remote_t *remote_init(event_t *ev, const char *path) {
+    struct sockaddr_un addr;
+    struct stat st;
+    remote_t *r;
+    int fd, err;
+
+    if(strlen(path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return NULL;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    // a socket nobody accepts on is left by a process which is gone
+    if((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+        return NULL;
+    if(connect(fd, (struct sockaddr *) &addr, sizeof(addr)) == 0) {
+        close(fd);
+        errno = EADDRINUSE;
+        return NULL;
+    }
+    err = errno;
+    close(fd);
+
+    // connect is refused by any file which is not a listening socket, only
+    // a socket is replaced
+    if(lstat(path, &st) == 0) {
+        if(!S_ISSOCK(st.st_mode) || err != ECONNREFUSED) {
+            errno = S_ISSOCK(st.st_mode) ? err : EEXIST;
+            return NULL;
+        }
+        unlink(path);
+    }
+
+    if((fd = remote_socket(socket(AF_UNIX, SOCK_STREAM, 0))) < 0)
+        return NULL;
+    if(bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+       lstat(path, &st) < 0 ||
+       listen(fd, REMOTE_BACKLOG) < 0) {
+        err = errno;
+        close(fd);
+        errno = err;
+        return NULL;
+    }
+
+    r = calloc(1, sizeof(remote_t));
+    if(!r || !(r->path = strdup(path))) {
+        fprintf(stderr, "%s\n", "remote_init() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+    r->ev = ev;
+    r->fd = fd;
+    r->dev = st.st_dev;
+    r->ino = st.st_ino;
+    event_watch(ev, fd, remote_accept, r);
+
+    return r;
+}
+
+static void remote_reply(int fd, const char *s) {
+    // a client which does not read its replies loses them
+    if(fd >= 0)
+        send(fd, s, strlen(s), MSG_NOSIGNAL);
+}
+
+static void remote_wait(remote_t *r, int fd, const char *error) {
+    if(r->waits == r->max_waits) {
+        r->max_waits = r->max_waits ? r->max_waits * 2 : 4;
+        if(!(r->waiting = realloc(r->waiting, r->max_waits * sizeof(remote_reply_t)))) {
+            fprintf(stderr, "%s\n", "remote_wait() failed to allocate memory.");
+            exit(EXIT_FAILURE);
+        }
+    }
+    r->waiting[r->waits++] = (remote_reply_t) { fd, error };
+}
+
+static void remote_queue(remote_t *r, int fd, action_t action, int count, const char *error) {
+    if(r->commands == r->max_commands) {
+        r->max_commands = r->max_commands ? r->max_commands * 2 : 4;
+        if(!(r->command = realloc(r->command, r->max_commands * sizeof(remote_command_t)))) {
+            fprintf(stderr, "%s\n", "remote_queue() failed to allocate memory.");
+            exit(EXIT_FAILURE);
+        }
+    }
+    r->command[r->commands++] = (remote_command_t) { action, count, fd, error };
+    event_wake(r->ev);
+}
+
+// format the state shown last
+static void remote_format(const remote_t *r, char *s, size_t size) {
+    snprintf(s, size, "slide %d/%d stop %d/%d deck %016llx\n",
+             r->sc, r->slides, r->stop, r->stops, (unsigned long long) r->hash);
+}
+
+// reply to a client unless replies to its commands are still due, it is
+// queued behind them then
+static void remote_answer(remote_t *r, int fd, const char *error) {
+    char reply[96];
+    int i;
+
+    for(i = 0; i < r->commands; i++)
+        if(r->command[i].fd == fd)
+            break;
+    if(i < r->commands) {
+        remote_queue(r, fd, ACTION_NONE, 0, error);
+        return;
+    }
+
+    for(i = 0; i < r->waits; i++)
+        if(r->waiting[i].fd == fd)
+            break;
+    if(i < r->waits || (!error && !r->sc)) {
+        // the state is not known unless a slide was shown yet
+        remote_wait(r, fd, error);
+    } else if(error) {
+        remote_reply(fd, error);
+    } else {
+        remote_format(r, reply, sizeof(reply));
+        remote_reply(fd, reply);
+    }
+}
+
+static remote_client_t *remote_find(remote_t *r, int fd) {
+    int i;
+
+    for(i = 0; i < r->clients; i++)
+        if(r->client[i].fd == fd)
+            return &r->client[i];
+
+    return NULL;
+}
+
+// parse a command line of a client
+static void remote_command(remote_t *r, int fd, char *line) {
+    char *name, *arg, *extra, *end;
+    long n = 0;
+    int i;
+
+    if(!(name = strtok(line, " \t\r")))
+        return; // a blank line is ignored
+    arg = strtok(NULL, " \t\r");
+    extra = strtok(NULL, " \t\r");
+
+    for(i = 0; command_names[i].name; i++)
+        if(!strcmp(name, command_names[i].name))
+            break;
+
+    if(arg) {
+        n = strtol(arg, &end, 10);
+        if(*end || n <= 0 || n >= INT_MAX)
+            n = -1;
+    }
+
+    if(!command_names[i].name) {
+        remote_answer(r, fd, "error: unknown command\n");
+    } else if(arg && (command_names[i].arg == ARG_NONE || extra || n < 0)) {
+        remote_answer(r, fd, "error: invalid argument\n");
+    } else if(!arg && command_names[i].arg == ARG_NUMBER) {
+        remote_answer(r, fd, "error: slide number expected\n");
+    } else if(command_names[i].action == ACTION_NONE) {
+        // the reply to follow is the state to start from
+        if(!strcmp(name, "follow"))
+            remote_find(r, fd)->follows = true;
+        remote_answer(r, fd, NULL);
+    } else {
+        remote_queue(r, fd, command_names[i].action, n, NULL);
+    }
+}
+
+static void remote_accept(event_t *ev, int fd, void *data) {
+    remote_t *r = data;
+    int client;
+
+    while((client = accept(fd, NULL, NULL)) >= 0) {
+        if(remote_socket(client) < 0)
+            continue;
+        if(r->clients == r->max_clients) {
+            r->max_clients = r->max_clients ? r->max_clients * 2 : 4;
+            if(!(r->client = realloc(r->client, r->max_clients * sizeof(remote_client_t)))) {
+                fprintf(stderr, "%s\n", "remote_accept() failed to allocate memory.");
+                exit(EXIT_FAILURE);
+            }
+        }
+        r->client[r->clients].fd = client;
+        r->client[r->clients].len = 0;
+        r->client[r->clients].follows = false;
+        r->clients++;
+        event_watch(ev, client, remote_read, r);
+    }
+}
+
+static void remote_close(remote_t *r, int i) {
+    int fd = r->client[i].fd, j;
+
+    event_unwatch(r->ev, fd);
+    close(fd);
+    r->clients--;
+    memmove(&r->client[i], &r->client[i + 1], (r->clients - i) * sizeof(remote_client_t));
+
+    // the fd may be reused by the next client
+    for(j = 0; j < r->commands; j++)
+        if(r->command[j].fd == fd)
+            r->command[j].fd = -1;
+    for(j = 0; j < r->waits; j++)
+        if(r->waiting[j].fd == fd)
+            r->waiting[j].fd = -1;
+}
+
+static void remote_read(event_t *ev, int fd, void *data) {
+    remote_t *r = data;
+    remote_client_t *c = remote_find(r, fd);
+    char buf[512];
+    ssize_t n;
+    int i;
+
+    if(!c)
+        return;
+
+    if((n = read(fd, buf, sizeof(buf))) <= 0) {
+        if(n == 0 || (errno != EAGAIN && errno != EINTR))
+            remote_close(r, c - r->client);
+        return;
+    }
+
+    for(i = 0; i < n; i++) {
+        if(buf[i] == '\n') {
+            if(c->len < REMOTE_LINE) {
+                c->line[c->len] = '\0';
+                remote_command(r, fd, c->line);
+            } else {
+                remote_answer(r, fd, "error: command too long\n");
+            }
+            c->len = 0;
+        } else if(c->len < REMOTE_LINE - 1) {
+            c->line[c->len++] = buf[i];
+        } else {
+            c->len = REMOTE_LINE; // too long, dropped at the end of the line
+        }
+    }
+}
+
+bool remote_pending(const remote_t *r) {
+    return r->commands > 0;
+}
+
+bool remote_take(remote_t *r, action_t *action, int *count) {
+    remote_command_t cmd;
+
+    while(r->commands) {
+        cmd = r->command[0];
+        r->commands--;
+        memmove(&r->command[0], &r->command[1], r->commands * sizeof(remote_command_t));
+
+        if(cmd.fd >= 0)
+            remote_wait(r, cmd.fd, cmd.error);
+        if(cmd.action != ACTION_NONE) {
+            *action = cmd.action;
+            *count = cmd.count;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void remote_state(remote_t *r, int sc, int slides, int stop, int stops, uint64_t hash) {
+    bool changed = sc != r->sc || stop != r->stop || hash != r->hash;
+    char reply[96];
+    int i, j;
+
+    r->sc = sc;
+    r->slides = slides;
+    r->stop = stop;
+    r->stops = stops;
+    r->hash = hash;
+
+    if(!r->waits && !changed)
+        return;
+
+    remote_format(r, reply, sizeof(reply));
+    for(i = 0; i < r->waits; i++)
+        remote_reply(r->waiting[i].fd, r->waiting[i].error ? r->waiting[i].error : reply);
+
+    // followers get a change once, a reply to them tells it already
+    if(changed) {
+        for(i = 0; i < r->clients; i++) {
+            for(j = 0; j < r->waits; j++)
+                if(r->waiting[j].fd == r->client[i].fd && !r->waiting[j].error)
+                    break;
+            if(r->client[i].follows && j == r->waits)
+                remote_reply(r->client[i].fd, reply);
+        }
+    }
+    r->waits = 0;
+}
+
+void remote_delete(remote_t *r) {
+    struct stat st;
+    int i;
+
+    for(i = 0; i < r->clients; i++) {
+        event_unwatch(r->ev, r->client[i].fd);
+        close(r->client[i].fd);
+    }
+    event_unwatch(r->ev, r->fd);
+    close(r->fd);
+
+    // the path may have been replaced since, by another viewer or anything
+    if(lstat(r->path, &st) == 0 && S_ISSOCK(st.st_mode) &&
+       st.st_dev == r->dev && st.st_ino == r->ino)
+        unlink(r->path);
+
+    free(r->path);
+    free(r->client);
+    free(r->command);
+    free(r->waiting);
+    free(r);
+}
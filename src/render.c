@@ -0,0 +1,337 @@
+/*
+ * Output backends used by the viewer to draw slides and read keys.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#define _GNU_SOURCE              // enable ncurses wchar support
+#define _XOPEN_SOURCE_EXTENDED 1 // enable ncurses wchar support
+
+#include <wchar.h>
+#include <stdio.h>  // fprintf
+#include <stdlib.h> // malloc, free, getenv
+#include <unistd.h> // STDOUT_FILENO
+#include <sys/ioctl.h>
+
+#if defined( WIN32 )
+#include <curses.h>
+#else
+#include <ncurses.h>
+#endif
+
+#include "render.h"
+
+typedef struct _ncurses_data_t {
+    WINDOW *window;  // window selected by the viewport
+    WINDOW *content; // window used for any viewport but the full screen
+    bool drawn;      // content window was used in this frame
+    bool clipped;    // cursor moved outside of the window
+    bool started;
+} ncurses_data_t;
+
+#define NC(self) ((ncurses_data_t *)(self)->data)
+
+static attr_t ncurses_attr(int attr) {
+    attr_t a = COLOR_PAIR(GA_PAIR(attr));
+    if(attr & GA_UNDERLINE)
+        a |= A_UNDERLINE;
+    if(attr & GA_REVERSE)
+        a |= A_REVERSE;
+    return a;
+}
+
+static bool ncurses_open(render_t *self) {
+    ncurses_data_t *d = NC(self);
+
+    if(!d->started) {
+        initscr();
+        d->started = true;
+    } else {
+        refresh();
+    }
+
+    // disable cursor
+    curs_set(0);
+
+    // disable output of keyboard typing
+    noecho();
+
+    // make getch() process one char at a time
+    cbreak();
+
+    // enable arrow keys
+    keypad(stdscr, TRUE);
+
+    if(has_colors() == TRUE) {
+        start_color();
+        use_default_colors();
+        self->colors = 1;
+    }
+
+    if(!d->content)
+        d->content = newwin(LINES, COLS, 0, 0);
+    d->window = stdscr;
+
+    self->lines = LINES;
+    self->cols = COLS;
+    return true;
+}
+
+static void ncurses_close(render_t *self) {
+    ncurses_data_t *d = NC(self);
+
+    // disable ncurses
+    endwin();
+
+    // free ncurses memory
+    if(d->content) {
+        delwin(d->content);
+        d->content = NULL;
+    }
+}
+
+static void ncurses_init_pair(render_t *self, int pair, int fg, int bg) {
+    init_pair(pair, fg, bg);
+}
+
+static void ncurses_bkgd(render_t *self, int attr) {
+    wbkgd(stdscr, ncurses_attr(attr));
+    wbkgd(NC(self)->content, ncurses_attr(attr));
+}
+
+static void ncurses_erase(render_t *self) {
+    // pick up changes of the terminal geometry
+    self->lines = LINES;
+    self->cols = COLS;
+
+    werase(NC(self)->content);
+    werase(stdscr);
+    NC(self)->window = stdscr;
+    NC(self)->drawn = false;
+    NC(self)->clipped = false;
+}
+
+static void ncurses_viewport(render_t *self, int top, int height) {
+    ncurses_data_t *d = NC(self);
+
+    d->clipped = false;
+    if(top == 0 && height >= LINES) {
+        d->window = stdscr;
+        return;
+    }
+
+    // always resize window in case terminal geometry has changed
+    wresize(d->content, height, COLS);
+    mvwin(d->content, top, 0);
+    d->window = d->content;
+    d->drawn = true;
+}
+
+// rows outside of the window are dropped like the grid does, ncurses
+// would leave the cursor where it is and draw there instead
+static void ncurses_move(render_t *self, int y, int x) {
+    ncurses_data_t *d = NC(self);
+
+    d->clipped = y < 0 || y >= getmaxy(d->window);
+    if(!d->clipped)
+        wmove(d->window, y, x);
+}
+
+static void ncurses_addnwstr(render_t *self, const wchar_t *s, int n) {
+    if(!NC(self)->clipped)
+        waddnwstr(NC(self)->window, s, n);
+}
+
+static void ncurses_attron(render_t *self, int attr) {
+    if(GA_PAIR(attr))
+        wattron(NC(self)->window, COLOR_PAIR(GA_PAIR(attr)));
+    if(attr & GA_UNDERLINE)
+        wattron(NC(self)->window, A_UNDERLINE);
+    if(attr & GA_REVERSE)
+        wattron(NC(self)->window, A_REVERSE);
+}
+
+static void ncurses_attroff(render_t *self, int attr) {
+    wattroff(NC(self)->window, ncurses_attr(attr));
+}
+
+static int ncurses_getx(render_t *self) {
+    return getcurx(NC(self)->window);
+}
+
+static void ncurses_flush(render_t *self) {
+    ncurses_data_t *d = NC(self);
+
+    // copy changed lines to virtual screen
+    wnoutrefresh(stdscr);
+    if(d->drawn)
+        wnoutrefresh(d->content);
+
+    // compare virtual screen to physical screen and does the actual updates
+    doupdate();
+
+    self->frames++;
+}
+
+static int ncurses_getkey(render_t *self, int timeout) {
+    int c;
+
+    if(timeout < 0)
+        return getch();
+
+    // poll without waiting
+    if(timeout == 0) {
+        nodelay(stdscr, TRUE);
+        c = getch();
+        nodelay(stdscr, FALSE);
+        return c;
+    }
+
+    // block for tenths of a second when using getch, ERR if no input
+    halfdelay(timeout);
+    c = getch();
+    nocbreak();     // cancel half delay mode
+    cbreak();       // go back to cbreak
+    return c;
+}
+
+static void ncurses_delete(render_t *self) {
+    free(self->data);
+    free(self);
+}
+
+render_t *render_new(void) {
+    render_t *x = NULL;
+    if((x = malloc(sizeof(render_t))) != NULL) {
+        x->lines = x->cols = x->colors = 0;
+        x->input = -1;
+        x->frames = x->bytes = x->last_bytes = 0;
+        x->data = NULL;
+        x->addstr = render_addstr;
+        x->blit = render_blit;
+    } else {
+        fprintf(stderr, "%s\n", "render_new() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+    return x;
+}
+
+render_t *render_ncurses_init(void) {
+    render_t *x = render_new();
+    ncurses_data_t *d = NULL;
+
+    if((d = malloc(sizeof(ncurses_data_t))) == NULL) {
+        fprintf(stderr, "%s\n", "render_ncurses_init() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+    d->window = d->content = NULL;
+    d->drawn = d->started = d->clipped = false;
+
+    x->data = d;
+    x->open = ncurses_open;
+    x->close = ncurses_close;
+    x->init_pair = ncurses_init_pair;
+    x->bkgd = ncurses_bkgd;
+    x->erase = ncurses_erase;
+    x->viewport = ncurses_viewport;
+    x->move = ncurses_move;
+    x->addnwstr = ncurses_addnwstr;
+    x->attron = ncurses_attron;
+    x->attroff = ncurses_attroff;
+    x->getx = ncurses_getx;
+    x->flush = ncurses_flush;
+    x->getkey = ncurses_getkey;
+    x->delete = ncurses_delete;
+    x->input = STDIN_FILENO;
+    return x;
+}
+
+void render_addstr(render_t *self, const char *s) {
+    wchar_t buf[256];
+    mbstate_t state = { 0 };
+    size_t n;
+
+    while(s) {
+        n = mbsrtowcs(buf, &s, sizeof(buf) / sizeof(buf[0]) - 1, &state);
+        if(n == (size_t) -1)
+            return;
+        (self->addnwstr)(self, buf, n);
+    }
+}
+
+void render_geometry(int *lines, int *cols) {
+    struct winsize ws;
+    const char *env;
+
+    if(ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0 && ws.ws_col > 0) {
+        *lines = ws.ws_row;
+        *cols = ws.ws_col;
+    } else {
+        *lines = (env = getenv("LINES")) && atoi(env) > 0 ? atoi(env) : 24;
+        *cols = (env = getenv("COLUMNS")) && atoi(env) > 0 ? atoi(env) : 80;
+    }
+}
+
+// draw the cells through the backend, a run of cells of the same
+// attribute at a time, blank cells are left to erase
+bool render_blit(render_t *self, const grid_t *g) {
+    wchar_t run[256];
+    const cell_t *cell;
+    int y, x, n, attr;
+
+    if(g->lines != self->lines || g->cols != self->cols)
+        return false;
+
+    (self->erase)(self);
+    (self->viewport)(self, 0, self->lines);
+
+    for(y = 0; y < g->lines; y++) {
+        cell = &g->cells[y * g->cols];
+        for(x = 0; x < g->cols;) {
+            if(cell[x].c == L' ' && !cell[x].attr) {
+                x++;
+                continue;
+            }
+
+            attr = cell[x].attr;
+            (self->move)(self, y, x);
+            for(n = 0; x < g->cols && cell[x].attr == attr && n < 255; x++) {
+                // the right half of a double width char is drawn by the left one
+                if(cell[x].c)
+                    run[n++] = cell[x].c;
+            }
+            run[n] = L'\0';
+
+            (self->attroff)(self, GA_UNDERLINE | GA_REVERSE);
+            (self->attron)(self, attr);
+            (self->addnwstr)(self, run, n);
+        }
+    }
+    (self->attroff)(self, GA_UNDERLINE | GA_REVERSE);
+
+    return true;
+}
+
+void render_stats(render_t *self) {
+    fwprintf(stderr, L"frames: %lu\n", self->frames);
+    if(self->bytes > 0) {
+        fwprintf(stderr, L"bytes: %lu\n", self->bytes);
+        fwprintf(stderr, L"bytes per frame: %lu (last frame: %lu)\n",
+                 self->bytes / (self->frames ? self->frames : 1), self->last_bytes);
+    }
+}
@@ -0,0 +1,470 @@
+/*
+ * Trigram index over the text of the slides of a deck.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>  // fprintf
+#include <stdlib.h> // malloc, realloc, free, qsort
+#include <wctype.h> // towlower
+
+#include "search.h"
+
+#define SEARCH_TABLE 1024 // initial entries of the hash tables
+
+// three folded chars, each of them fits into 21 bits
+#define GRAM_KEY(t) (((uint64_t) (t)[0] << 42) | ((uint64_t) (t)[1] << 21) | (uint64_t) (t)[2])
+
+static void *search_realloc(void *ptr, size_t size) {
+    if((ptr = realloc(ptr, size)) == NULL) {
+        fprintf(stderr, "%s\n", "search_realloc() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+static size_t key_slot(uint64_t key, size_t mask) {
+    return (size_t) ((key * 0x9e3779b97f4a7c15ULL) >> 32) & mask;
+}
+
+static int cmp_int(const void *a, const void *b) {
+    int x = *(const int *) a, y = *(const int *) b;
+    return (x > y) - (x < y);
+}
+
+static bool doc_live(const search_t *s, int id) {
+    return s->docs[id].generation == s->generation && s->docs[id].size > 0;
+}
+
+// id of the doc with the given hash, -1 if there is none
+static int doc_find(const search_t *s, uint64_t hash) {
+    size_t i;
+
+    for(i = key_slot(hash, s->doc_mask); s->doc_table[i] >= 0; i = (i + 1) & s->doc_mask) {
+        if(s->docs[s->doc_table[i]].hash == hash)
+            return s->doc_table[i];
+    }
+    return -1;
+}
+
+static void doc_insert(search_t *s, int id) {
+    size_t i;
+
+    for(i = key_slot(s->docs[id].hash, s->doc_mask); s->doc_table[i] >= 0; i = (i + 1) & s->doc_mask);
+    s->doc_table[i] = id;
+}
+
+// rebuild the doc table with the given amount of entries
+static void doc_rehash(search_t *s, size_t entries) {
+    size_t i;
+    int id;
+
+    s->doc_mask = entries - 1;
+    s->doc_table = search_realloc(s->doc_table, entries * sizeof(int));
+    for(i = 0; i < entries; i++)
+        s->doc_table[i] = -1;
+    for(id = 0; id < s->ndocs; id++)
+        doc_insert(s, id);
+}
+
+static int doc_add(search_t *s, uint64_t hash) {
+    search_doc_t *doc;
+
+    if(s->ndocs == s->max_docs) {
+        s->max_docs *= 2;
+        s->docs = search_realloc(s->docs, s->max_docs * sizeof(search_doc_t));
+    }
+    doc = &s->docs[s->ndocs];
+    doc->hash = hash;
+    doc->slides = NULL;
+    doc->size = doc->alloc = 0;
+    doc->generation = s->generation;
+    s->ndocs++;
+
+    // keep the table at most half full
+    if((size_t) s->ndocs * 2 > s->doc_mask + 1)
+        doc_rehash(s, (s->doc_mask + 1) * 2);
+    else
+        doc_insert(s, s->ndocs - 1);
+
+    return s->ndocs - 1;
+}
+
+static search_posting_t *posting_find(const search_t *s, uint64_t key) {
+    size_t i;
+
+    for(i = key_slot(key, s->posting_mask); s->postings[i].key; i = (i + 1) & s->posting_mask) {
+        if(s->postings[i].key == key)
+            return &s->postings[i];
+    }
+    return NULL;
+}
+
+// the entry of key, or the empty entry it belongs into
+static search_posting_t *posting_slot(search_posting_t *postings, size_t mask, uint64_t key) {
+    size_t i;
+
+    for(i = key_slot(key, mask); postings[i].key && postings[i].key != key; i = (i + 1) & mask);
+    return &postings[i];
+}
+
+static void posting_rehash(search_t *s, size_t entries) {
+    search_posting_t *postings = calloc(entries, sizeof(search_posting_t));
+    size_t i;
+
+    if(!postings) {
+        fprintf(stderr, "%s\n", "posting_rehash() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+
+    s->postings_used = 0;
+    for(i = 0; i <= s->posting_mask; i++) {
+        if(s->postings[i].size > 0) {
+            *posting_slot(postings, entries - 1, s->postings[i].key) = s->postings[i];
+            s->postings_used++;
+        } else {
+            free(s->postings[i].docs);
+        }
+    }
+    free(s->postings);
+    s->postings = postings;
+    s->posting_mask = entries - 1;
+}
+
+static void posting_add(search_t *s, uint64_t key, int id) {
+    search_posting_t *p;
+
+    if((s->postings_used + 1) * 2 > s->posting_mask + 1)
+        posting_rehash(s, (s->posting_mask + 1) * 2);
+
+    p = posting_slot(s->postings, s->posting_mask, key);
+    if(!p->key) {
+        p->key = key;
+        s->postings_used++;
+    }
+
+    // ids are added in ascending order, so a repeated trigram of the
+    // same doc is always the last one
+    if(p->size > 0 && p->docs[p->size - 1] == id)
+        return;
+
+    if(p->size == p->alloc) {
+        p->alloc = p->alloc ? p->alloc * 2 : 4;
+        p->docs = search_realloc(p->docs, p->alloc * sizeof(int));
+    }
+    p->docs[p->size++] = id;
+}
+
+// trigrams of n folded chars, none of them spans a line
+static size_t gram_keys(search_t *s, const wchar_t *text, size_t n) {
+    size_t i, k = 0;
+
+    if(n < SEARCH_GRAM)
+        return 0;
+
+    if(n > s->max_keys) {
+        s->max_keys = n;
+        s->keys = search_realloc(s->keys, s->max_keys * sizeof(uint64_t));
+    }
+
+    for(i = 0; i + SEARCH_GRAM <= n; i++) {
+        if(text[i] == L'\n' || text[i + 1] == L'\n' || text[i + 2] == L'\n')
+            continue;
+        s->keys[k++] = GRAM_KEY(&text[i]);
+    }
+    return k;
+}
+
+// drop the docs which were not part of the last deck and renumber the
+// others, the order of the ids is kept, so posting lists stay sorted
+static void search_compact(search_t *s) {
+    int *map = malloc(s->ndocs * sizeof(int));
+    search_posting_t *p;
+    size_t i;
+    int id, live = 0, j, k;
+
+    if(!map) {
+        fprintf(stderr, "%s\n", "search_compact() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+
+    for(id = 0; id < s->ndocs; id++) {
+        if(doc_live(s, id)) {
+            map[id] = live;
+            s->docs[live++] = s->docs[id];
+        } else {
+            map[id] = -1;
+            free(s->docs[id].slides);
+        }
+    }
+    s->ndocs = live;
+
+    for(i = 0; i <= s->posting_mask; i++) {
+        p = &s->postings[i];
+        for(j = k = 0; j < p->size; j++) {
+            if(map[p->docs[j]] >= 0)
+                p->docs[k++] = map[p->docs[j]];
+        }
+        p->size = k;
+    }
+    free(map);
+
+    // empty posting lists are dropped while rehashing
+    posting_rehash(s, s->posting_mask + 1);
+    doc_rehash(s, s->doc_mask + 1);
+    s->compacted++;
+}
+
+search_t *search_init(void) {
+    search_t *s = malloc(sizeof(search_t));
+
+    if(!s) {
+        fprintf(stderr, "%s\n", "search_init() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+
+    s->ndocs = 0;
+    s->max_docs = SEARCH_TABLE;
+    s->docs = search_realloc(NULL, s->max_docs * sizeof(search_doc_t));
+    s->doc_table = NULL;
+    doc_rehash(s, SEARCH_TABLE);
+
+    s->postings_used = 0;
+    s->posting_mask = SEARCH_TABLE - 1;
+    if((s->postings = calloc(SEARCH_TABLE, sizeof(search_posting_t))) == NULL) {
+        fprintf(stderr, "%s\n", "search_init() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+
+    s->generation = 0;
+    s->slide = 1;
+    s->text = NULL;
+    s->chars = s->max_chars = 0;
+    s->keys = NULL;
+    s->max_keys = 0;
+    s->result = NULL;
+    s->max_result = 0;
+    s->indexed = s->reused = s->compacted = 0;
+
+    return s;
+}
+
+void search_begin(search_t *s) {
+    int id, live = 0;
+
+    // compact once most docs belong to older versions of the deck
+    for(id = 0; id < s->ndocs; id++) {
+        if(doc_live(s, id))
+            live++;
+    }
+    if(s->ndocs - live > live)
+        search_compact(s);
+
+    s->generation++;
+    s->slide = 1;
+    s->chars = 0;
+}
+
+wchar_t search_fold(wchar_t c) {
+    if(c < 0x80)
+        return c >= L'A' && c <= L'Z' ? c + (L'a' - L'A') : c;
+    return towlower(c);
+}
+
+void search_line(search_t *s, const wchar_t *text, size_t n) {
+    size_t i;
+
+    if(s->chars + n + 1 > s->max_chars) {
+        s->max_chars = (s->chars + n + 1) * 2;
+        s->text = search_realloc(s->text, s->max_chars * sizeof(wchar_t));
+    }
+
+    for(i = 0; i < n; i++)
+        s->text[s->chars++] = search_fold(text[i]);
+    s->text[s->chars++] = L'\n';
+}
+
+void search_slide(search_t *s) {
+    uint64_t hash = 14695981039346656037ULL;
+    search_doc_t *doc;
+    size_t i, n;
+    int id;
+
+    for(i = 0; i < s->chars; i++) {
+        hash ^= (uint64_t) s->text[i];
+        hash *= 1099511628211ULL;
+    }
+
+    // only a slide with new content has its trigrams extracted
+    if((id = doc_find(s, hash)) < 0) {
+        id = doc_add(s, hash);
+        n = gram_keys(s, s->text, s->chars);
+        for(i = 0; i < n; i++)
+            posting_add(s, s->keys[i], id);
+        s->indexed++;
+    } else {
+        s->reused++;
+    }
+
+    doc = &s->docs[id];
+    if(doc->generation != s->generation) {
+        doc->generation = s->generation;
+        doc->size = 0;
+    }
+    if(doc->size == doc->alloc) {
+        doc->alloc = doc->alloc ? doc->alloc * 2 : 1;
+        doc->slides = search_realloc(doc->slides, doc->alloc * sizeof(int));
+    }
+    doc->slides[doc->size++] = s->slide;
+
+    s->slide++;
+    s->chars = 0;
+}
+
+int search_candidates(search_t *s, const wchar_t *query, int **slides) {
+    search_posting_t **lists;
+    search_posting_t *shortest = NULL;
+    size_t n, i, k;
+    int j, id, found = 0;
+
+    for(n = 0; query[n]; n++);
+    if(n < SEARCH_GRAM)
+        return -1;
+
+    // fold the query behind the text of a slide being indexed
+    if(s->chars + n > s->max_chars) {
+        s->max_chars = s->chars + n;
+        s->text = search_realloc(s->text, s->max_chars * sizeof(wchar_t));
+    }
+    for(i = 0; i < n; i++)
+        s->text[s->chars + i] = search_fold(query[i]);
+    n = gram_keys(s, &s->text[s->chars], n);
+
+    if((lists = malloc(n * sizeof(search_posting_t *))) == NULL) {
+        fprintf(stderr, "%s\n", "search_candidates() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+
+    for(i = 0; i < n; i++) {
+        if((lists[i] = posting_find(s, s->keys[i])) == NULL) {
+            free(lists);
+            *slides = s->result;
+            return 0;
+        }
+        if(!shortest || lists[i]->size < shortest->size)
+            shortest = lists[i];
+    }
+
+    // docs of the shortest list having all other trigrams as well
+    for(j = 0; j < shortest->size; j++) {
+        id = shortest->docs[j];
+        if(!doc_live(s, id))
+            continue;
+        for(i = 0; i < n; i++) {
+            if(lists[i] != shortest &&
+               !bsearch(&id, lists[i]->docs, lists[i]->size, sizeof(int), cmp_int))
+                break;
+        }
+        if(i < n)
+            continue;
+
+        for(k = 0; k < (size_t) s->docs[id].size; k++) {
+            if(found == s->max_result) {
+                s->max_result = s->max_result ? s->max_result * 2 : 64;
+                s->result = search_realloc(s->result, s->max_result * sizeof(int));
+            }
+            s->result[found++] = s->docs[id].slides[k];
+        }
+    }
+    free(lists);
+
+    // docs are in order of content, not of slide numbers
+    qsort(s->result, found, sizeof(int), cmp_int);
+
+    *slides = s->result;
+    return found;
+}
+
+const wchar_t *search_match(const wchar_t *text, const wchar_t *query) {
+    size_t i;
+
+    if(!*query)
+        return NULL;
+
+    for(; *text; text++) {
+        for(i = 0; query[i] && search_fold(text[i]) == query[i]; i++);
+        if(!query[i])
+            return text;
+    }
+    return NULL;
+}
+
+int search_fuzzy(const wchar_t *text, const wchar_t *query) {
+    const wchar_t *t = text, *next = text;
+    int score = 0, run = 0;
+
+    for(; *query; query++) {
+        for(t = next; *t && search_fold(*t) != *query; t++);
+        if(!*t)
+            return -1;
+
+        // runs of chars and chars starting a word count more
+        run = t == next ? run + 1 : 1;
+        score += run;
+        if(t == text || !iswalnum(t[-1]))
+            score += 2;
+        next = t + 1;
+    }
+    return score;
+}
+
+void search_stats(search_t *s) {
+    size_t bytes = 0, i;
+    int id;
+
+    for(i = 0; i <= s->posting_mask; i++)
+        bytes += s->postings[i].alloc * sizeof(int);
+    for(id = 0; id < s->ndocs; id++)
+        bytes += s->docs[id].alloc * sizeof(int);
+    bytes += (s->posting_mask + 1) * sizeof(search_posting_t) +
+             (s->doc_mask + 1) * sizeof(int) +
+             s->max_docs * sizeof(search_doc_t);
+
+    fwprintf(stderr, L"search slides indexed: %lu\n", s->indexed);
+    fwprintf(stderr, L"search slides reused: %lu\n", s->reused);
+    fwprintf(stderr, L"search trigrams: %zu (docs: %d, compacted: %lu)\n",
+             s->postings_used, s->ndocs, s->compacted);
+    fwprintf(stderr, L"search index bytes: %zu\n", bytes);
+}
+
+void search_delete(search_t *s) {
+    size_t i;
+    int id;
+
+    for(i = 0; i <= s->posting_mask; i++)
+        free(s->postings[i].docs);
+    for(id = 0; id < s->ndocs; id++)
+        free(s->docs[id].slides);
+    free(s->postings);
+    free(s->docs);
+    free(s->doc_table);
+    free(s->text);
+    free(s->keys);
+    free(s->result);
+    free(s);
+}
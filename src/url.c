@@ -29,12 +29,16 @@
 static void url_del_elem(url_t *elem);
 static void url_print(url_t *u);
 
-static url_t *list;
-static int index_max;
-static int init_ok;
+// one list per thread, so slides can be rendered in parallel
+static __thread url_t *list;
+static __thread url_t *tail;      // last element, for appending
+static __thread url_t *cursor;    // last element looked up, and its index
+static __thread int cursor_index;
+static __thread int index_max;
+static __thread int init_ok;
 
 void url_init(void) {
-    list = NULL;
+    list = tail = cursor = NULL;
     index_max = 0;
     init_ok = 1;
 }
@@ -43,22 +47,20 @@ int url_add(const wchar_t *link_name, int link_name_length, const wchar_t *targe
     if (!init_ok) return -1;
 
     url_t *tmp = NULL;
-    int i = 0;
+
+    if (link_name_length < 0) link_name_length = 0;
+    if (target_length < 0) target_length = 0;
 
     if (list) {
-        tmp = list;
-        while (tmp->next) {
-            tmp = tmp->next;
-            i++;
-        }
-        tmp->next = malloc(sizeof(url_t));
-        assert(tmp->next);
-        tmp = tmp->next;
+        tail->next = malloc(sizeof(url_t));
+        assert(tail->next);
+        tmp = tail->next;
     } else {
         list = malloc(sizeof(url_t));
         tmp = list;
         assert(tmp);
     }
+    tail = tmp;
 
     tmp -> link_name = calloc(link_name_length+1, sizeof(wchar_t));
     assert(tmp->link_name);
@@ -79,62 +81,73 @@ int url_add(const wchar_t *link_name, int link_name_length, const wchar_t *targe
     return index_max-1;
 }
 
-wchar_t * url_get_target(int index) {
-    if (!init_ok) return NULL;
-
+// walk to the element of the given index, starting at the last element
+// looked up if possible, so listing all urls stays linear
+static url_t *url_get(int index) {
     url_t *tmp = list;
+    int i = 0;
+
+    if (index < 0) return NULL;
 
-    if (!tmp) return NULL;
+    if (cursor && cursor_index <= index) {
+        tmp = cursor;
+        i = cursor_index;
+    }
 
-    while (index > 0 && tmp && tmp->next) {
+    while (tmp && i < index) {
         tmp = tmp->next;
-        index--;
+        i++;
+    }
+
+    if (tmp) {
+        cursor = tmp;
+        cursor_index = i;
     }
 
-    if (!index) {
-        return tmp->target;
-    } else return NULL;
+    return tmp;
 }
 
-wchar_t * url_get_name(int index) {
-    url_t *tmp = list;
+wchar_t * url_get_target(int index) {
+    if (!init_ok) return NULL;
 
-    while (index > 0 && tmp && tmp->next) {
-        tmp = tmp->next;
-        index --;
-    }
+    url_t *tmp = url_get(index);
 
-    if (!index) {
-        return tmp->link_name;
-    } else return NULL;
+    return tmp ? tmp->target : NULL;
+}
+
+wchar_t * url_get_name(int index) {
+    url_t *tmp = url_get(index);
+
+    return tmp ? tmp->link_name : NULL;
 }
 
 void url_purge() {
     url_del_elem(list);
-    list = NULL;
+    list = tail = cursor = NULL;
     index_max = 0;
     init_ok = 0;
 }
 
 static void url_del_elem(url_t *elem) {
-    if (!elem) return;
+    url_t *next;
 
-    if (elem->next) {
-        url_del_elem(elem->next);
-        elem->next = NULL;
-    }
+    // iterate, recursion would exhaust the stack on many urls
+    while (elem) {
+        next = elem->next;
 
-    if (elem->target) {
-        free(elem->target);
-        elem->target = NULL;
-    }
+        if (elem->target) {
+            free(elem->target);
+            elem->target = NULL;
+        }
 
-    if (elem->link_name) {
-        free(elem->link_name);
-        elem->link_name = NULL;
-    }
+        if (elem->link_name) {
+            free(elem->link_name);
+            elem->link_name = NULL;
+        }
 
-    free(elem);
+        free(elem);
+        elem = next;
+    }
 }
 
 void url_dump(void) {
@@ -158,20 +171,33 @@ int url_get_amount(void) {
     return index_max;
 }
 
+const wchar_t *url_find_char(const wchar_t *i, wchar_t c, const wchar_t **cache) {
+    // the cached result is still the next occurrence as long as it is
+    // not behind i, the end of the string is cached if c was not found
+    if (!*cache || *cache < i) {
+        *cache = wcschr(i, c);
+        if (!*cache)
+            *cache = i + wcslen(i);
+    }
+
+    return **cache ? *cache : NULL;
+}
+
 int url_count_inline(const wchar_t *line) {
     int count = 0;
     const wchar_t *i = line;
+    const wchar_t *bracket = NULL, *paren = NULL, *end;
 
     for (; *i; i++) {
         if (*i == '\\') {
-            i++;
+            if (!*++i) break;
         } else if ( *i == '[' && *(i+1) && *(i+1) != ']') {
-            while (*i && *i != ']') i++;
-            i++;
-            if (*i == '(' && wcschr(i, ')')) {
+            if (!(end = url_find_char(i, ']', &bracket))) break;
+            i = end + 1;
+            if (*i == '(' && (end = url_find_char(i, ')', &paren))) {
                 count ++;
-                i = wcschr(i, ')');
-            }
+                i = end;
+            } else if (!*i) break;
         }
     }
 
@@ -181,19 +207,18 @@ int url_count_inline(const wchar_t *line) {
 int url_len_inline(const wchar_t *value) {
     int count = 0;
     const wchar_t *i = value;
+    const wchar_t *bracket = NULL, *paren = NULL, *end;
 
     for (; *i; i++) {
         if (*i == '\\') {
-            i++;
+            if (!*++i) break;
         } else if ( *i == '[' && *(i+1) && *(i+1) != ']') {
-            while (*i && *i != ']') i++;
-            i++;
-            if (*i == '(' && wcschr(i, ')')) {
-                while (*i && *i != ')') {
-                    count++;
-                    i++;
-                }
-            }
+            if (!(end = url_find_char(i, ']', &bracket))) break;
+            i = end + 1;
+            if (*i == '(' && (end = url_find_char(i, ')', &paren))) {
+                count += end - i;
+                i = end;
+            } else if (!*i) break;
         }
     }
 
@@ -0,0 +1,227 @@
+/*
+ * Conversion between UTF-8 and wide chars, independent of the locale.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdint.h> // uint64_t
+#include <string.h> // memcpy
+#include <wchar.h>
+#include <wctype.h> // iswprint, iswspace
+
+#if defined( __SSE2__ )
+#include <emmintrin.h>
+#endif
+
+#include "common.h"
+#include "utf8.h"
+
+// printable ASCII or space, the same in every locale
+#define ASCII_KEEP(c) (((c) >= 0x20 && (c) < 0x7f) || ((c) >= '\t' && (c) <= '\r'))
+
+#if defined( __SSE2__ ) && WCHAR_MAX > 0xffff
+
+#define ASCII_BLOCK 16
+
+// decode 16 bytes if all of them are ASCII
+static inline bool ascii_block(const unsigned char *in, wchar_t *out, int flags) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i b = _mm_loadu_si128((const __m128i *) in);
+    __m128i ctrl, space, lo, hi;
+
+    if(_mm_movemask_epi8(b))
+        return false;
+
+    // all bytes are < 0x80 now, so signed compares are fine
+    if(flags & UTF8_PRINTABLE) {
+        ctrl = _mm_cmplt_epi8(b, _mm_set1_epi8(0x20));
+        space = _mm_and_si128(_mm_cmpgt_epi8(b, _mm_set1_epi8('\t' - 1)),
+                              _mm_cmplt_epi8(b, _mm_set1_epi8('\r' + 1)));
+        ctrl = _mm_or_si128(_mm_andnot_si128(space, ctrl),
+                            _mm_cmpeq_epi8(b, _mm_set1_epi8(0x7f)));
+        b = _mm_andnot_si128(ctrl, b);
+    }
+
+    // widen to 32 bit chars
+    lo = _mm_unpacklo_epi8(b, zero);
+    hi = _mm_unpackhi_epi8(b, zero);
+    _mm_storeu_si128((__m128i *) &out[0], _mm_unpacklo_epi16(lo, zero));
+    _mm_storeu_si128((__m128i *) &out[4], _mm_unpackhi_epi16(lo, zero));
+    _mm_storeu_si128((__m128i *) &out[8], _mm_unpacklo_epi16(hi, zero));
+    _mm_storeu_si128((__m128i *) &out[12], _mm_unpackhi_epi16(hi, zero));
+
+    return true;
+}
+
+#else // defined( __SSE2__ ) && WCHAR_MAX > 0xffff
+
+#define ASCII_BLOCK 8
+
+// decode 8 bytes if all of them are ASCII
+static inline bool ascii_block(const unsigned char *in, wchar_t *out, int flags) {
+    uint64_t w;
+    int i;
+
+    memcpy(&w, in, sizeof(w));
+    if(w & 0x8080808080808080ULL)
+        return false;
+
+    for(i = 0; i < ASCII_BLOCK; i++)
+        out[i] = (flags & UTF8_PRINTABLE) && !ASCII_KEEP(in[i]) ? L'\0' : in[i];
+
+    return true;
+}
+
+#endif // defined( __SSE2__ ) && WCHAR_MAX > 0xffff
+
+// length of the sequence started by a lead byte, 0 if it is no lead byte,
+// lo and hi limit the second byte to reject overlong forms, surrogates
+// and chars beyond U+10FFFF
+static int utf8_lead(unsigned char b, unsigned char *lo, unsigned char *hi) {
+    *lo = 0x80;
+    *hi = 0xbf;
+
+    if(b < 0xc2)
+        return 0;
+    if(b < 0xe0)
+        return 2;
+    if(b < 0xf0) {
+        if(b == 0xe0)
+            *lo = 0xa0;
+        else if(b == 0xed)
+            *hi = 0x9f;
+        return 3;
+    }
+    if(b < 0xf5) {
+        if(b == 0xf0)
+            *lo = 0x90;
+        else if(b == 0xf4)
+            *hi = 0x8f;
+        return 4;
+    }
+    return 0;
+}
+
+// bytes of the valid prefix of the sequence at in, the whole sequence
+// is valid if this equals len
+static size_t utf8_prefix(const unsigned char *in, size_t n, int len,
+                          unsigned char lo, unsigned char hi) {
+    size_t i;
+
+    if(n < 2 || in[1] < lo || in[1] > hi)
+        return 1;
+
+    for(i = 2; i < len && i < n && (in[i] & 0xc0) == 0x80; i++);
+
+    return i;
+}
+
+size_t utf8_decode(const char *s, size_t n, wchar_t *out, int flags, size_t *done) {
+    const unsigned char *in = (const unsigned char *) s;
+    const unsigned char *end = in + n;
+    wchar_t *start = out;
+    unsigned char lo, hi;
+    wchar_t c;
+    int len, i;
+
+    while(in < end) {
+
+        if(*in < 0x80) {
+
+            // skip through runs of ASCII a block at a time
+            while(end - in >= ASCII_BLOCK && ascii_block(in, out, flags)) {
+                in += ASCII_BLOCK;
+                out += ASCII_BLOCK;
+            }
+
+            // the rest of the run, up to the next multi-byte char
+            for(; in < end && *in < 0x80; in++)
+                *out++ = (flags & UTF8_PRINTABLE) && !ASCII_KEEP(*in) ? L'\0' : *in;
+
+            continue;
+        }
+
+        len = utf8_lead(*in, &lo, &hi);
+        if(!len || utf8_prefix(in, end - in, len, lo, hi) != len)
+            break;
+
+        c = *in & (0x7f >> len);
+        for(i = 1; i < len; i++)
+            c = (c << 6) | (in[i] & 0x3f);
+        in += len;
+
+        *out++ = (flags & UTF8_PRINTABLE) && !iswprint(c) && !iswspace(c) ? L'\0' : c;
+    }
+
+    *done = in - (const unsigned char *) s;
+    return out - start;
+}
+
+size_t utf8_invalid(const char *s, size_t n) {
+    const unsigned char *in = (const unsigned char *) s;
+    unsigned char lo, hi;
+    int len;
+
+    if(n == 0)
+        return 0;
+
+    // a stray continuation byte or an invalid lead byte
+    if(!(len = utf8_lead(*in, &lo, &hi)))
+        return 1;
+
+    return utf8_prefix(in, n, len, lo, hi);
+}
+
+size_t utf8_length(const wchar_t *in, size_t n) {
+    size_t bytes = n;
+    size_t i;
+
+    for(i = 0; i < n; i++) {
+        if(in[i] >= 0x80)
+            bytes += in[i] < 0x800 ? 1 : in[i] < 0x10000 ? 2 : 3;
+    }
+
+    return bytes;
+}
+
+char *utf8_encode(char *out, const wchar_t *in, size_t n) {
+    const wchar_t *end = in + n;
+    wchar_t c;
+
+    while(in < end) {
+        c = *in++;
+
+        if(c < 0x80) {
+            *out++ = c;
+        } else if(c < 0x800) {
+            *out++ = 0xc0 | (c >> 6);
+            *out++ = 0x80 | (c & 0x3f);
+        } else if(c < 0x10000) {
+            *out++ = 0xe0 | (c >> 12);
+            *out++ = 0x80 | ((c >> 6) & 0x3f);
+            *out++ = 0x80 | (c & 0x3f);
+        } else {
+            *out++ = 0xf0 | (c >> 18);
+            *out++ = 0x80 | ((c >> 12) & 0x3f);
+            *out++ = 0x80 | ((c >> 6) & 0x3f);
+            *out++ = 0x80 | (c & 0x3f);
+        }
+    }
+
+    return out;
+}
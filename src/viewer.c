@@ -20,361 +20,1931 @@
  *
  */
 
+#define _GNU_SOURCE // wcwidth
+
 #include <ctype.h>  // isalnum
-#include <wchar.h>  // wcschr
-#include <wctype.h> // iswalnum
+#include <limits.h> // INT_MAX
+#include <wchar.h>  // wcschr, wcwidth
+#include <wctype.h> // iswalnum, iswspace
 #include <string.h> // strcpy
 #include <unistd.h> // usleep
 #include <stdlib.h> // getenv
+#if defined( HAVE_PTHREAD )
+#include <pthread.h>
+#endif
 #include "viewer.h"
 #include "config.h"
 
-int ncurses_display(deck_t *deck, int reload, int noreload, int slidenum) {
+// buffer of pack_line, one per thread laying out slides
+static __thread cstring_t *line_text = NULL;
+
+// a read-only view of line ln of a slide for the text offset helpers,
+// decoded into a buffer which is reused by the next call
+static cstring_t *pack_line(const slide_t *slide, int ln, cstring_t *view) {
+    if(!line_text)
+        line_text = cstring_init();
+
+    view->value = pack_decode(slide->pack, slide->first + ln, line_text) ? line_text->value : NULL;
+    view->size = view->value ? line_text->size : 0;
+    return view;
+}
+
+// folded query whose matches are highlighted, NULL for none
+static const wchar_t *highlight = NULL;
+
+// slides rendered into cell buffers, NULL if not cached
+static frames_t *frames = NULL;
+static render_t *offscreen = NULL; // backend rendering them
+
+// actions of the keys, the bindings of config.h unless set
+static keymap_t *keymap = NULL;
+
+// loop waiting for keys, set while a deck is displayed
+static event_t *events = NULL;
+static bool own_events = false;    // created for ncurses_display only
+
+// commands applied in place of keys, NULL for none
+static remote_t *remote = NULL;
+
+// viewer whose slides are shown, NULL for none
+static follow_t *follow = NULL;
+
+// files of the deck reloaded when they change, NULL for none
+static watch_t *watch = NULL;
+
+// second terminal showing the presenter view, NULL for none
+static render_t *presenter = NULL;
+static int presenter_colors = 0;
+static bool presenter_open = false; // opened for ncurses_display
+
+// chars of the line being drawn which are part of a match
+static const wchar_t *mark_line = NULL;
+static size_t mark_size = 0;
+static bool *mark = NULL;
+static size_t max_mark = 0;
+
+// find the matches of the highlighted query in a line about to be drawn
+static void mark_matches(const cstring_t *text) {
+    const wchar_t *m;
+    size_t i, n;
+
+    mark_line = NULL;
+    if(!highlight || !text->value || !(m = search_match(text->value, highlight)))
+        return;
+
+    if(text->size > max_mark) {
+        max_mark = text->size * 2;
+        if((mark = realloc(mark, max_mark * sizeof(bool))) == NULL) {
+            fprintf(stderr, "%s\n", "mark_matches() failed to allocate memory.");
+            exit(EXIT_FAILURE);
+        }
+    }
+    memset(mark, 0, text->size * sizeof(bool));
+
+    for(n = wcslen(highlight); m; m = search_match(m + n, highlight))
+        for(i = 0; i < n; i++)
+            mark[m - text->value + i] = true;
+
+    mark_line = text->value;
+    mark_size = text->size;
+}
+
+// print n chars (n < 0 prints all), those of a match are shown reversed
+static void add_text(render_t *render, const wchar_t *s, int n) {
+    size_t pos, end;
+
+    if(!mark_line || s < mark_line || s >= mark_line + mark_size) {
+        (render->addnwstr)(render, s, n);
+        return;
+    }
+
+    pos = s - mark_line;
+    end = n < 0 ? mark_size : MIN(mark_size, pos + n);
+    while(pos < end) {
+        for(n = 1; pos + n < end && mark[pos + n] == mark[pos]; n++);
+        if(mark[pos])
+            (render->attron)(render, GA_REVERSE);
+        (render->addnwstr)(render, &mark_line[pos], n);
+        if(mark[pos])
+            (render->attroff)(render, GA_REVERSE);
+        pos += n;
+    }
+}
+
+// walk from slide number *sc to slide number n
+static slide_t *slide_walk(slide_t *slide, int *sc, int n) {
+    while(*sc < n && slide->next) {
+        slide = slide->next;
+        (*sc)++;
+    }
+    while(*sc > n && slide->prev) {
+        slide = slide->prev;
+        (*sc)--;
+    }
+    return slide;
+}
+
+// stops of a slide, as passed when it is fully revealed
+static int slide_stops(const slide_t *slide) {
+    int ln, stops = 0;
+
+    for(ln = 0; ln < slide->lines; ln++)
+        if(CHECK_BIT(slide->pack->bits[slide->first + ln], IS_STOP))
+            stops++;
+
+    return stops;
+}
+
+// stops to pass until the first line matching query is shown, -1 if the
+// slide does not match
+static int slide_match(deck_t *deck, slide_t *slide, const wchar_t *query) {
+    cstring_t view;
+    int ln, stops = 0;
+
+    if(deck->index)
+        markdown_parse(deck, slide);
+
+    for(ln = 0; ln < slide->lines; ln++) {
+        if(pack_line(slide, ln, &view)->value && search_match(view.value, query))
+            return stops;
+        if(CHECK_BIT(slide->pack->bits[slide->first + ln], IS_STOP))
+            stops++;
+    }
+    return -1;
+}
+
+// number of the slide matching query which follows slide number from in
+// direction dir (or is from itself, if inclusive), wrapping around at the
+// end of the deck, 0 if no slide matches; the index narrows down the
+// slides which need to be compared
+static int search_deck(deck_t *deck, slide_t *slide, int sc, const wchar_t *query,
+                       int from, int dir, bool inclusive, int *stops) {
+    int *candidates = NULL;
+    int total, p, t, n;
+
+    if(!*query)
+        return 0;
+
+    // all slides have to be known to the index
+    markdown_scan(deck, INT_MAX);
+
+    total = deck->search ? search_candidates(deck->search, query, &candidates) : -1;
+    if(total < 0) {
+        // too short for the index, any slide is a candidate
+        candidates = NULL;
+        total = deck->slides;
+    }
+    if(total == 0)
+        return 0;
+
+    // the first candidate to compare
+    if(!candidates) {
+        p = from - 1 + (inclusive ? 0 : dir);
+    } else if(dir > 0) {
+        for(p = 0; p < total && (candidates[p] < from || (!inclusive && candidates[p] == from)); p++);
+    } else {
+        for(p = total - 1; p >= 0 && (candidates[p] > from || (!inclusive && candidates[p] == from)); p--);
+    }
+
+    for(t = 0; t < total; t++, p += dir) {
+        p = (p + total) % total;
+        n = candidates ? candidates[p] : p + 1;
+        slide = slide_walk(slide, &sc, n);
+        if((*stops = slide_match(deck, slide, query)) >= 0)
+            return n;
+    }
+    return 0;
+}
+
+// draw the search prompt over the footer
+static void search_prompt(render_t *render, const wchar_t *query, bool found, int colors) {
+    int i;
+
+    (render->viewport)(render, 0, render->lines);
+    (render->move)(render, render->lines - 1, 0);
+    if(colors)
+        (render->attron)(render, CP_TITLE);
+    (render->addstr)(render, "/");
+    (render->addnwstr)(render, query, -1);
+    if(*query && !found)
+        (render->addstr)(render, " (not found)");
+    for(i = (render->getx)(render); i < render->cols - 1; i++)
+        (render->addstr)(render, " ");
+}
+
+// warn over the footer that the slide shown does not fit the terminal
+static void clip_prompt(render_t *render, int colors) {
+    int i;
+
+    (render->viewport)(render, 0, render->lines);
+    (render->move)(render, render->lines - 1, 0);
+    if(colors)
+        (render->attron)(render, CP_TITLE);
+    (render->addstr)(render, "Terminal too small, slide clipped");
+    for(i = (render->getx)(render); i < render->cols - 1; i++)
+        (render->addstr)(render, " ");
+}
+
+typedef struct _toc_match_t {
+    int heading;
+    int score;
+} toc_match_t;
+
+// higher score first, otherwise in order of the deck
+static int cmp_toc_match(const void *a, const void *b) {
+    const toc_match_t *x = a, *y = b;
+    return x->score != y->score ? y->score - x->score : x->heading - y->heading;
+}
+
+// print as much of s as fits into the given columns, padded with blanks
+static void add_fit(render_t *render, const wchar_t *s, int cols) {
+    int x, width;
+
+    for(x = 0; *s; s++, x += width) {
+        width = MAX(wcwidth(*s), 0);
+        if(x + width > cols)
+            break;
+        (render->addnwstr)(render, s, 1);
+    }
+    for(; x < cols; x++)
+        (render->addstr)(render, " ");
+}
+
+// draw a headline of the table of contents into row y
+static void toc_line(render_t *render, int y, const heading_t *h, bool selected) {
+    char number[32];
+    int indent = h->level > 1 ? 4 : 2;
+
+    snprintf(number, sizeof(number), "%d", h->slide);
+
+    if(selected)
+        (render->attron)(render, GA_REVERSE);
+    (render->move)(render, y, 0);
+    (render->addstr)(render, h->level > 1 ? "    " : "  ");
+
+    // as much of the headline as fits in front of the slide number
+    add_fit(render, h->text, render->cols - indent - strlen(number) - 2);
+    (render->addstr)(render, number);
+    (render->addstr)(render, "  ");
+    if(selected)
+        (render->attroff)(render, GA_REVERSE);
+}
+
+// show the table of contents over the slide, filtered by a fuzzy query
+// as it is typed, returns the slide number of the headline picked or 0
+static int toc_overlay(render_t *render, deck_t *deck, int sc, int colors) {
+    wchar_t query[SEARCH_QUERY + 1] = L"";  // query as typed
+    wchar_t folded[SEARCH_QUERY + 1] = L""; // query to match
+    toc_match_t *match;
+    mbstate_t state = { 0 };
+    int qlen = 0, matches = 0, sel = 0, top = 0, rows, c, i, score;
+    bool filter = true;
+    wchar_t wc;
+    char byte;
+    size_t len;
+
+    // the headlines of a lazily loaded deck are known once it is scanned
+    markdown_scan(deck, INT_MAX);
+
+    if((match = malloc(MAX(deck->headings, 1) * sizeof(toc_match_t))) == NULL) {
+        fprintf(stderr, "%s\n", "toc_overlay() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+
+    for(;;) {
+        if(filter) {
+            for(i = 0; i <= qlen; i++)
+                folded[i] = search_fold(query[i]);
+
+            matches = 0;
+            for(i = 0; i < deck->headings; i++) {
+                score = qlen ? search_fuzzy(deck->toc[i].text, folded) : 0;
+                if(score >= 0) {
+                    match[matches].heading = i;
+                    match[matches++].score = score;
+                }
+            }
+
+            if(qlen > 0) {
+                qsort(match, matches, sizeof(toc_match_t), cmp_toc_match);
+                sel = 0;
+            } else {
+                // start at the headline of the current slide
+                for(sel = 0; sel + 1 < matches && deck->toc[sel + 1].slide <= sc; sel++);
+            }
+            filter = false;
+        }
+
+        // keep the selected headline in view
+        rows = render->lines - 2;
+        if(sel < top)
+            top = sel;
+        if(sel >= top + rows)
+            top = sel - rows + 1;
+
+        (render->erase)(render);
+        (render->viewport)(render, 0, render->lines);
+        if(colors)
+            (render->attron)(render, CP_TITLE);
+        (render->move)(render, 0, 0);
+        (render->addstr)(render, "> ");
+        (render->addnwstr)(render, query, -1);
+        if(colors)
+            (render->attron)(render, CP_FG);
+        for(i = top; i < matches && i < top + rows; i++)
+            toc_line(render, i - top + 2, &deck->toc[match[i].heading], i == sel);
+        (render->flush)(render);
+
+        c = event_key(events, render, -1);
+        if(c == ERR || c == 27 || c == EVENT_WAKE) {
+            // ESC closes the table of contents, as does a remote command
+            free(match);
+            return 0;
+        } else if(c == '\n' || c == KEY_ENTER) {
+            i = matches > 0 ? deck->toc[match[sel].heading].slide : 0;
+            free(match);
+            return i;
+        } else if(c == KEY_UP || c == 16) { // CTRL-P
+            sel = MAX(sel - 1, 0);
+        } else if(c == KEY_DOWN || c == 14) { // CTRL-N
+            sel = MAX(MIN(sel + 1, matches - 1), 0);
+        } else if(c == KEY_PPAGE) {
+            sel = MAX(sel - rows, 0);
+        } else if(c == KEY_NPAGE) {
+            sel = MAX(MIN(sel + rows, matches - 1), 0);
+        } else if(c == KEY_BACKSPACE || c == 8 || c == 127) {
+            if(qlen > 0) {
+                query[--qlen] = L'\0';
+                filter = true;
+            }
+        } else if(c >= 0 && c <= 0xff) {
+            // keys arrive byte by byte
+            byte = c;
+            len = mbrtowc(&wc, &byte, 1, &state);
+            if(len == (size_t) -1) {
+                memset(&state, 0, sizeof(state));
+            } else if(len != (size_t) -2 && iswprint(wc) && qlen < SEARCH_QUERY) {
+                query[qlen++] = wc;
+                query[qlen] = L'\0';
+                filter = true;
+            }
+        }
+    }
+}
+
+// draw the summary of slide n into the cell at y, x
+static void overview_cell(render_t *render, deck_t *deck, int n, int y, int x, int cols,
+                          bool selected, int colors) {
+    static const summary_t none = { NULL, NULL, 0, 0, 0, false };
+    const summary_t *s = n <= deck->summaries ? &deck->summary[n - 1] : &none;
+    const wchar_t *row = s->text;
+    char number[32];
+    int r;
+
+    if(selected)
+        (render->attron)(render, GA_REVERSE);
+
+    // slide number and title
+    snprintf(number, sizeof(number), "%d ", n);
+    (render->move)(render, y, x);
+    if(colors)
+        (render->attron)(render, CP_TITLE);
+    (render->addstr)(render, number);
+    if(colors)
+        (render->attron)(render, CP_HEADER);
+    add_fit(render, s->title ? s->title : L"", cols - strlen(number));
+    if(colors)
+        (render->attron)(render, CP_FG);
+
+    // first rows of text
+    for(r = 0; r < SUMMARY_ROWS; r++) {
+        (render->move)(render, y + 1 + r, x);
+        add_fit(render, r < s->rows ? row : L"", cols);
+        if(r < s->rows)
+            row += wcslen(row) + 1;
+    }
+
+    if(selected)
+        (render->attroff)(render, GA_REVERSE);
+}
+
+// show a grid of slide summaries, returns the number of the slide picked
+// or 0; only the summaries made while loading are drawn, no slide is
+// parsed or laid out
+static int overview(render_t *render, deck_t *deck, int sc, int colors) {
+    int sel = sc, first, page, across, down, cw, ch, n, c;
+    char status[64];
+
+    for(;;) {
+        // as many cells as fit, each at least OVERVIEW_WIDTH wide
+        across = MAX(render->cols / OVERVIEW_WIDTH, 1);
+        cw = render->cols / across;
+        ch = SUMMARY_ROWS + 2;
+        down = MAX((render->lines - 1) / ch, 1);
+        page = across * down;
+        first = (sel - 1) / page * page + 1;
+
+        // the slides of this page have to be known
+        if(first + page - 1 > deck->slides)
+            markdown_scan(deck, first + page - 1 - deck->slides);
+
+        (render->erase)(render);
+        (render->viewport)(render, 0, render->lines);
+        for(n = first; n < first + page && n <= deck->slides; n++)
+            overview_cell(render, deck, n, (n - first) / across * ch,
+                          (n - first) % across * cw + 1, cw - 2, n == sel, colors);
+
+        snprintf(status, sizeof(status), "%d / %d%s", sel, deck->slides,
+                 markdown_scan(deck, 0) ? "+" : "");
+        (render->move)(render, render->lines - 1, render->cols - strlen(status) - 3);
+        if(colors)
+            (render->attron)(render, CP_TITLE);
+        (render->addstr)(render, status);
+        if(colors)
+            (render->attron)(render, CP_FG);
+        (render->flush)(render);
+
+        c = event_key(events, render, -1);
+        if(c == ERR || c == 27 || c == EVENT_WAKE || keymap_action(keymap, c) == ACTION_OVERVIEW ||
+           keymap_action(keymap, c) == ACTION_QUIT) {
+            return 0;
+        } else if(c == '\n' || c == KEY_ENTER) {
+            return sel;
+        } else if(c == KEY_LEFT || c == 'h') {
+            n = sel - 1;
+        } else if(c == KEY_RIGHT || c == 'l') {
+            n = sel + 1;
+        } else if(c == KEY_UP || c == 'k') {
+            n = sel - across;
+        } else if(c == KEY_DOWN || c == 'j') {
+            n = sel + across;
+        } else if(c == KEY_PPAGE) {
+            n = sel - page;
+        } else if(c == KEY_NPAGE || c == ' ') {
+            n = sel + page;
+        } else if(keymap_action(keymap, c) == ACTION_FIRST) {
+            n = 1;
+        } else if(keymap_action(keymap, c) == ACTION_LAST) {
+            markdown_scan(deck, INT_MAX);
+            n = deck->slides;
+        } else {
+            continue;
+        }
+
+        if(n > deck->slides)
+            markdown_scan(deck, n - deck->slides);
+        sel = MAX(MIN(n, deck->slides), 1);
+    }
+}
+
+// draw line ln of a slide from its display list, the line is compiled
+// when it is drawn for the first time at this geometry after the slide
+// has been shown once
+static void display_line(render_t *render, int y, int x, slide_t *slide, int ln, int max_cols, int colors) {
+    display_t *d;
+    render_t *record;
+    int urls;
+
+    // a slide is compiled when shown again, matches of a search are
+    // marked while drawing
+    if(!slide->display || highlight) {
+        add_line(render, y, x, slide, ln, max_cols, colors);
+        return;
+    }
+
+    d = slide->display;
+    display_prepare(d, render->cols, max_cols, colors);
+
+    // lines are drawn in order, each one may add links to the url list
+    if(ln == d->lines) {
+        urls = url_get_amount();
+        record = display_record(d, (x + slide->pack->length[slide->first + ln] + 64) / render->cols + 2,
+                                colors ? CP_FG : 0);
+        add_line(record, 0, x, slide, ln, max_cols, colors);
+        display_commit(d, urls);
+        display_replay(d, render, ln, y, false);
+    } else if(ln < d->lines) {
+        display_replay(d, render, ln, y, true);
+    } else {
+        add_line(render, y, x, slide, ln, max_cols, colors);
+    }
+}
+
+// draw header and footer of slide sc
+static void display_bars(render_t *render, deck_t *deck, int sc, int slidenum, int colors) {
+
+    int offset;       // text offset
+    char number[32];  // formatted slide number
+    line_t *line;
+
+    // header line 1 is displayed at the top
+    int bar_top = (deck->headers > 0) ? 1 : 0;
+
+    // set main window text color
+    if(colors)
+        (render->attron)(render, CP_TITLE);
+
+    // setup header
+    if(bar_top) {
+        line = deck->header;
+        offset = next_blank(line->text, 0) + 1;
+        // add text to header
+        (render->move)(render, 0, (render->cols - line->length + offset) / 2);
+        (render->addnwstr)(render, &line->text->value[offset], -1);
+    }
+
+    // setup footer
+    if(deck->headers > 1) {
+        line = deck->header->next;
+        offset = next_blank(line->text, 0) + 1;
+        switch(slidenum) {
+            case 0: // add text to center footer
+                (render->move)(render, render->lines - 1, (render->cols - line->length + offset) / 2);
+                break;
+            case 1:
+            case 2: // add text to left footer
+                (render->move)(render, render->lines - 1, 3);
+                break;
+        }
+        (render->addnwstr)(render, &line->text->value[offset], -1);
+    }
+
+    // add slide number to right footer
+    switch(slidenum) {
+        case 1: // show slide number only
+            snprintf(number, sizeof(number), "%d", sc);
+            (render->move)(render, render->lines - 1, render->cols - int_length(sc) - 3);
+            (render->addstr)(render, number);
+            break;
+        case 2: // show current slide & number of slides
+            // the total is still growing while a lazily loaded deck is scanned
+            snprintf(number, sizeof(number), "%d / %d%s", sc, deck->slides,
+                     markdown_scan(deck, 0) ? "+" : "");
+            (render->move)(render, render->lines - 1, render->cols - strlen(number) - 3);
+            (render->addstr)(render, number);
+            break;
+    }
+}
+
+// draw the rows of the document from top on, fully revealed
+static void pager_draw(render_t *render, deck_t *deck, pager_t *p, int top, int slidenum, int colors) {
+    int bar_top = (deck->headers > 0) ? 1 : 0;
+    int bar_bottom = (slidenum || deck->headers > 1)? 1 : 0;
+    int height = render->lines - bar_top - bar_bottom;
+    int x, y, n, ln, i;
+    slide_t *slide;
+
+    pager_measure(p, deck, render->cols, top + height);
+
+    url_init();
+    (render->erase)(render);
+
+    n = pager_seek(p, top, &ln);
+    display_bars(render, deck, n + 1, slidenum, colors);
+
+    (render->viewport)(render, bar_top, height);
+    if(colors)
+        (render->attron)(render, CP_FG);
+
+    x = (render->cols - p->max_cols) / 2;
+    for(; n < p->slides && (y = pager_row(p, n, MAX(ln, 0)) - top) < height; n++, ln = 0) {
+        slide = p->slide[n];
+        markdown_parse(deck, slide);
+
+        for(; ln >= 0 && ln < slide->lines && (y = pager_row(p, n, ln) - top) < height; ln++)
+            add_line(render, y, x, slide, ln, p->max_cols, colors);
+
+        // rule between the slides
+        if((y = pager_row(p, n, -1) - top) < height) {
+            if(colors)
+                (render->attron)(render, CP_TITLE);
+            (render->move)(render, y, x);
+            for(i = 0; i < p->max_cols; i++)
+                (render->addstr)(render, "-");
+            if(colors)
+                (render->attron)(render, CP_FG);
+        }
+    }
+
+    url_purge();
+}
+
+// show the deck as one continuous document starting at slide sc, only
+// the rows on screen are drawn; returns the number of the slide at the
+// top when left
+static int pager_view(render_t *render, deck_t *deck, pager_t *p, int sc, int slidenum, int colors) {
+    int bar_top = (deck->headers > 0) ? 1 : 0;
+    int bar_bottom = (slidenum || deck->headers > 1)? 1 : 0;
+    int top, height, rows, n, ln, c;
+
+    // the first row of slide sc
+    pager_measure(p, deck, render->cols, 0);
+    while(p->slides < sc && !p->complete)
+        pager_measure(p, deck, render->cols, p->slide_row[p->slides]);
+    top = p->slide_row[MIN(sc, p->slides) - 1];
+
+    for(;;) {
+        height = render->lines - bar_top - bar_bottom;
+
+        // keep the line at the top if the width changed
+        if(p->cols != render->cols) {
+            n = pager_seek(p, top, &ln);
+            pager_measure(p, deck, render->cols, 0);
+            while(p->slides <= n && !p->complete)
+                pager_measure(p, deck, render->cols, p->slide_row[p->slides]);
+            n = MIN(n, p->slides - 1);
+            top = pager_row(p, n, MIN(ln, p->slide_line[n + 1] - p->slide_line[n] - 1));
+        }
+
+        // do not scroll past the end once it is known
+        rows = pager_measure(p, deck, render->cols, top + height);
+        if(p->complete && top + height > rows) {
+            n = pager_seek(p, MAX(rows - height, 0), &ln);
+            top = MIN(top, pager_row(p, n, ln));
+        }
+
+        pager_draw(render, deck, p, top, slidenum, colors);
+        (render->flush)(render);
+
+        c = event_key(events, render, -1);
+        if(c == ERR || c == 27 || c == EVENT_WAKE || c == '\n' || c == KEY_ENTER ||
+           keymap_action(keymap, c) == ACTION_PAGER || keymap_action(keymap, c) == ACTION_QUIT) {
+            return pager_seek(p, top, &ln) + 1;
+        } else if(c == KEY_DOWN || c == 'j') {
+            pager_measure(p, deck, render->cols, top + 1);
+            n = pager_seek(p, top, &ln);
+            if(ln >= 0 && ln + 1 < p->slide_line[n + 1] - p->slide_line[n])
+                top = pager_row(p, n, ln + 1);
+            else if(ln >= 0)
+                top = pager_row(p, n, -1);
+            else if(n + 1 < p->slides)
+                top = p->slide_row[n + 1];
+        } else if(c == KEY_UP || c == 'k') {
+            n = pager_seek(p, MAX(top - 1, 0), &ln);
+            top = pager_row(p, n, ln);
+        } else if(c == KEY_NPAGE || c == ' ') {
+            // the line at the bottom becomes the top one
+            rows = pager_measure(p, deck, render->cols, top + height);
+            n = pager_seek(p, MIN(top + height - 1, rows - 1), &ln);
+            top = MAX(pager_row(p, n, ln), top);
+        } else if(c == KEY_PPAGE || c == 'b') {
+            n = pager_seek(p, MAX(top - height + 1, 0), &ln);
+            top = pager_row(p, n, ln);
+        } else if(keymap_action(keymap, c) == ACTION_FIRST) {
+            top = 0;
+        } else if(keymap_action(keymap, c) == ACTION_LAST) {
+            rows = pager_measure(p, deck, render->cols, INT_MAX);
+            n = pager_seek(p, MAX(rows - height, 0), &ln);
+            top = pager_row(p, n, ln);
+        }
+    }
+}
+
+void ncurses_frames(frames_t *f) {
+    frames = f;
+}
+
+static void frame_key(frame_key_t *key, render_t *render, deck_t *deck, int sc, int stop, int max_cols) {
+    key->slide = sc;
+    key->stop = stop;
+    key->lines = render->lines;
+    key->cols = render->cols;
+    key->max_cols = max_cols;
+    key->slides = deck->slides;
+    key->more = markdown_scan(deck, 0);
+}
+
+// render a slide at the given stop with the geometry of render into the
+// headless backend, returns the lines hidden
+static int render_offscreen(render_t *render, deck_t *deck, slide_t *slide, int sc, int stop,
+                            int max_cols, int slidenum, int colors, int *passed) {
+    int saved = slide->stop;
+    int hidden;
+
+    if(!offscreen)
+        offscreen = render_headless_init(render->lines, render->cols);
+    offscreen->lines = render->lines;
+    offscreen->cols = render->cols;
+
+    slide->stop = stop;
+    hidden = display_slide(offscreen, deck, slide, sc, max_cols, slidenum, colors, passed);
+    slide->stop = saved;
+
+    return hidden;
+}
+
+// render a slide at the given stop into the frame cache
+static frame_t *render_frame(render_t *render, deck_t *deck, slide_t *slide, int sc, int stop,
+                             int max_cols, int slidenum, int colors, bool ahead) {
+    frame_key_t key;
+    int hidden, passed;
+
+    hidden = render_offscreen(render, deck, slide, sc, stop, max_cols, slidenum, colors, &passed);
+
+    frame_key(&key, render, deck, sc, stop, max_cols);
+    return frames_add(frames, &key, render_headless_grid(offscreen), hidden, passed, ahead);
+}
+
+// draw a slide like display_slide, copied from the frame cache if possible
+static int show_slide(render_t *render, deck_t *deck, slide_t *slide, int sc, int max_cols,
+                      int slidenum, int colors, int *stop) {
+    frame_key_t key;
+    frame_t *frame;
+
+    // matches of a search are marked while drawing
+    if(!frames || highlight)
+        return display_slide(render, deck, slide, sc, max_cols, slidenum, colors, stop);
+
+    frame_key(&key, render, deck, sc, slide->stop, max_cols);
+    if(!(frame = frames_get(frames, &key)))
+        frame = render_frame(render, deck, slide, sc, slide->stop, max_cols, slidenum, colors, false);
+
+    // the terminal has just been resized
+    if(!(render->blit)(render, frame->grid))
+        return display_slide(render, deck, slide, sc, max_cols, slidenum, colors, stop);
+
+    *stop = frame->passed;
+    return frame->hidden;
+}
+
+// the slide shown after the current one, or before it, with the stop
+// shown next as the keys walk them; NULL if there is none
+static slide_t *slide_step(slide_t *slide, int *sc, int stop, int hidden, bool forward, int *next) {
+    if(forward && stop && hidden) {
+        *next = slide->stop + 1;
+    } else if(forward && slide->next) {
+        slide = slide->next;
+        *next = slide->stop;
+        (*sc)++;
+    } else if(!forward && (stop > 1 || (stop == 1 && !hidden))) {
+        *next = slide->stop - 1;
+    } else if(!forward && slide->prev) {
+        slide = slide->prev;
+        *next = 0;
+        (*sc)--;
+    } else {
+        return NULL;
+    }
+
+    return slide;
+}
+
+// lazily loaded deck, the slide is laid out on its own width like the
+// viewer shows it; the slide shown is used before and after it so it is
+// never unloaded, the caller uses it again once done
+static void slide_layout(render_t *render, deck_t *deck, slide_t *shown, slide_t *slide, int *max_cols) {
+    if(!deck->index)
+        return;
+
+    markdown_parse(deck, shown);
+    markdown_parse(deck, slide);
+    *max_cols = 0;
+    layout_slide(slide, render->cols, max_cols);
+}
+
+// render the slide shown after the current one, or before it, into the
+// frame cache, the stops are walked as the keys walk them
+static void render_ahead(render_t *render, deck_t *deck, slide_t *slide, int sc, int stop, int hidden,
+                         int max_cols, int slidenum, int colors, bool forward) {
+    slide_t *shown = slide;
+    frame_key_t key;
+    int next;
+
+    if(!(slide = slide_step(slide, &sc, stop, hidden, forward, &next)))
+        return;
+    slide_layout(render, deck, shown, slide, &max_cols);
+
+    frame_key(&key, render, deck, sc, next, max_cols);
+    if(!frames_find(frames, &key))
+        render_frame(render, deck, slide, sc, next, max_cols, slidenum, colors, true);
+
+    if(deck->index)
+        markdown_parse(deck, shown);
+}
+
+// the cells the audience sees after the current state, taken from the
+// frame cache, so the presenter view lays out and renders nothing of its
+// own; NULL at the end of the deck
+static const grid_t *preview_grid(render_t *render, deck_t *deck, slide_t *slide, int *sc, int stop,
+                                  int hidden, int max_cols, int slidenum, int colors) {
+    slide_t *shown = slide;
+    const grid_t *grid;
+    frame_key_t key;
+    frame_t *frame;
+    int next, passed;
+
+    if(!(slide = slide_step(slide, sc, stop, hidden, true, &next)))
+        return NULL;
+    slide_layout(render, deck, shown, slide, &max_cols);
+
+    // matches of a search are marked while drawing, so none are cached
+    if(frames && !highlight) {
+        frame_key(&key, render, deck, *sc, next, max_cols);
+        if(!(frame = frames_find(frames, &key)))
+            frame = render_frame(render, deck, slide, *sc, next, max_cols, slidenum, colors, true);
+        grid = frame->grid;
+    } else {
+        render_offscreen(render, deck, slide, *sc, next, max_cols, slidenum, colors, &passed);
+        grid = render_headless_grid(offscreen);
+    }
+
+    if(deck->index)
+        markdown_parse(deck, shown);
+
+    return grid;
+}
+
+// a cell showing nothing but the background
+static bool cell_blank(const cell_t *cell) {
+    return cell->c == L' ' &&
+           !(cell->attr & (GA_UNDERLINE | GA_REVERSE)) &&
+           (!GA_PAIR(cell->attr) || GA_PAIR(cell->attr) == CP_FG);
+}
+
+// copy the content of a frame between its bars into rows top..top+height,
+// cropped to the cells which are not blank and centered, a run of cells
+// of the same attribute at a time
+static void preview_draw(render_t *render, const grid_t *g, int bar_top, int bar_bottom,
+                         int top, int height) {
+    wchar_t run[256];
+    const cell_t *cell;
+    int y0 = g->lines, y1 = -1, x0 = g->cols, x1 = -1;
+    int y, x, n, attr, oy, ox;
+
+    for(y = bar_top; y < g->lines - bar_bottom; y++) {
+        for(x = 0; x < g->cols; x++) {
+            if(!cell_blank(&g->cells[y * g->cols + x])) {
+                y0 = MIN(y0, y);
+                y1 = MAX(y1, y);
+                x0 = MIN(x0, x);
+                x1 = MAX(x1, x);
+            }
+        }
+    }
+    if(y1 < 0)
+        return;
+
+    // what does not fit is cut off at the bottom and right
+    y1 = MIN(y1, y0 + height - 1);
+    x1 = MIN(x1, x0 + render->cols - 1);
+    oy = top + (height - (y1 - y0 + 1)) / 2 - y0;
+    ox = (render->cols - (x1 - x0 + 1)) / 2 - x0;
+
+    for(y = y0; y <= y1; y++) {
+        cell = &g->cells[y * g->cols];
+        for(x = x0; x <= x1;) {
+            if(cell_blank(&cell[x])) {
+                x++;
+                continue;
+            }
+
+            attr = cell[x].attr;
+            (render->move)(render, y + oy, x + ox);
+            for(n = 0; x <= x1 && cell[x].attr == attr && n < 255; x++) {
+                // the right half of a double width char is drawn by the
+                // left one, unless the left one is cut off
+                if(cell[x].c)
+                    run[n++] = cell[x].c;
+                else if(x == x0)
+                    run[n++] = L' ';
+            }
+
+            (render->attroff)(render, GA_UNDERLINE | GA_REVERSE);
+            (render->attron)(render, attr);
+            (render->addnwstr)(render, run, n);
+        }
+    }
+    (render->attroff)(render, GA_UNDERLINE | GA_REVERSE);
+}
+
+// draw the notes of a slide from row top on, wrapped at the right edge,
+// empty lines at the start and end are left out
+static void notes_draw(render_t *render, const cstring_t *notes, int top, int colors) {
+    const wchar_t *s, *end;
+    int y = top, x = 1, w;
+
+    if(!notes || !notes->size)
+        return;
+
+    s = notes->value;
+    end = &notes->value[notes->size];
+    while(s < end && iswspace(*s))
+        s++;
+    while(end > s && iswspace(end[-1]))
+        end--;
+
+    if(colors)
+        (render->attron)(render, CP_FG);
+
+    for(; s < end && y < render->lines; s++) {
+        if(*s == L'\n') {
+            y++;
+            x = 1;
+            continue;
+        }
+        if((w = wcwidth(*s)) < 0)
+            continue;
+        if(x + w > render->cols - 1) {
+            if(++y >= render->lines)
+                break;
+            x = 1;
+        }
+        (render->move)(render, y, x);
+        (render->addnwstr)(render, s, 1);
+        x += w;
+    }
+}
+
+// a row of the presenter view in the title color, text at the left and
+// right edge
+static void presenter_bar(render_t *render, int y, const char *left, const char *right, int colors) {
+    int i;
+
+    if(colors)
+        (render->attron)(render, CP_TITLE);
+    (render->attron)(render, GA_REVERSE);
+    (render->move)(render, y, 0);
+    for(i = 0; i < render->cols; i++)
+        (render->addstr)(render, " ");
+    (render->move)(render, y, 1);
+    (render->addstr)(render, left);
+    if((int) strlen(right) + 1 < render->cols - (int) strlen(left) - 2) {
+        (render->move)(render, y, render->cols - strlen(right) - 1);
+        (render->addstr)(render, right);
+    }
+    (render->attroff)(render, GA_REVERSE);
+}
+
+// draw the presenter view: the state shown, the state the next key shows,
+// as the audience will see it, and the notes of the slide shown
+static void presenter_draw(render_t *render, deck_t *deck, slide_t *slide, int sc, int stop,
+                           int hidden, int max_cols, int slidenum, int colors) {
+    int bar_top = (deck->headers > 0) ? 1 : 0;
+    int bar_bottom = (slidenum || deck->headers > 1)? 1 : 0;
+    int stops = slide_stops(slide);
+    int next = sc, height;
+    const grid_t *grid;
+    char left[64], right[64];
+
+    grid = preview_grid(render, deck, slide, &next, stop, hidden, max_cols, slidenum, colors);
+
+    (presenter->erase)(presenter);
+    (presenter->viewport)(presenter, 0, presenter->lines);
+
+    if(stops)
+        snprintf(left, sizeof(left), "slide %d / %d  stop %d / %d", sc, deck->slides,
+                 MIN(slide->stop, stops), stops);
+    else
+        snprintf(left, sizeof(left), "slide %d / %d", sc, deck->slides);
+    if(!grid)
+        snprintf(right, sizeof(right), "%s", next == sc ? "end" : "next: not shown");
+    else if(next == sc)
+        snprintf(right, sizeof(right), "next: stop %d", MIN(slide->stop, stops) + 1);
+    else
+        snprintf(right, sizeof(right), "next: slide %d", next);
+    presenter_bar(presenter, 0, left, right, presenter_colors);
+
+    // the preview takes the rows left by the notes
+    height = slide->notes ? (presenter->lines - 1) * 3 / 5 : presenter->lines - 1;
+    if(grid)
+        preview_draw(presenter, grid, bar_top, bar_bottom, 1, height);
+
+    if(slide->notes && height + 2 < presenter->lines) {
+        presenter_bar(presenter, height + 1, "notes", "", presenter_colors);
+        notes_draw(presenter, slide->notes, height + 2, presenter_colors);
+    }
+
+    (presenter->flush)(presenter);
+}
+
+// state of the slide shown, for the work done while waiting for a key
+typedef struct _idle_work_t {
+    render_t *render;
+    deck_t *deck;
+    slide_t *slide;
+    int sc;
+    int stop;
+    int hidden;
+    int max_cols;
+    int slidenum;
+    int colors;
+    int ahead;                // slides left to render
+    bool prompt;              // search prompt shown
+    const wchar_t *query;
+    bool found;
+    bool clipped;             // slide does not fit the terminal
+} idle_work_t;
+
+// render the slides shown next and scan for further slides, one step at a
+// time so keys are still read in between
+static bool viewer_idle(event_t *ev, void *data) {
+    idle_work_t *w = data;
+
+    if(w->ahead) {
+        render_ahead(w->render, w->deck, w->slide, w->sc, w->stop, w->hidden,
+                     w->max_cols, w->slidenum, w->colors, w->ahead-- == 2);
+        return true;
+    }
+
+    if(!markdown_scan(w->deck, 0))
+        return false;
+
+    // update the number of slides in the footer once all are known
+    if(!markdown_scan(w->deck, SCAN_SLIDES) && w->slidenum == 2) {
+        w->hidden = show_slide(w->render, w->deck, w->slide, w->sc, w->max_cols,
+                               w->slidenum, w->colors, &w->stop);
+        if(w->clipped)
+            clip_prompt(w->render, w->colors);
+        if(w->prompt)
+            search_prompt(w->render, w->query, w->found, w->colors);
+        (w->render->flush)(w->render);
+        w->ahead = frames && !highlight ? 2 : 0;
+    }
+
+    return true;
+}
+
+// the digits of a count after the first one, next is set to the key
+// following them, ERR if none follows in time
+static int read_count(render_t *render, int c, int *next) {
+    int n = c - '0';
+
+    while((c = event_key(events, render, GOTO_SLIDE_DELAY * 100)) >= '0' && c <= '9')
+        if(n < INT_MAX / 10 - 1)
+            n = n * 10 + (c - '0');
+
+    *next = c;
+    return n;
+}
+
+// read a slide number typed after a colon at the bottom, returns it once
+// Enter is pressed, or 0 if it is cancelled
+static int goto_prompt(render_t *render, int colors) {
+    char number[10] = "";
+    int len = 0, c, i;
+
+    for(;;) {
+        (render->viewport)(render, 0, render->lines);
+        (render->move)(render, render->lines - 1, 0);
+        if(colors)
+            (render->attron)(render, CP_TITLE);
+        (render->addstr)(render, ":");
+        (render->addstr)(render, number);
+        for(i = (render->getx)(render); i < render->cols - 1; i++)
+            (render->addstr)(render, " ");
+        (render->flush)(render);
+
+        c = event_key(events, render, -1);
+        if(c == '\n' || c == KEY_ENTER) {
+            return atoi(number);
+        } else if(c == KEY_BACKSPACE || c == 8 || c == 127) {
+            if(!len)
+                return 0;
+            number[--len] = '\0';
+        } else if(c >= '0' && c <= '9') {
+            if(len < (int) sizeof(number) - 1) {
+                number[len++] = c;
+                number[len] = '\0';
+            }
+        } else if(c == ERR || c == 27 || c == EVENT_WAKE) {
+            // ESC cancels, as does a remote command
+            return 0;
+        }
+    }
+}
+
+keymap_t *default_keymap(void) {
+    keymap_t *km = keymap_init();
+
+    keymap_bind(km, prev_slide_binding, ACTION_PREV);
+    keymap_bind(km, next_slide_binding, ACTION_NEXT);
+    keymap_bind(km, first_slide_binding, ACTION_FIRST);
+    keymap_bind(km, last_slide_binding, ACTION_LAST);
+    keymap_bind(km, goto_binding, ACTION_GOTO);
+    keymap_bind(km, reload_binding, ACTION_RELOAD);
+    keymap_bind(km, quit_binding, ACTION_QUIT);
+    keymap_bind(km, search_binding, ACTION_SEARCH);
+    keymap_bind(km, search_next_binding, ACTION_SEARCH_NEXT);
+    keymap_bind(km, search_prev_binding, ACTION_SEARCH_PREV);
+    keymap_bind(km, toc_binding, ACTION_TOC);
+    keymap_bind(km, overview_binding, ACTION_OVERVIEW);
+    keymap_bind(km, pager_binding, ACTION_PAGER);
+
+    return km;
+}
+
+void ncurses_keymap(keymap_t *km) {
+    keymap = km;
+}
+
+void ncurses_events(event_t *ev) {
+    events = ev;
+}
+
+void ncurses_remote(remote_t *r) {
+    remote = r;
+}
+
+void ncurses_follow(follow_t *f) {
+    follow = f;
+}
+
+void ncurses_watch(watch_t *w) {
+    watch = w;
+}
+
+void ncurses_presenter(render_t *p) {
+    presenter = p;
+}
+
+// keys typed on the presenter terminal are taken like keys of the audience
+// terminal, it is no longer read once it is hung up
+static void presenter_read(event_t *ev, int fd, void *data) {
+    int c;
+
+    if((c = (presenter->getkey)(presenter, 0)) == ERR) {
+        event_unwatch(ev, fd);
+        return;
+    }
+    do {
+        event_push(ev, c);
+    } while((c = (presenter->getkey)(presenter, 0)) != ERR);
+}
+
+static void presenter_release(void) {
+    if(presenter_open) {
+        event_unwatch(events, presenter->input);
+        (presenter->close)(presenter);
+        presenter_open = false;
+    }
+}
+
+static void events_release(void) {
+    if(own_events) {
+        event_delete(events);
+        events = NULL;
+        own_events = false;
+    }
+}
+
+int ncurses_display(deck_t *deck, render_t *render, int reload, int noreload, int slidenum) {
+
+    int c = 0;                // char
+    int i = 0;                // iterate
+    int sc = 1;               // slide count
+    int colors = 0;           // amount of colors supported
+    int max_lines = 0;        // max lines per slide
+    int max_lines_slide = -1; // the slide that has the most lines
+    int max_cols = 0;         // max columns per line
+    int stop = 0;             // passed stop bits per slide
+
+    slide_t *slide = deck->slide;
+    int hidden;               // lines hidden behind a stop
+    bool clipped = false;     // slide does not fit the terminal
+
+    wchar_t query[SEARCH_QUERY + 1] = L"";  // search query as typed
+    wchar_t folded[SEARCH_QUERY + 1] = L""; // search query to match
+    int qlen = 0;             // chars of the search query
+    bool prompt = false;      // search query is being typed
+    bool found = true;        // search query matches a slide
+    int origin = 0;           // slide shown when the search started
+    int stops;                // stops to pass until a match is shown
+    int count;                // digits typed before a key
+    action_t action;          // what the key typed does
+    idle_work_t work;         // state for the work done while idle
+    mbstate_t state;          // multi-byte char typed so far
+    wchar_t wc;
+    char byte;
+    size_t len;
+
+    pager_t *pager = NULL;    // rows of the deck as one document
+
+    highlight = NULL;
+
+    if(!keymap)
+        keymap = default_keymap();
+
+    // frames of another deck
+    if(frames)
+        frames_clear(frames);
+
+    // init screen
+    if(!(render->open)(render)) {
+        fwprintf(stderr, L"Error: Unable to initialize the terminal.\n");
+        return 0;
+    }
+
+    if(deck->index) {
+        // lazily loaded deck, the first slide holds the header
+        markdown_parse(deck, deck->slide);
+
+        // make sure the slide to reload is known
+        if(reload > deck->slides)
+            markdown_scan(deck, reload - deck->slides);
+
+    // calculate geometry of all slides
+    } else if(!layout_check(deck, render, slidenum, &max_lines, &max_cols, &max_lines_slide)) {
+        return 0;
+    }
+
+    // set colors
+    colors = setup_colors(render);
+
+    slide = deck->slide;
+
+    // find slide to reload
+    sc = 1;
+    while(reload > 1 && reload <= deck->slides) {
+        slide = slide->next;
+        sc++;
+        reload--;
+    }
+
+    // reset reload indicator
+    reload = 0;
+
+    // a loop of our own if there are no sources to serve
+    if((own_events = !events))
+        events = event_init();
+
+    // the presenter terminal shows its own view, in its own size
+    if(presenter && (presenter_open = (presenter->open)(presenter))) {
+        presenter_colors = setup_colors(presenter);
+        event_watch(events, presenter->input, presenter_read, NULL);
+    }
+
+    while(slide) {
+
+        // lazily loaded deck, parse and lay out slides when shown, each
+        // one centered on its own width; a slide larger than the terminal
+        // is shown clipped
+        if(deck->index) {
+            max_cols = 0;
+            clipped = !layout_check_slide(deck, render, slide, slidenum, &max_cols);
+        }
+
+        // draw slide and send frame to the terminal
+        hidden = show_slide(render, deck, slide, sc, max_cols, slidenum, colors, &stop);
+        if(clipped)
+            clip_prompt(render, colors);
+        if(prompt)
+            search_prompt(render, query, found, colors);
+        (render->flush)(render);
+
+        // reply to the remote commands applied, and tell the followers
+        if(remote)
+            remote_state(remote, sc, deck->slides, MIN(slide->stop, slide_stops(slide)),
+                         slide_stops(slide), deck->hash);
+
+        // the next slide and the notes, from the layout and frames of the
+        // audience terminal
+        if(presenter_open)
+            presenter_draw(render, deck, slide, sc, stop, hidden, max_cols, slidenum, colors);
+
+        // prefetch the next slide
+        if(deck->index && slide->next)
+            markdown_parse(deck, slide->next);
+
+        // wait for user input, render the slides shown next and scan for
+        // further slides while idle
+        // a remote command queued meanwhile, or a state of the leader, is
+        // applied first
+        if((remote && remote_pending(remote)) || (follow && follow_pending(follow)) ||
+           (watch && watch_pending(watch))) {
+            c = EVENT_WAKE;
+        } else {
+            work = (idle_work_t) { render, deck, slide, sc, stop, hidden, max_cols,
+                                   slidenum, colors, frames && !highlight ? 2 : 0,
+                                   prompt, query, found, clipped };
+            event_idle(events, viewer_idle, &work);
+            c = event_key(events, render, -1);
+            hidden = work.hidden;
+            stop = work.stop;
+        }
+
+        // evaluate user input
+        i = 0;
+        count = 0;
+
+        // digits are a count for the following key, or the number of the
+        // slide to show if no key follows in time
+        if(!prompt && c >= '1' && c <= '9')
+            count = read_count(render, c, &c);
+
+        if (c == ERR && !count) {
+            // input is closed
+            // do not reload
+            reload = 0;
+            slide = NULL;
+        } else if (prompt && c != EVENT_WAKE) {
+            // edit the search query
+            if(c == 27) {
+                // ESC cancels the search
+                prompt = false;
+                qlen = 0;
+            } else if(c == '\n' || c == KEY_ENTER) {
+                prompt = false;
+            } else if(c == KEY_BACKSPACE || c == 8 || c == 127) {
+                if(qlen > 0)
+                    qlen--;
+                else
+                    prompt = false;
+            } else if(c >= 0 && c <= 0xff) {
+                // keys arrive byte by byte
+                byte = c;
+                len = mbrtowc(&wc, &byte, 1, &state);
+                if(len == (size_t) -1)
+                    memset(&state, 0, sizeof(state));
+                else if(len != (size_t) -2 && iswprint(wc) && qlen < SEARCH_QUERY)
+                    query[qlen++] = wc;
+            }
+
+            if(c != '\n' && c != KEY_ENTER) {
+                query[qlen] = L'\0';
+                for(i = 0; i <= qlen; i++)
+                    folded[i] = search_fold(query[i]);
+                highlight = qlen > 0 ? folded : NULL;
+
+                // show the first match as it is typed, starting at the
+                // slide the search started at
+                i = search_deck(deck, slide, sc, folded, origin, 1, true, &stops);
+                found = i > 0 || qlen == 0;
+                slide = slide_walk(slide, &sc, i > 0 ? i : origin);
+                if(i > 0)
+                    slide->stop = MAX(slide->stop, stops);
+            }
+        } else {
+            action = keymap_action(keymap, c);
+
+            if(c == EVENT_WAKE) {
+                // a remote command, a state of the leader or a change of
+                // the files, it ends a search being typed
+                prompt = false;
+                if(!remote || !remote_take(remote, &action, &count))
+                    action = ACTION_NONE;
+
+                if(action == ACTION_NONE && follow) {
+                    switch(follow_take(follow, noreload ? 0 : deck->hash, &i, &stops)) {
+                        case FOLLOW_RELOAD:
+                            // the leader shows another version of the deck
+                            action = ACTION_RELOAD;
+                            break;
+                        case FOLLOW_SHOW:
+                            // show the slide and stop of the leader
+                            if(i > deck->slides)
+                                markdown_scan(deck, i - deck->slides);
+                            if(i <= deck->slides) {
+                                slide = slide_walk(slide, &sc, i);
+                                slide->stop = stops;
+                            }
+                            break;
+                        default:
+                            break;
+                    }
+                }
+
+                // the files of the deck changed
+                if(action == ACTION_NONE && watch && watch_take(watch))
+                    action = ACTION_RELOAD;
+
+            // a count on its own, or before first or last, is a slide number
+            } else if(count && (c == ERR || action == ACTION_FIRST || action == ACTION_LAST)) {
+                action = ACTION_GOTO;
+            } else if(action == ACTION_GOTO && !count) {
+                count = goto_prompt(render, colors);
+            }
+
+            switch(action) {
+                case ACTION_GOTO:
+                    // show slide n
+                    if(count > deck->slides)
+                        markdown_scan(deck, count - deck->slides);
+                    if(count > 0 && count <= deck->slides)
+                        slide = slide_walk(slide, &sc, count);
+                    break;
+
+                case ACTION_SEARCH:
+                    // start a new search
+                    prompt = found = true;
+                    origin = sc;
+                    qlen = 0;
+                    query[0] = folded[0] = L'\0';
+                    highlight = NULL;
+                    memset(&state, 0, sizeof(state));
+                    break;
+
+                case ACTION_SEARCH_NEXT:
+                case ACTION_SEARCH_PREV:
+                    // show next or previous match
+                    i = search_deck(deck, slide, sc, folded, sc,
+                                    action == ACTION_SEARCH_NEXT ? 1 : -1, false, &stops);
+                    if(i > 0) {
+                        slide = slide_walk(slide, &sc, i);
+                        slide->stop = MAX(slide->stop, stops);
+                    }
+                    break;
+
+                case ACTION_OVERVIEW:
+                    // pick a slide from the overview
+                    i = overview(render, deck, sc, colors);
+                    if(i > 0)
+                        slide = slide_walk(slide, &sc, i);
+                    break;
+
+                case ACTION_PAGER:
+                    // scroll through the deck as one document
+                    if(!pager)
+                        pager = pager_init();
+                    i = pager_view(render, deck, pager, sc, slidenum, colors);
+                    slide = pager->slide[i - 1];
+                    sc = i;
+                    break;
+
+                case ACTION_TOC:
+                    // jump to a headline
+                    i = toc_overlay(render, deck, sc, colors);
+                    if(i > 0)
+                        slide = slide_walk(slide, &sc, i);
+                    break;
+
+                case ACTION_PREV:
+                    if(count) {
+                        // move back count slides, stops are skipped
+                        for(i = 0; i < count && slide->prev; i++) {
+                            slide = slide->prev;
+                            sc--;
+                        }
+                        if(i)
+                            slide->stop = 0;
+                    } else if(stop > 1 || (stop == 1 && !hidden)) {
+                        // show current slide again
+                        // but stop one stop bit earlier
+                        slide->stop--;
+                    } else {
+                        if(slide->prev) {
+                            // show previous slide
+                            slide = slide->prev;
+                            sc--;
+                            //stop on first bullet point always
+                            if(slide->stop > 0)
+                                slide->stop = 0;
+                        }
+                    }
+                    break;
+
+                case ACTION_NEXT:
+                    if(count) {
+                        // move on count slides, stops are skipped
+                        for(i = 0; i < count; i++) {
+                            if(!slide->next)
+                                markdown_scan(deck, 1);
+                            if(!slide->next)
+                                break;
+                            slide = slide->next;
+                            sc++;
+                        }
+                    } else if(stop && hidden) {
+                        // show current slide again
+                        // but stop one stop bit later (or at end of slide)
+                        slide->stop++;
+                    } else {
+                        // find the next slide of a lazily loaded deck
+                        if(!slide->next)
+                            markdown_scan(deck, 1);
+                        if(slide->next) {
+                            // show next slide
+                            slide = slide->next;
+                            sc++;
+                        }
+                    }
+                    break;
+
+                case ACTION_REVEAL:
+                    // show all stops of the current slide
+                    slide->stop = slide_stops(slide);
+                    break;
+
+                case ACTION_FIRST:
+                    // show first slide
+                    slide = deck->slide;
+                    sc = 1;
+                    break;
+
+                case ACTION_LAST:
+                    // show last slide
+                    markdown_scan(deck, INT_MAX);
+                    for(i = sc; i <= deck->slides; i++) {
+                        if(slide->next) {
+                                slide = slide->next;
+                                sc++;
+                        }
+                    }
+                    break;
+
+                case ACTION_RELOAD:
+                    // reload
+                    if(noreload == 0) {
+                        // reload slide N
+                        reload = sc;
+                        slide = NULL;
+                    }
+                    break;
+
+                case ACTION_QUIT:
+                    // quit
+                    // do not reload
+                    reload = 0;
+                    slide = NULL;
+                    break;
+
+                default:
+                    break;
+            }
+        }
+    }
+
+    // the query goes out of scope
+    highlight = NULL;
+
+    if(pager)
+        pager_delete(pager);
+
+    presenter_release();
+    events_release();
+
+    // disable screen
+    (render->close)(render);
+
+    // return reload indicator (0 means no reload)
+    return reload;
+}
+
+bool print_deck(deck_t *deck, render_t *render, int slidenum, bool ansi) {
 
-    int c = 0;                // char
-    int i = 0;                // iterate
-    int l = 0;                // line number
-    int lc = 0;               // line count
     int sc = 1;               // slide count
     int colors = 0;           // amount of colors supported
     int max_lines = 0;        // max lines per slide
     int max_lines_slide = -1; // the slide that has the most lines
     int max_cols = 0;         // max columns per line
-    int offset;               // text offset
     int stop = 0;             // passed stop bits per slide
 
-    // header line 1 is displayed at the top
-    int bar_top = (deck->headers > 0) ? 1 : 0;
-    // header line 2 is displayed at the bottom
-    // anyway we display the slide number at the bottom
-    int bar_bottom = (slidenum || deck->headers > 1)? 1 : 0;
-
     slide_t *slide = deck->slide;
-    line_t *line;
 
-    // init ncurses
-    initscr();
+    if(!layout_check(deck, render, slidenum, &max_lines, &max_cols, &max_lines_slide))
+        return false;
+
+    colors = setup_colors(render);
 
     while(slide) {
-        lc = 0;
-        line = slide->line;
 
-        while(line && line->text) {
+        // reveal all stops
+        slide->stop = INT_MAX - 1;
 
-            if (line->text->value) {
-                lc += url_count_inline(line->text->value);
-                line->length -= url_len_inline(line->text->value);
-            }
+        display_slide(render, deck, slide, sc, max_cols, slidenum, colors, &stop);
+        (render->flush)(render);
+        render_headless_dump(render, stdout, ansi);
+
+        slide->stop = 0;
+        slide = slide->next;
+        sc++;
+    }
 
-            if(line->length > COLS) {
-                i = line->length;
-                offset = 0;
-                while(i > COLS) {
+    return true;
+}
 
-                    i = prev_blank(line->text, offset + COLS) - offset;
+int layout_slide(slide_t *slide, int cols, int *max_cols) {
 
-                    // single word is > COLS
-                    if(!i) {
-                        // calculate min_width
-                        i = next_blank(line->text, offset + COLS) - offset;
+    int i = 0;  // iterate
+    int lc = 0; // line count
+    int ln;     // line number
+    int n;      // line number in pack
+    int length; // line length
+    int offset; // text offset
+    int min_width = 0; // width needed by a single word
 
-                        // disable ncurses
-                        endwin();
+    pack_t *pack = slide->pack;
+    cstring_t view;
+    cstring_t *text;
 
-                        // print error
-                        fwprintf(stderr, L"Error: Terminal width (%i columns) too small. Need at least %i columns.\n", COLS, i);
-                        fwprintf(stderr, L"You may need to shorten some lines by inserting line breaks.\n");
+    for(ln = 0; ln < slide->lines; ln++) {
+        n = slide->first + ln;
+        length = pack->length[n];
 
-                        // no reload
-                        return 0;
-                    }
+        // only lines to wrap or with links need to be decoded
+        if(length <= cols &&
+           (pack->size[n] < 0 || !memchr(&pack->text[pack->start[n]], '[', pack->size[n]))) {
+            *max_cols = MAX(length, *max_cols);
+            lc++;
+            continue;
+        }
+
+        text = pack_line(slide, ln, &view);
+
+        if (text->value)
+            lc += url_count_inline(text->value);
 
-                    // set max_cols
-                    max_cols = MAX(i, max_cols);
+        if(length > cols) {
+            i = length;
+            offset = 0;
+            while(i > cols) {
 
-                    // iterate to next line
-                    offset = prev_blank(line->text, offset + COLS);
-                    i = line->length - offset;
-                    lc++;
+                i = prev_blank(text, MIN(offset + cols, text->size)) - offset;
+
+                // single word is > cols
+                if(i <= 0) {
+                    // calculate min_width, the terminal breaks the word
+                    if(!min_width)
+                        min_width = next_blank(text, offset + cols) - offset;
+                    i = cols;
                 }
-                // set max_cols one last time
-                max_cols = MAX(i, max_cols);
-            } else {
+
                 // set max_cols
-                max_cols = MAX(line->length, max_cols);
+                *max_cols = MAX(i, *max_cols);
+
+                // iterate to next line
+                offset += i;
+                i = length - offset;
+                lc++;
+            }
+            // set max_cols one last time
+            *max_cols = MAX(i, *max_cols);
+        } else {
+            // set max_cols
+            *max_cols = MAX(length, *max_cols);
+        }
+        lc++;
+    }
+
+    slide->lines_consumed = lc;
+
+    return min_width;
+}
+
+#if defined( HAVE_PTHREAD )
+// slides of a deck shared by the threads laying them out
+typedef struct _layout_pool_t {
+    slide_t **slide;
+    int slides;
+    int cols;
+    int next;          // first slide of the next block to lay out
+} layout_pool_t;
+
+typedef struct _layout_worker_t {
+    layout_pool_t *pool;
+    pthread_t thread;
+    int max_cols;      // widest line of the slides laid out
+    int failed;        // first slide not fitting, or the amount of slides
+    int min_width;     // width needed by it
+} layout_worker_t;
+
+// lay out blocks of slides until all are taken, a worker stops at a slide
+// not fitting as all blocks it would take later follow that slide
+static void *layout_work(void *arg) {
+    layout_worker_t *w = arg;
+    layout_pool_t *pool = w->pool;
+    int first, n;
+
+    while(w->failed == pool->slides &&
+          (first = __atomic_fetch_add(&pool->next, LAYOUT_BLOCK, __ATOMIC_RELAXED)) < pool->slides) {
+        for(n = first; n < MIN(first + LAYOUT_BLOCK, pool->slides); n++) {
+            if((w->min_width = layout_slide(pool->slide[n], pool->cols, &w->max_cols))) {
+                w->failed = n;
+                break;
             }
-            lc++;
-            line = line->next;
         }
+    }
+
+    // the buffer of pack_line would be lost with the thread
+    if(line_text) {
+        (line_text->delete)(line_text);
+        line_text = NULL;
+    }
+
+    return NULL;
+}
+
+// lay out the slides of a large deck on several threads like layout_deck,
+// widening max_cols; returns -1 if the deck is laid out faster on one
+static int layout_threads(deck_t *deck, int cols, int *max_cols) {
+    layout_worker_t worker[LAYOUT_THREADS];
+    layout_pool_t pool;
+    slide_t *slide;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = MIN(MIN(cpus, LAYOUT_THREADS), deck->slides / LAYOUT_SLIDES);
+    int i, n, started, failed;
+
+    if(threads < 2)
+        return -1;
+
+    if(!(pool.slide = malloc(deck->slides * sizeof(slide_t *)))) {
+        fprintf(stderr, "%s\n", "layout_deck() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+    for(n = 0, slide = deck->slide; slide && n < deck->slides; slide = slide->next)
+        pool.slide[n++] = slide;
+    pool.slides = n;
+    pool.cols = cols;
+    pool.next = 0;
+
+    for(i = 0; i < threads; i++) {
+        worker[i].pool = &pool;
+        worker[i].max_cols = 0;
+        worker[i].failed = n;
+        worker[i].min_width = 0;
+    }
+
+    // this thread takes blocks as well, so a thread failing to start only
+    // leaves more of them to the others
+    for(started = 1; started < threads; started++)
+        if(pthread_create(&worker[started].thread, NULL, layout_work, &worker[started]))
+            break;
+    layout_work(&worker[0]);
+
+    failed = 0;
+    for(i = 0; i < started; i++) {
+        if(i)
+            pthread_join(worker[i].thread, NULL);
+        *max_cols = MAX(worker[i].max_cols, *max_cols);
+        if(worker[i].failed < worker[failed].failed)
+            failed = i;
+    }
+    free(pool.slide);
+
+    return worker[failed].min_width;
+}
+#endif // defined( HAVE_PTHREAD )
+
+int layout_deck(deck_t *deck, int cols, int *max_lines, int *max_cols, int *max_lines_slide) {
 
-        max_lines = MAX(lc, max_lines);
-        if (lc == max_lines) {
-            max_lines_slide = sc;
+    int sc = 1;        // slide count
+    int min_width = 0; // width needed by a single word
+    bool done = false; // rows of all slides calculated already
+
+    slide_t *slide = deck->slide;
+
+    *max_lines = *max_cols = 0;
+    *max_lines_slide = -1;
+
+#if defined( HAVE_PTHREAD )
+    if((min_width = layout_threads(deck, cols, max_cols)) > 0)
+        return min_width;
+    done = min_width == 0;
+#endif
+
+    while(slide) {
+        if(!done && (min_width = layout_slide(slide, cols, max_cols)))
+            return min_width;
+
+        *max_lines = MAX(slide->lines_consumed, *max_lines);
+        if (slide->lines_consumed == *max_lines) {
+            *max_lines_slide = sc;
         }
 
-        slide->lines_consumed = lc;
         slide = slide->next;
         ++sc;
     }
 
-    // not enough lines
-    if(max_lines + bar_top + bar_bottom > LINES) {
+    return 0;
+}
 
-        // disable ncurses
-        endwin();
+static bool layout_fits(deck_t *deck, render_t *render, int slidenum, int min_width, int lines, int sc) {
 
-        // print error
-        fwprintf(stderr, L"Error: Terminal height (%i lines) too small. Need at least %i lines for slide #%i.\n", LINES, max_lines + bar_top + bar_bottom, max_lines_slide);
-        fwprintf(stderr, L"You may need to add additional horizontal rules (---) to split your file in shorter slides.\n");
+    int bar_top = (deck->headers > 0) ? 1 : 0;
+    int bar_bottom = (slidenum || deck->headers > 1)? 1 : 0;
 
-        // no reload
-        return 0;
-    }
+    // single word is wider than the terminal
+    if(min_width) {
 
-    // disable cursor
-    curs_set(0);
+        // disable screen
+        (render->close)(render);
 
-    // disable output of keyboard typing
-    noecho();
+        // print error
+        fwprintf(stderr, L"Error: Terminal width (%i columns) too small. Need at least %i columns.\n", render->cols, min_width);
+        fwprintf(stderr, L"You may need to shorten some lines by inserting line breaks.\n");
 
-    // make getch() process one char at a time
-    cbreak();
+        return false;
+    }
 
-    // enable arrow keys
-    keypad(stdscr,TRUE);
+    // not enough lines
+    if(lines + bar_top + bar_bottom > render->lines) {
 
-    // set colors
-    if(has_colors() == TRUE) {
-        start_color();
-        use_default_colors();
+        // disable screen
+        (render->close)(render);
 
-        init_pair(CP_FG, FG_COLOR, BG_COLOR);
-        init_pair(CP_HEADER, HEADER_COLOR, BG_COLOR);
-        init_pair(CP_BOLD, BOLD_COLOR, BG_COLOR);
-        init_pair(CP_TITLE, TITLE_COLOR, BG_COLOR);
-        init_pair(CP_CODE, CODEFG_COLOR, CODEBG_COLOR);
+        // print error
+        fwprintf(stderr, L"Error: Terminal height (%i lines) too small. Need at least %i lines for slide #%i.\n", render->lines, lines + bar_top + bar_bottom, sc);
+        fwprintf(stderr, L"You may need to add additional horizontal rules (---) to split your file in shorter slides.\n");
 
-        colors = 1;
+        return false;
     }
 
-    // set background color for main window
-    if(colors)
-        wbkgd(stdscr, COLOR_PAIR(CP_FG));
+    return true;
+}
 
-    // setup content window
-    WINDOW *content = newwin(LINES - bar_top - bar_bottom, COLS, 0 + bar_top, 0);
+bool layout_check(deck_t *deck, render_t *render, int slidenum, int *max_lines, int *max_cols, int *max_lines_slide) {
 
-    // set background color of content window
-    if(colors)
-        wbkgd(content, COLOR_PAIR(CP_FG));
+    int min_width = layout_deck(deck, render->cols, max_lines, max_cols, max_lines_slide);
 
-    slide = deck->slide;
+    return layout_fits(deck, render, slidenum, min_width, *max_lines, *max_lines_slide);
+}
 
-    // find slide to reload
-    sc = 1;
-    while(reload > 1 && reload <= deck->slides) {
-        slide = slide->next;
-        sc++;
-        reload--;
-    }
+bool layout_check_slide(deck_t *deck, render_t *render, slide_t *slide, int slidenum, int *max_cols) {
 
-    // reset reload indicator
-    reload = 0;
+    int bar_top = (deck->headers > 0) ? 1 : 0;
+    int bar_bottom = (slidenum || deck->headers > 1)? 1 : 0;
+    int min_width;
 
-    while(slide) {
+    markdown_parse(deck, slide);
+    min_width = layout_slide(slide, render->cols, max_cols);
 
-        url_init();
+    return !min_width && slide->lines_consumed + bar_top + bar_bottom <= render->lines;
+}
 
-        // clear windows
-        werase(content);
-        werase(stdscr);
+int setup_colors(render_t *render) {
 
-        // always resize window in case terminal geometry has changed
-        wresize(content, LINES - bar_top - bar_bottom, COLS);
+    if(!render->colors)
+        return 0;
 
-        // set main window text color
-        if(colors)
-            wattron(stdscr, COLOR_PAIR(CP_TITLE));
-
-        // setup header
-        if(bar_top) {
-            line = deck->header;
-            offset = next_blank(line->text, 0) + 1;
-            // add text to header
-            mvwaddwstr(stdscr,
-                       0, (COLS - line->length + offset) / 2,
-                       &line->text->value[offset]);
-        }
+    (render->init_pair)(render, CP_FG, FG_COLOR, BG_COLOR);
+    (render->init_pair)(render, CP_HEADER, HEADER_COLOR, BG_COLOR);
+    (render->init_pair)(render, CP_BOLD, BOLD_COLOR, BG_COLOR);
+    (render->init_pair)(render, CP_TITLE, TITLE_COLOR, BG_COLOR);
+    (render->init_pair)(render, CP_CODE, CODEFG_COLOR, CODEBG_COLOR);
 
-        // setup footer
-        if(deck->headers > 1) {
-            line = deck->header->next;
-            offset = next_blank(line->text, 0) + 1;
-            switch(slidenum) {
-                case 0: // add text to center footer
-                    mvwaddwstr(stdscr,
-                               LINES - 1, (COLS - line->length + offset) / 2,
-                               &line->text->value[offset]);
-                    break;
-                case 1:
-                case 2: // add text to left footer
-                    mvwaddwstr(stdscr,
-                               LINES - 1, 3,
-                               &line->text->value[offset]);
-                    break;
-            }
-        }
+    // set background color for blank cells
+    (render->bkgd)(render, CP_FG);
 
-        // add slide number to right footer
-        switch(slidenum) {
-            case 1: // show slide number only
-                mvwprintw(stdscr,
-                          LINES - 1, COLS - int_length(sc) - 3,
-                          "%d", sc);
-                break;
-            case 2: // show current slide & number of slides
-                mvwprintw(stdscr,
-                          LINES - 1, COLS - int_length(deck->slides) - int_length(sc) - 6,
-                          "%d / %d", sc, deck->slides);
-                break;
-        }
+    return 1;
+}
 
-        // copy changed lines in main window to virtual screen
-        wnoutrefresh(stdscr);
+int display_slide(render_t *render, deck_t *deck, slide_t *slide, int sc, int max_cols, int slidenum, int colors, int *stop) {
 
-        line = slide->line;
-        l = stop = 0;
+    int l = 0;        // line number on screen
+    int ln = 0;       // line number in slide
+    int top;          // first line of the slide on screen
+    char number[32];  // formatted slide number
 
-        // print lines
-        while(line) {
-            add_line(content, l + ((LINES - slide->lines_consumed - bar_top - bar_bottom) / 2),
-                     (COLS - max_cols) / 2, line, max_cols, colors);
+    // header line 1 is displayed at the top
+    int bar_top = (deck->headers > 0) ? 1 : 0;
+    // header line 2 is displayed at the bottom
+    // anyway we display the slide number at the bottom
+    int bar_bottom = (slidenum || deck->headers > 1)? 1 : 0;
 
-            // raise stop counter if we pass a line having a stop bit
-            if(CHECK_BIT(line->bits, IS_STOP))
-                stop++;
+    url_init();
 
-            l += (line->length / COLS) + 1;
-            line = line->next;
+    // clear screen
+    (render->erase)(render);
 
-            // only stop here if we didn't stop here recently
-            if(stop > slide->stop)
-                break;
-        }
+    display_bars(render, deck, sc, slidenum, colors);
 
-        // print pandoc URL references
-        // only if we already printed all lines of the current slide (or output is stopped)
-        if(!line ||
-           stop > slide->stop) {
-            int i, ymax;
-            getmaxyx( content, ymax, i );
-            for (i = 0; i < url_get_amount(); i++) {
-                mvwprintw(content, ymax - url_get_amount() - 1 + i, 3,
-                          "[%d] ", i);
-                waddwstr(content, url_get_target(i));
-            }
-        }
+    // draw slide content below the header
+    (render->viewport)(render, bar_top, render->lines - bar_top - bar_bottom);
+    if(colors)
+        (render->attron)(render, CP_FG);
 
-        // copy changed lines in content window to virtual screen
-        wnoutrefresh(content);
+    ln = l = *stop = 0;
 
-        // compare virtual screen to physical screen and does the actual updates
-        doupdate();
+    // center vertically, a slide larger than the terminal is clipped at
+    // the bottom
+    top = MAX((render->lines - slide->lines_consumed - bar_top - bar_bottom) / 2, 0);
 
-        // wait for user input
-        c = getch();
+    // print lines
+    while(ln < slide->lines) {
+        display_line(render, l + top, (render->cols - max_cols) / 2, slide, ln, max_cols, colors);
 
-        // evaluate user input
-        i = 0;
+        // raise stop counter if we pass a line having a stop bit
+        if(CHECK_BIT(slide->pack->bits[slide->first + ln], IS_STOP))
+            (*stop)++;
 
-        if (evaluate_binding(prev_slide_binding, c)) {
-            // show previous slide or stop bit
-            if(stop > 1 || (stop == 1 && !line)) {
-                // show current slide again
-                // but stop one stop bit earlier
-                slide->stop--;
-            } else {
-                if(slide->prev) {
-                    // show previous slide
-                    slide = slide->prev;
-                    sc--;
-                    //stop on first bullet point always
-                    if(slide->stop > 0)
-                        slide->stop = 0;
-                }
-            }
-        } else if (evaluate_binding(next_slide_binding, c)) {
-            // show next slide or stop bit
-            if(stop && line) {
-                // show current slide again
-                // but stop one stop bit later (or at end of slide)
-                slide->stop++;
-            } else {
-                if(slide->next) {
-                    // show next slide
-                    slide = slide->next;
-                    sc++;
-                }
-            }
-        } else if (isdigit(c) && c != '0') {
-            // show slide n
-            i = get_slide_number(c);
-            if(i > 0 && i <= deck->slides) {
-                while(sc != i) {
-                    // search forward
-                    if(sc < i) {
-                        if(slide->next) {
-                            slide = slide->next;
-                            sc++;
-                        }
-                    // search backward
-                    } else {
-                        if(slide->prev) {
-                            slide = slide->prev;
-                            sc--;
-                        }
-                    }
-                }
-            }        
-        } else if (evaluate_binding(first_slide_binding, c)) {
-            // show first slide
-            slide = deck->slide;
-            sc = 1;
-        } else if (evaluate_binding(last_slide_binding, c)) {
-            // show last slide
-            for(i = sc; i <= deck->slides; i++) {
-                if(slide->next) {
-                        slide = slide->next;
-                        sc++;
-                }
-            }
-        } else if (evaluate_binding(reload_binding, c)) {
-            // reload
-            if(noreload == 0) {
-                // reload slide N
-                reload = sc;
-                slide = NULL;
-            }
-        } else if (evaluate_binding(quit_binding, c)) {
-            // quit
-            // do not reload
-            reload = 0;
-            slide = NULL;
-        }
+        l += (slide->pack->length[slide->first + ln] / render->cols) + 1;
+        ln++;
 
-        url_purge();
+        // only stop here if we didn't stop here recently
+        if(*stop > slide->stop)
+            break;
     }
 
-    // disable ncurses
-    endwin();
+    // compile the lines when the slide is shown again
+    if(!slide->display)
+        slide->display = display_init();
+    markdown_account(deck, slide);
+
+    // print pandoc URL references
+    // only if we already printed all lines of the current slide (or output is stopped)
+    if(ln == slide->lines ||
+       *stop > slide->stop) {
+        int i, ymax = render->lines - bar_top - bar_bottom;
+        for (i = 0; i < url_get_amount(); i++) {
+            snprintf(number, sizeof(number), "[%d] ", i);
+            (render->move)(render, ymax - url_get_amount() - 1 + i, 3);
+            (render->addstr)(render, number);
+            (render->addnwstr)(render, url_get_target(i), -1);
+        }
+    }
 
-    // free ncurses memory
-    delwin(content);
-    if(reload == 0)
-        delwin(stdscr);
+    url_purge();
 
-    // return reload indicator (0 means no reload)
-    return reload;
+    return slide->lines - ln;
 }
 
 void setup_list_strings(void)
@@ -404,21 +1974,30 @@ void setup_list_strings(void)
     }
 }
 
-void add_line(WINDOW *window, int y, int x, line_t *line, int max_cols, int colors) {
+void add_line(render_t *render, int y, int x, slide_t *slide, int ln, int max_cols, int colors) {
 
     int i; // increment
     int offset = 0; // text offset
 
+    // line ln of the slide, and the bits of the line following it
+    cstring_t view;
+    cstring_t *text = pack_line(slide, ln, &view);
+    int bits = slide->pack->bits[slide->first + ln];
+    int length = slide->pack->length[slide->first + ln];
+    int next_bits = ln + 1 < slide->lines ? slide->pack->bits[slide->first + ln + 1] : 0;
+
+    mark_matches(text);
+
     // move the cursor in position
-    wmove(window, y, x);
+    (render->move)(render, y, x);
 
-    if(!line->text->value) {
+    if(!text->value) {
 
         // fill rest off line with spaces if we are in a code block
-        if(CHECK_BIT(line->bits, IS_CODE) && colors) {
-            wattron(window, COLOR_PAIR(CP_CODE));
-            for(i = getcurx(window) - x; i < max_cols; i++)
-                wprintw(window, "%s", " ");
+        if(CHECK_BIT(bits, IS_CODE) && colors) {
+            (render->attron)(render, CP_CODE);
+            for(i = (render->getx)(render) - x; i < max_cols; i++)
+                (render->addstr)(render, " ");
         }
 
         // do nothing
@@ -426,169 +2005,171 @@ void add_line(WINDOW *window, int y, int x, line_t *line, int max_cols, int colo
     }
 
     // IS_UNORDERED_LIST_3
-    if(CHECK_BIT(line->bits, IS_UNORDERED_LIST_3)) {
-        offset = next_nonblank(line->text, 0);
+    if(CHECK_BIT(bits, IS_UNORDERED_LIST_3)) {
+        offset = next_nonblank(text, 0);
         char prompt[13 * 6];
         int pos = 0, len, cnt;
         len = sizeof(prompt) - pos;
-        cnt = snprintf(&prompt[pos], len, "%s", CHECK_BIT(line->bits, IS_UNORDERED_LIST_1)? list_open1 : "    ");
+        cnt = snprintf(&prompt[pos], len, "%s", CHECK_BIT(bits, IS_UNORDERED_LIST_1)? list_open1 : "    ");
         pos += (cnt > len - 1 ? len - 1 : cnt);
         len = sizeof(prompt) - pos;
-        cnt = snprintf(&prompt[pos], len, "%s", CHECK_BIT(line->bits, IS_UNORDERED_LIST_2)? list_open2 : "    ");
+        cnt = snprintf(&prompt[pos], len, "%s", CHECK_BIT(bits, IS_UNORDERED_LIST_2)? list_open2 : "    ");
         pos += (cnt > len - 1 ? len - 1 : cnt);
         len = sizeof(prompt) - pos;
 
-        if(CHECK_BIT(line->bits, IS_UNORDERED_LIST_EXT)) {
-            snprintf(&prompt[pos], len, "%s", line->next && CHECK_BIT(line->next->bits, IS_UNORDERED_LIST_3)? list_open3 : "    ");
+        if(CHECK_BIT(bits, IS_UNORDERED_LIST_EXT)) {
+            snprintf(&prompt[pos], len, "%s", CHECK_BIT(next_bits, IS_UNORDERED_LIST_3)? list_open3 : "    ");
         } else {
             snprintf(&prompt[pos], len, "%s", list_head3);
             offset += 2;
         }
 
-        wprintw(window,
-                "%s", prompt);
+        (render->addstr)(render, prompt);
 
-        if(!CHECK_BIT(line->bits, IS_CODE))
-            inline_display(window, &line->text->value[offset], colors);
+        if(!CHECK_BIT(bits, IS_CODE))
+            inline_display(render, &text->value[offset], colors);
 
     // IS_UNORDERED_LIST_2
-    } else if(CHECK_BIT(line->bits, IS_UNORDERED_LIST_2)) {
-        offset = next_nonblank(line->text, 0);
+    } else if(CHECK_BIT(bits, IS_UNORDERED_LIST_2)) {
+        offset = next_nonblank(text, 0);
         char prompt[9 * 6];
         int pos = 0, len, cnt;
         len = sizeof(prompt) - pos;
-        cnt = snprintf(&prompt[pos], len, "%s", CHECK_BIT(line->bits, IS_UNORDERED_LIST_1)? list_open1 : "    ");
+        cnt = snprintf(&prompt[pos], len, "%s", CHECK_BIT(bits, IS_UNORDERED_LIST_1)? list_open1 : "    ");
         pos += (cnt > len - 1 ? len - 1 : cnt);
         len = sizeof(prompt) - pos;
 
-        if(CHECK_BIT(line->bits, IS_UNORDERED_LIST_EXT)) {
-            snprintf(&prompt[pos], len, "%s", line->next && CHECK_BIT(line->next->bits, IS_UNORDERED_LIST_2)? list_open2 : "    ");
+        if(CHECK_BIT(bits, IS_UNORDERED_LIST_EXT)) {
+            snprintf(&prompt[pos], len, "%s", CHECK_BIT(next_bits, IS_UNORDERED_LIST_2)? list_open2 : "    ");
         } else {
             snprintf(&prompt[pos], len, "%s", list_head2);
             offset += 2;
         }
 
-        wprintw(window,
-                "%s", prompt);
+        (render->addstr)(render, prompt);
 
-        if(!CHECK_BIT(line->bits, IS_CODE))
-            inline_display(window, &line->text->value[offset], colors);
+        if(!CHECK_BIT(bits, IS_CODE))
+            inline_display(render, &text->value[offset], colors);
 
     // IS_UNORDERED_LIST_1
-    } else if(CHECK_BIT(line->bits, IS_UNORDERED_LIST_1)) {
-        offset = next_nonblank(line->text, 0);
+    } else if(CHECK_BIT(bits, IS_UNORDERED_LIST_1)) {
+        offset = next_nonblank(text, 0);
         char prompt[5 * 6];
 
-        if(CHECK_BIT(line->bits, IS_UNORDERED_LIST_EXT)) {
-            strcpy(&prompt[0], line->next && CHECK_BIT(line->next->bits, IS_UNORDERED_LIST_1)? list_open1 : "    ");
+        if(CHECK_BIT(bits, IS_UNORDERED_LIST_EXT)) {
+            strcpy(&prompt[0], CHECK_BIT(next_bits, IS_UNORDERED_LIST_1)? list_open1 : "    ");
         } else {
             strcpy(&prompt[0], list_head1);
             offset += 2;
         }
 
-        wprintw(window,
-                "%s", prompt);
+        (render->addstr)(render, prompt);
 
-        if(!CHECK_BIT(line->bits, IS_CODE))
-            inline_display(window, &line->text->value[offset], colors);
+        if(!CHECK_BIT(bits, IS_CODE))
+            inline_display(render, &text->value[offset], colors);
     }
 
     // IS_CODE
-    if(CHECK_BIT(line->bits, IS_CODE)) {
+    if(CHECK_BIT(bits, IS_CODE)) {
 
-        if (!CHECK_BIT(line->bits, IS_TILDE_CODE) &&
-            !CHECK_BIT(line->bits, IS_GFM_CODE)) {
+        if (!CHECK_BIT(bits, IS_TILDE_CODE) &&
+            !CHECK_BIT(bits, IS_GFM_CODE)) {
             // set static offset for code
             offset = CODE_INDENT;
         }
 
         // color for code block
         if (colors)
-        wattron(window, COLOR_PAIR(CP_CODE));
+        (render->attron)(render, CP_CODE);
 
         // print whole lines
-        waddwstr(window, &line->text->value[offset]);
+        add_text(render, &text->value[offset], -1);
     }
 
-    if(!CHECK_BIT(line->bits, IS_UNORDERED_LIST_1) &&
-       !CHECK_BIT(line->bits, IS_UNORDERED_LIST_2) &&
-       !CHECK_BIT(line->bits, IS_UNORDERED_LIST_3) &&
-       !CHECK_BIT(line->bits, IS_CODE)) {
+    if(!CHECK_BIT(bits, IS_UNORDERED_LIST_1) &&
+       !CHECK_BIT(bits, IS_UNORDERED_LIST_2) &&
+       !CHECK_BIT(bits, IS_UNORDERED_LIST_3) &&
+       !CHECK_BIT(bits, IS_CODE)) {
 
         // IS_QUOTE
-        if(CHECK_BIT(line->bits, IS_QUOTE)) {
-            while(line->text->value[offset] == '>') {
+        if(CHECK_BIT(bits, IS_QUOTE)) {
+            while(text->value[offset] == '>') {
                 // print a code block
                 if(colors) {
-                    wattron(window, COLOR_PAIR(CP_CODE));
-                    wprintw(window, "%s", " ");
-                    wattron(window, COLOR_PAIR(CP_FG));
-                    wprintw(window, "%s", " ");
+                    (render->attron)(render, CP_CODE);
+                    (render->addstr)(render, " ");
+                    (render->attron)(render, CP_FG);
+                    (render->addstr)(render, " ");
                 } else {
-                    wprintw(window, "%s", ">");
+                    (render->addstr)(render, ">");
                 }
 
                 // find next quote or break
                 offset++;
-                if(line->text->value[offset] == ' ')
-                    offset = next_word(line->text, offset);
+                if(text->value[offset] == ' ')
+                    offset = next_word(text, offset);
             }
 
-            inline_display(window, &line->text->value[offset], colors);
+            inline_display(render, &text->value[offset], colors);
         } else {
 
             // IS_CENTER
-            if(CHECK_BIT(line->bits, IS_CENTER)) {
-                if(line->length < max_cols) {
-                    wmove(window, y, x + ((max_cols - line->length) / 2));
+            if(CHECK_BIT(bits, IS_CENTER)) {
+                if(length < max_cols) {
+                    (render->move)(render, y, x + ((max_cols - length) / 2));
                 }
             }
 
             // IS_H1 || IS_H2
-            if(CHECK_BIT(line->bits, IS_H1) || CHECK_BIT(line->bits, IS_H2)) {
+            if(CHECK_BIT(bits, IS_H1) || CHECK_BIT(bits, IS_H2)) {
 
                 // set headline color
                 if(colors)
-                    wattron(window, COLOR_PAIR(CP_HEADER));
+                    (render->attron)(render, CP_HEADER);
 
                 // enable underline for H1
-                if(CHECK_BIT(line->bits, IS_H1))
-                    wattron(window, A_UNDERLINE);
+                if(CHECK_BIT(bits, IS_H1))
+                    (render->attron)(render, GA_UNDERLINE);
 
                 // skip hashes
-                while(line->text->value[offset] == '#')
-                    offset = next_word(line->text, offset);
+                while(text->value[offset] == '#')
+                    offset = next_word(text, offset);
 
                 // print whole lines
-                waddwstr(window, &line->text->value[offset]);
+                add_text(render, &text->value[offset], -1);
 
-                wattroff(window, A_UNDERLINE);
+                (render->attroff)(render, GA_UNDERLINE);
 
             // no line-wide markdown
             } else {
 
-                inline_display(window, &line->text->value[offset], colors);
+                inline_display(render, &text->value[offset], colors);
             }
         }
     }
 
     // fill rest off line with spaces
     // we only need this if the color is inverted (e.g. code-blocks)
-    if(CHECK_BIT(line->bits, IS_CODE))
-        for(i = getcurx(window) - x; i < max_cols; i++)
-            wprintw(window, "%s", " ");
+    if(CHECK_BIT(bits, IS_CODE))
+        for(i = (render->getx)(render) - x; i < max_cols; i++)
+            (render->addstr)(render, " ");
 
     // reset to default color
     if(colors)
-        wattron(window, COLOR_PAIR(CP_FG));
-    wattroff(window, A_UNDERLINE);
+        (render->attron)(render, CP_FG);
+    (render->attroff)(render, GA_UNDERLINE);
+
+    mark_line = NULL;
 }
 
-void inline_display(WINDOW *window, const wchar_t *c, const int colors) {
+void inline_display(render_t *render, const wchar_t *c, const int colors) {
     const static wchar_t *special = L"\\*_`!["; // list of interpreted chars
     const wchar_t *i = c; // iterator
     const wchar_t *start_link_name, *start_url;
+    const wchar_t *bracket = NULL, *paren = NULL; // search caches
+    const wchar_t *end_link_name = NULL, *end_url = NULL;
     int length_link_name, url_num;
+    char ref[16];
     cstack_t *stack = cstack_init();
 
 
@@ -606,21 +2187,21 @@ void inline_display(WINDOW *window, const wchar_t *c, const int colors) {
                 switch(*i) {
                     // print escaped backslash
                     case L'\\':
-                        waddnwstr(window, i, 1);
+                        add_text(render, i, 1);
                         break;
                     // disable highlight
                     case L'*':
                         if(colors)
-                            wattron(window, COLOR_PAIR(CP_FG));
+                            (render->attron)(render, CP_FG);
                         break;
                     // disable underline
                     case L'_':
-                        wattroff(window, A_UNDERLINE);
+                        (render->attroff)(render, GA_UNDERLINE);
                         break;
                     // disable inline code
                     case L'`':
                         if(colors)
-                            wattron(window, COLOR_PAIR(CP_FG));
+                            (render->attron)(render, CP_FG);
                         break;
                 }
 
@@ -629,7 +2210,7 @@ void inline_display(WINDOW *window, const wchar_t *c, const int colors) {
 
             // treat special as regular char
             } else if((stack->top)(stack, L'\\')) {
-                waddnwstr(window, i, 1);
+                add_text(render, i, 1);
 
                 // remove backslash from stack
                 (stack->pop)(stack);
@@ -647,27 +2228,26 @@ void inline_display(WINDOW *window, const wchar_t *c, const int colors) {
                    *i == L'\\') {
 
                     // url in pandoc style
-                    if ((*i == L'[' && wcschr(i, L']')) ||
-                        (*i == L'!' && *(i + 1) == L'[' && wcschr(i, L']'))) {
+                    if ((*i == L'[' && (end_link_name = url_find_char(i, L']', &bracket))) ||
+                        (*i == L'!' && *(i + 1) == L'[' && (end_link_name = url_find_char(i, L']', &bracket)))) {
 
                         if (*i == L'!') i++;
 
-                        if (wcschr(i, L']')[1] == L'(' && wcschr(i, L')')) {
+                        if (end_link_name[1] == L'(' &&
+                            (end_url = url_find_char(end_link_name + 1, L')', &paren))) {
                             i++;
 
                             // turn higlighting and underlining on
                             if (colors)
-                                wattron(window, COLOR_PAIR(CP_HEADER));
-                            wattron(window, A_UNDERLINE);
+                                (render->attron)(render, CP_HEADER);
+                            (render->attron)(render, GA_UNDERLINE);
 
                             start_link_name = i;
 
                             // print the content of the label
                             // the label is printed as is
-                            do {
-                                waddnwstr(window, i, 1);
-                                i++;
-                            } while (*i != L']');
+                            add_text(render, i, end_link_name - i);
+                            i = end_link_name;
 
                             length_link_name = i - 1 - start_link_name;
 
@@ -675,34 +2255,34 @@ void inline_display(WINDOW *window, const wchar_t *c, const int colors) {
                             i++;
 
                             start_url = i;
-
-                            while (*i != L')') i++;
+                            i = end_url;
 
                             url_num = url_add(start_link_name, length_link_name, start_url, i - start_url, 0, 0);
 
-                            wprintw(window, " [%d]", url_num);
+                            snprintf(ref, sizeof(ref), " [%d]", url_num);
+                            (render->addstr)(render, ref);
 
                             // turn highlighting and underlining off
-                            wattroff(window, A_UNDERLINE);
-                            wattron(window, COLOR_PAIR(CP_FG));
+                            (render->attroff)(render, GA_UNDERLINE);
+                            (render->attron)(render, CP_FG);
 
                         } else {
-                            wprintw(window, "[");
+                            (render->addstr)(render, "[");
                         }
 
                     } else switch(*i) {
                         // enable highlight
                         case L'*':
                             if(colors)
-                                wattron(window, COLOR_PAIR(CP_BOLD));
+                                (render->attron)(render, CP_BOLD);
                             break;
                         // enable underline
                         case L'_':
-                            wattron(window, A_UNDERLINE);
+                            (render->attron)(render, GA_UNDERLINE);
                             break;
                         // enable inline code
                         case L'`':
-                            wattron(window, COLOR_PAIR(CP_CODE));
+                            (render->attron)(render, CP_CODE);
                             break;
                         // do nothing for backslashes
                     }
@@ -711,7 +2291,7 @@ void inline_display(WINDOW *window, const wchar_t *c, const int colors) {
                     (stack->push)(stack, *i);
 
                 } else {
-                    waddnwstr(window, i, 1);
+                    add_text(render, i, 1);
                 }
             }
 
@@ -721,7 +2301,7 @@ void inline_display(WINDOW *window, const wchar_t *c, const int colors) {
                 (stack->pop)(stack);
 
             // print regular char
-            waddnwstr(window, i, 1);
+            add_text(render, i, 1);
         }
     }
 
@@ -731,16 +2311,16 @@ void inline_display(WINDOW *window, const wchar_t *c, const int colors) {
             // disable highlight
             case L'*':
                 if(colors)
-                    wattron(window, COLOR_PAIR(CP_FG));
+                    (render->attron)(render, CP_FG);
                 break;
             // disable underline
             case L'_':
-                wattroff(window, A_UNDERLINE);
+                (render->attroff)(render, GA_UNDERLINE);
                 break;
             // disable inline code
             case L'`':
                 if(colors)
-                    wattron(window, COLOR_PAIR(CP_FG));
+                    (render->attron)(render, CP_FG);
                 break;
             // do nothing for backslashes
         }
@@ -758,30 +2338,4 @@ int int_length (int val) {
     return l;
 }
 
-int get_slide_number(char init) {
-    int retval = init - '0';
-    int c;
-    // block for tenths of a second when using getch, ERR if no input
-    halfdelay(GOTO_SLIDE_DELAY);
-    while((c = getch()) != ERR) {
-        if (c < '0' || c > '9') {
-            retval = -1;
-            break;
-        }
-        retval = (retval * 10) + (c - '0');
-    }
-    nocbreak();     // cancel half delay mode
-    cbreak();       // go back to cbreak
-    return retval;
-}
-
-bool evaluate_binding(const int bindings[], char c) {
-    int binding;
-    int ind = 0; 
-    while((binding = bindings[ind]) != 0) {
-        if (c == binding) return true;
-        ind++;
-    }
-    return false;
-}
 
@@ -0,0 +1,562 @@
+/*
+ * An output backend writing VT100/ANSI escape sequences directly to the
+ * terminal, without ncurses and terminfo.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * The back buffer receives all drawing of a frame. On flush it is compared
+ * to the front buffer, which mirrors the terminal, and only changed cells
+ * are sent. Cursor moves are coalesced (short gaps are skipped forward or
+ * re-printed, line feeds are used where they are shorter than a cursor
+ * position) and SGR sequences are only emitted on attribute transitions.
+ * The frame is collected in a buffer and sent with a single write().
+ *
+ * A backend on a tty other than the controlling terminal gets no SIGWINCH,
+ * its geometry is queried with every frame instead.
+ *
+ */
+
+#define _GNU_SOURCE              // wcwidth
+#define _XOPEN_SOURCE_EXTENDED 1 // enable ncurses wchar support
+
+#include <errno.h>
+#include <fcntl.h>  // open
+#include <limits.h> // MB_LEN_MAX
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>  // snprintf
+#include <stdlib.h> // malloc, realloc, getenv
+#include <string.h> // memcpy
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h> // read, write
+#include <wchar.h>
+
+#if defined( WIN32 )
+#include <curses.h>
+#else
+#include <ncurses.h> // KEY_* and ERR, so key codes match the ncurses backend
+#endif
+
+#include "render.h"
+
+#define VT_MAX_PAIRS 256
+#define VT_SKIP_MAX  4   // max cells re-printed instead of moving the cursor
+
+typedef struct _vt100_data_t {
+    grid_t *front;          // what the terminal shows
+    grid_t *back;           // what the next frame will show
+    short pairs[VT_MAX_PAIRS][2];
+    int bkgd;               // attribute of blank cells
+    char *out;              // frame output buffer
+    size_t out_size;
+    size_t out_alloc;
+    unsigned char in[64];   // pending input bytes
+    int in_size;
+    struct termios saved;
+    int fd_in;              // terminal to read keys from
+    int fd_out;             // terminal to write frames to
+    bool tty;               // a tty of its own, opened by the backend
+    bool clear;             // front buffer is unknown, clear the screen first
+    bool opened;
+} vt100_data_t;
+
+#define VT(self) ((vt100_data_t *)(self)->data)
+
+static volatile sig_atomic_t vt100_resized = 0;
+
+static void vt100_sigwinch(int sig) {
+    vt100_resized = 1;
+}
+
+static void vt100_put(vt100_data_t *d, const char *s, size_t n) {
+    if(d->out_size + n > d->out_alloc) {
+        d->out_alloc = (d->out_size + n) * 2;
+        if((d->out = realloc(d->out, d->out_alloc)) == NULL) {
+            fprintf(stderr, "%s\n", "vt100_put() failed to reallocate memory.");
+            exit(EXIT_FAILURE);
+        }
+    }
+    memcpy(&d->out[d->out_size], s, n);
+    d->out_size += n;
+}
+
+static void vt100_puts(vt100_data_t *d, const char *s) {
+    vt100_put(d, s, strlen(s));
+}
+
+// send the output buffer with a single write, only retrying partial writes
+static size_t vt100_send(vt100_data_t *d) {
+    size_t done = 0;
+    ssize_t n;
+
+    while(done < d->out_size) {
+        n = write(d->fd_out, &d->out[done], d->out_size - done);
+        if(n < 0) {
+            if(errno == EINTR || errno == EAGAIN)
+                continue;
+            break;
+        }
+        done += n;
+    }
+    d->out_size = 0;
+    return done;
+}
+
+// force a full redraw with the next frame
+static void vt100_invalidate(vt100_data_t *d) {
+    d->clear = true;
+}
+
+// geometry of a tty of its own, the one of STDOUT otherwise
+static void vt100_geometry(vt100_data_t *d, int *lines, int *cols) {
+    struct winsize ws;
+
+    if(!d->tty) {
+        render_geometry(lines, cols);
+    } else if(ioctl(d->fd_out, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0 && ws.ws_col > 0) {
+        *lines = ws.ws_row;
+        *cols = ws.ws_col;
+    } else if(*lines <= 0 || *cols <= 0) {
+        *lines = 24;
+        *cols = 80;
+    }
+}
+
+static bool vt100_open(render_t *self) {
+    vt100_data_t *d = VT(self);
+    struct termios raw;
+    struct sigaction sa;
+
+    if(tcgetattr(d->fd_in, &d->saved) != 0)
+        return false;
+
+    // make read() process one char at a time, without echo
+    raw = d->saved;
+    raw.c_lflag &= ~(ICANON | ECHO);
+    raw.c_iflag &= ~(ICRNL | IXON);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    tcsetattr(d->fd_in, TCSAFLUSH, &raw);
+
+    if(!d->tty) {
+        sa.sa_handler = vt100_sigwinch;
+        sigemptyset(&sa.sa_mask);
+        sa.sa_flags = 0;
+        sigaction(SIGWINCH, &sa, NULL);
+    }
+
+    vt100_geometry(d, &self->lines, &self->cols);
+    grid_resize(d->front, self->lines, self->cols);
+    grid_resize(d->back, self->lines, self->cols);
+    vt100_invalidate(d);
+
+    self->colors = 1;
+    d->opened = true;
+
+    // alternate screen, hide cursor
+    vt100_puts(d, "\033[?1049h\033[?25l");
+    vt100_send(d);
+    return true;
+}
+
+static void vt100_close(render_t *self) {
+    vt100_data_t *d = VT(self);
+
+    if(!d->opened)
+        return;
+
+    // reset attributes, show cursor, leave alternate screen
+    vt100_puts(d, "\033[0m\033[?25h\033[?1049l");
+    vt100_send(d);
+
+    tcsetattr(d->fd_in, TCSAFLUSH, &d->saved);
+    if(!d->tty)
+        signal(SIGWINCH, SIG_DFL);
+    d->opened = false;
+}
+
+static void vt100_init_pair(render_t *self, int pair, int fg, int bg) {
+    if(pair > 0 && pair < VT_MAX_PAIRS) {
+        VT(self)->pairs[pair][0] = fg;
+        VT(self)->pairs[pair][1] = bg;
+    }
+}
+
+static void vt100_bkgd(render_t *self, int attr) {
+    VT(self)->bkgd = attr;
+}
+
+static void vt100_erase(render_t *self) {
+    vt100_data_t *d = VT(self);
+    int lines = self->lines, cols = self->cols;
+
+    // pick up changes of the terminal geometry
+    if(d->tty)
+        vt100_geometry(d, &lines, &cols);
+    if((!d->tty && vt100_resized) || lines != self->lines || cols != self->cols) {
+        if(!d->tty) {
+            vt100_resized = 0;
+            render_geometry(&lines, &cols);
+        }
+        self->lines = lines;
+        self->cols = cols;
+        grid_resize(d->front, self->lines, self->cols);
+        vt100_invalidate(d);
+    }
+
+    if(d->back->lines != self->lines || d->back->cols != self->cols)
+        grid_resize(d->back, self->lines, self->cols);
+    grid_erase(d->back);
+}
+
+static void vt100_viewport(render_t *self, int top, int height) {
+    grid_viewport(VT(self)->back, top, height);
+}
+
+static void vt100_move(render_t *self, int y, int x) {
+    grid_move(VT(self)->back, y, x);
+}
+
+static void vt100_addnwstr(render_t *self, const wchar_t *s, int n) {
+    grid_addnwstr(VT(self)->back, s, n);
+}
+
+static void vt100_attron(render_t *self, int attr) {
+    grid_t *g = VT(self)->back;
+    if(GA_PAIR(attr))
+        g->attr = (g->attr & ~0xff) | GA_PAIR(attr);
+    g->attr |= attr & ~0xff;
+}
+
+static void vt100_attroff(render_t *self, int attr) {
+    grid_t *g = VT(self)->back;
+    if(GA_PAIR(attr))
+        g->attr &= ~0xff;
+    g->attr &= ~(attr & ~0xff);
+}
+
+static bool vt100_blit(render_t *self, const grid_t *g) {
+    // pick up changes of the terminal geometry first
+    vt100_erase(self);
+    if(g->lines != self->lines || g->cols != self->cols)
+        return false;
+
+    grid_copy(VT(self)->back, g);
+    return true;
+}
+
+static int vt100_getx(render_t *self) {
+    return VT(self)->back->x;
+}
+
+// emit the SGR sequence to switch from attribute from to attribute to,
+// from < 0 means the terminal state is unknown
+static void vt100_sgr(render_t *self, int from, int to) {
+    vt100_data_t *d = VT(self);
+    char seq[32];
+    int pos = 0, pair;
+
+    if(!GA_PAIR(to))
+        to |= GA_PAIR(d->bkgd);
+
+    if(from < 0) {
+        pos += snprintf(&seq[pos], sizeof(seq) - pos, "\033[0");
+        from = 0;
+    } else {
+        if(from == to)
+            return;
+        pos += snprintf(&seq[pos], sizeof(seq) - pos, "\033[");
+    }
+
+    if((from ^ to) & GA_UNDERLINE)
+        pos += snprintf(&seq[pos], sizeof(seq) - pos, "%s%s",
+                        seq[pos - 1] == '[' ? "" : ";",
+                        (to & GA_UNDERLINE) ? "4" : "24");
+
+    if((from ^ to) & GA_REVERSE)
+        pos += snprintf(&seq[pos], sizeof(seq) - pos, "%s%s",
+                        seq[pos - 1] == '[' ? "" : ";",
+                        (to & GA_REVERSE) ? "7" : "27");
+
+    if(GA_PAIR(from) != GA_PAIR(to)) {
+        pair = GA_PAIR(to);
+        if(self->colors && pair && pair < VT_MAX_PAIRS)
+            pos += snprintf(&seq[pos], sizeof(seq) - pos, "%s3%d;4%d",
+                            seq[pos - 1] == '[' ? "" : ";",
+                            d->pairs[pair][0], d->pairs[pair][1]);
+        else
+            pos += snprintf(&seq[pos], sizeof(seq) - pos, "%s39;49",
+                            seq[pos - 1] == '[' ? "" : ";");
+    }
+
+    // nothing changed after all
+    if(seq[pos - 1] == '[')
+        return;
+
+    vt100_put(d, seq, pos);
+    vt100_put(d, "m", 1);
+}
+
+static int vt100_cell_attr(vt100_data_t *d, const cell_t *cell) {
+    return GA_PAIR(cell->attr) ? cell->attr : cell->attr | GA_PAIR(d->bkgd);
+}
+
+static void vt100_flush(render_t *self) {
+    vt100_data_t *d = VT(self);
+    grid_t *front = d->front, *back = d->back;
+    cell_t *b, *f;
+    char seq[32], mb[MB_LEN_MAX];
+    mbstate_t state;
+    int y, x, i, n, w;
+    int cy = -1, cx = -1; // terminal cursor, -1 if unknown
+    int attr = -1;        // terminal attribute, -1 if unknown
+    size_t sent;
+
+    // clear the screen with the background color, so blank cells are
+    // known without sending them
+    if(d->clear) {
+        vt100_sgr(self, -1, d->bkgd);
+        attr = GA_PAIR(d->bkgd) ? d->bkgd : 0;
+        vt100_puts(d, "\033[2J");
+        for(i = 0; i < front->lines * front->cols; i++) {
+            front->cells[i].c = L' ';
+            front->cells[i].attr = attr;
+        }
+        d->clear = false;
+    }
+
+    for(y = 0; y < back->lines; y++) {
+        for(x = 0; x < back->cols; x += w) {
+            b = &back->cells[y * back->cols + x];
+            f = &front->cells[y * front->cols + x];
+            w = (x + 1 < back->cols && b[1].c == L'\0') ? 2 : 1;
+
+            if(b->c == f->c && vt100_cell_attr(d, b) == f->attr &&
+               (w == 1 || (b[1].c == f[1].c && vt100_cell_attr(d, &b[1]) == f[1].attr)))
+                continue;
+
+            // position the cursor
+            if(cy != y || cx != x) {
+                n = 0;
+                if(cy == y && cx < x && x - cx <= VT_SKIP_MAX) {
+
+                    // re-print unchanged cells if they share the attribute
+                    for(i = cx; i < x; i++) {
+                        if(back->cells[y * back->cols + i].c == L'\0' ||
+                           vt100_cell_attr(d, &back->cells[y * back->cols + i]) != attr ||
+                           back->cells[y * back->cols + i].c > 0x7f)
+                            break;
+                    }
+                    if(i == x) {
+                        for(i = cx; i < x && i - cx < sizeof(seq); i++)
+                            seq[i - cx] = (char) back->cells[y * back->cols + i].c;
+                        vt100_put(d, seq, x - cx);
+                        n = 1;
+                    }
+                }
+                if(!n) {
+                    if(cy == y && cx < x)
+                        n = snprintf(seq, sizeof(seq), "\033[%dC", x - cx);
+                    else if(cy >= 0 && cy + 1 == y && x == 0)
+                        n = snprintf(seq, sizeof(seq), "\r\n");
+                    else if(x == 0)
+                        n = snprintf(seq, sizeof(seq), "\033[%dH", y + 1);
+                    else
+                        n = snprintf(seq, sizeof(seq), "\033[%d;%dH", y + 1, x + 1);
+                    vt100_put(d, seq, n);
+                }
+                cy = y;
+                cx = x;
+            }
+
+            // change attributes only on transitions
+            vt100_sgr(self, attr, vt100_cell_attr(d, b));
+            attr = vt100_cell_attr(d, b);
+
+            // clear the rest of the row at once if it is blank
+            if(b->c == L' ') {
+                for(i = x; i < back->cols; i++)
+                    if(back->cells[y * back->cols + i].c != L' ' ||
+                       vt100_cell_attr(d, &back->cells[y * back->cols + i]) != attr)
+                        break;
+                if(i == back->cols && back->cols - x > 3) {
+                    vt100_puts(d, "\033[K");
+                    for(i = x; i < back->cols; i++) {
+                        front->cells[y * front->cols + i].c = L' ';
+                        front->cells[y * front->cols + i].attr = attr;
+                    }
+                    break;
+                }
+            }
+
+            // a lone right half of a double width char is shown blank
+            memset(&state, 0, sizeof(state));
+            n = b->c ? wcrtomb(mb, b->c, &state) : 0;
+            vt100_put(d, n > 0 ? mb : " ", n > 0 ? n : 1);
+
+            f->c = b->c;
+            f->attr = attr;
+            if(w > 1) {
+                f[1].c = L'\0';
+                f[1].attr = attr;
+            }
+
+            cx += w;
+
+            // the cursor position is unreliable after the last column
+            if(cx >= back->cols)
+                cy = cx = -1;
+        }
+    }
+
+    sent = vt100_send(d);
+    self->frames++;
+    self->bytes += sent;
+    self->last_bytes = sent;
+}
+
+// translate escape sequences of the most common keys to ncurses key codes
+static int vt100_decode(vt100_data_t *d) {
+    static const struct {
+        const char *seq;
+        int key;
+    } keys[] = {
+        { "[A", KEY_UP },    { "OA", KEY_UP },
+        { "[B", KEY_DOWN },  { "OB", KEY_DOWN },
+        { "[C", KEY_RIGHT }, { "OC", KEY_RIGHT },
+        { "[D", KEY_LEFT },  { "OD", KEY_LEFT },
+        { "[H", KEY_HOME },  { "OH", KEY_HOME },
+        { "[1~", KEY_HOME }, { "[7~", KEY_HOME },
+        { "[F", KEY_END },   { "OF", KEY_END },
+        { "[4~", KEY_END },  { "[8~", KEY_END },
+        { "[5~", KEY_PPAGE },
+        { "[6~", KEY_NPAGE },
+        { NULL, 0 }
+    };
+    int i, n, c = d->in[0];
+
+    n = 1;
+    if(c == 27 && d->in_size > 1) {
+        for(i = 0; keys[i].seq; i++) {
+            n = strlen(keys[i].seq);
+            if(d->in_size > n && !memcmp(&d->in[1], keys[i].seq, n)) {
+                c = keys[i].key;
+                n++;
+                break;
+            }
+        }
+        if(!keys[i].seq)
+            n = 1;
+    }
+
+    d->in_size -= n;
+    memmove(d->in, &d->in[n], d->in_size);
+    return c;
+}
+
+static int vt100_getkey(render_t *self, int timeout) {
+    vt100_data_t *d = VT(self);
+    struct pollfd pfd = { d->fd_in, POLLIN, 0 };
+    int n;
+
+    while(d->in_size == 0) {
+        if(!d->tty && vt100_resized)
+            return KEY_RESIZE;
+
+        n = poll(&pfd, 1, timeout < 0 ? -1 : timeout * 100);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+            return ERR;
+
+        n = read(d->fd_in, d->in, sizeof(d->in));
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+            return ERR;
+        d->in_size = n;
+    }
+
+    return vt100_decode(d);
+}
+
+static void vt100_delete(render_t *self) {
+    vt100_data_t *d = VT(self);
+
+    vt100_close(self);
+    if(d->tty)
+        close(d->fd_out);
+    grid_delete(d->front);
+    grid_delete(d->back);
+    free(d->out);
+    free(d);
+    free(self);
+}
+
+render_t *render_vt100_init(void) {
+    render_t *x = render_new();
+    vt100_data_t *d = NULL;
+
+    if((d = calloc(1, sizeof(vt100_data_t))) == NULL) {
+        fprintf(stderr, "%s\n", "render_vt100_init() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+    d->front = grid_init(1, 1);
+    d->back = grid_init(1, 1);
+
+    x->data = d;
+    x->open = vt100_open;
+    x->close = vt100_close;
+    x->init_pair = vt100_init_pair;
+    x->bkgd = vt100_bkgd;
+    x->erase = vt100_erase;
+    x->viewport = vt100_viewport;
+    x->move = vt100_move;
+    x->addnwstr = vt100_addnwstr;
+    x->attron = vt100_attron;
+    x->attroff = vt100_attroff;
+    x->getx = vt100_getx;
+    x->blit = vt100_blit;
+    x->flush = vt100_flush;
+    x->getkey = vt100_getkey;
+    x->delete = vt100_delete;
+    x->input = STDIN_FILENO;
+    d->fd_in = STDIN_FILENO;
+    d->fd_out = STDOUT_FILENO;
+    return x;
+}
+
+render_t *render_vt100_tty(const char *path) {
+    render_t *x;
+    int fd;
+
+    if((fd = open(path, O_RDWR | O_NOCTTY | O_CLOEXEC)) < 0)
+        return NULL;
+    if(!isatty(fd)) {
+        close(fd);
+        errno = ENOTTY;
+        return NULL;
+    }
+
+    x = render_vt100_init();
+    x->input = fd;
+    VT(x)->fd_in = fd;
+    VT(x)->fd_out = fd;
+    VT(x)->tty = true;
+    return x;
+}
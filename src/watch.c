@@ -0,0 +1,244 @@
+/*
+ * Watching the files of a deck to reload it when they change.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <dirent.h>    // opendir, readdir
+#include <limits.h>    // PATH_MAX
+#include <stdio.h>     // fprintf, snprintf
+#include <stdlib.h>    // calloc, free
+#include <string.h>    // strdup, strrchr
+#include <sys/stat.h>
+#include <unistd.h>    // close, read
+
+#if defined( __linux__ )
+#include <sys/inotify.h>
+#endif
+
+#include "watch.h"
+
+// a file of a directory which is a chapter of the deck, as main.c takes
+// them
+static bool watch_chapter(const char *name) {
+    size_t len = strlen(name);
+
+    return name[0] != '.' && len > 3 && !strcmp(&name[len - 3], ".md");
+}
+
+// the files were left alone long enough, the change is pending
+static void watch_settled(event_t *ev, void *data) {
+    watch_t *w = data;
+
+    w->delay = 0;
+    w->changed = true;
+    event_wake(ev);
+}
+
+// a file changed, wait for further changes before making it pending
+static void watch_touch(watch_t *w) {
+    if(w->delay)
+        event_cancel(w->ev, w->delay);
+    w->delay = event_timer(w->ev, WATCH_DELAY, watch_settled, w);
+}
+
+// inode, size and modification time of a file mixed, 0 if it is missing
+static uint64_t watch_stat(const char *path) {
+    struct stat st;
+    uint64_t h;
+
+    if(stat(path, &st) != 0)
+        return 0;
+
+    h = (uint64_t) st.st_ino;
+    h = (h * 0x100000001b3ULL) ^ (uint64_t) st.st_size;
+    h = (h * 0x100000001b3ULL) ^ (uint64_t) st.st_mtime;
+    return (h * 0x100000001b3ULL) | 1;
+}
+
+// the files and the chapters of the directories, 0 if one is missing,
+// e.g. while an editor replaces it
+static uint64_t watch_stamp(const watch_t *w) {
+    char path[PATH_MAX];
+    struct dirent *entry;
+    uint64_t stamp = 0, h;
+    DIR *dir;
+    int i;
+
+    for(i = 0; i < w->files; i++) {
+        if(!(h = watch_stat(w->file[i].path)))
+            return 0;
+        stamp += h;
+
+        if(w->file[i].name || !(dir = opendir(w->file[i].path)))
+            continue;
+        while((entry = readdir(dir))) {
+            if(watch_chapter(entry->d_name) &&
+               snprintf(path, sizeof(path), "%s/%s", w->file[i].path, entry->d_name) < (int) sizeof(path))
+                stamp += watch_stat(path);
+        }
+        closedir(dir);
+    }
+
+    return stamp;
+}
+
+static void watch_poll(event_t *ev, void *data) {
+    watch_t *w = data;
+    uint64_t stamp = watch_stamp(w);
+
+    if(stamp && stamp != w->stamp) {
+        w->stamp = stamp;
+        watch_touch(w);
+    }
+    w->poll = event_timer(ev, WATCH_POLL, watch_poll, w);
+}
+
+#if defined( __linux__ )
+// watch the directory of a file, or the chapters of a directory
+static int watch_add(watch_t *w, const watch_file_t *f) {
+    char dir[PATH_MAX];
+    int len;
+
+    // chapters removed count as well
+    if(!f->name)
+        return inotify_add_watch(w->fd, f->path, IN_CLOSE_WRITE | IN_MOVED_TO |
+                                 IN_MOVED_FROM | IN_DELETE | IN_MASK_ADD);
+
+    // the directory with its slash, the current one if there is none
+    len = f->name - f->path;
+    snprintf(dir, sizeof(dir), "%.*s", len, f->path);
+    return inotify_add_watch(w->fd, len ? dir : ".", IN_CLOSE_WRITE | IN_MOVED_TO | IN_MASK_ADD);
+}
+
+static void watch_read(event_t *ev, int fd, void *data) {
+    char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event *e;
+    watch_t *w = data;
+    ssize_t n;
+    char *p;
+    int i;
+
+    if((n = read(fd, buf, sizeof(buf))) <= 0)
+        return;
+
+    for(p = buf; p < buf + n; p += sizeof(struct inotify_event) + e->len) {
+        e = (const struct inotify_event *) p;
+
+        // events were dropped, any file may have changed
+        if(e->mask & IN_Q_OVERFLOW) {
+            watch_touch(w);
+            continue;
+        }
+
+        // a file removed is not reloaded, a chapter removed is
+        for(i = 0; i < w->files; i++) {
+            if(w->file[i].wd != e->wd || !e->len)
+                continue;
+            if(!w->file[i].name && watch_chapter(e->name))
+                watch_touch(w);
+            else if(w->file[i].name && !strcmp(w->file[i].name, e->name) &&
+                    (e->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)))
+                watch_touch(w);
+        }
+    }
+}
+#endif // defined( __linux__ )
+
+watch_t *watch_init(event_t *ev, char **paths, int n) {
+    struct stat st;
+    watch_t *w;
+    char *slash;
+    int i;
+
+    w = calloc(1, sizeof(watch_t));
+    if(!w || !(w->file = calloc(n, sizeof(watch_file_t)))) {
+        fprintf(stderr, "%s\n", "watch_init() failed to allocate memory.");
+        exit(EXIT_FAILURE);
+    }
+    w->ev = ev;
+    w->files = n;
+    w->fd = -1;
+
+    for(i = 0; i < n; i++) {
+        w->file[i].wd = -1;
+        if(!(w->file[i].path = strdup(paths[i]))) {
+            fprintf(stderr, "%s\n", "watch_init() failed to allocate memory.");
+            exit(EXIT_FAILURE);
+        }
+        if(stat(paths[i], &st) == 0 && S_ISDIR(st.st_mode))
+            continue;
+
+        // an editor may replace the file, so its directory is watched
+        slash = strrchr(w->file[i].path, '/');
+        w->file[i].name = slash ? slash + 1 : w->file[i].path;
+    }
+
+#if defined( __linux__ )
+    if((w->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) >= 0) {
+        for(i = 0; i < n; i++)
+            if((w->file[i].wd = watch_add(w, &w->file[i])) < 0)
+                break;
+
+        // e.g. out of watches, the files are polled instead
+        if(i < n) {
+            close(w->fd);
+            w->fd = -1;
+        } else {
+            event_watch(ev, w->fd, watch_read, w);
+        }
+    }
+#endif
+
+    if(w->fd < 0) {
+        w->stamp = watch_stamp(w);
+        w->poll = event_timer(ev, WATCH_POLL, watch_poll, w);
+    }
+
+    return w;
+}
+
+bool watch_pending(const watch_t *w) {
+    return w->changed;
+}
+
+bool watch_take(watch_t *w) {
+    if(!w->changed)
+        return false;
+
+    w->changed = false;
+    return true;
+}
+
+void watch_delete(watch_t *w) {
+    int i;
+
+    if(w->poll)
+        event_cancel(w->ev, w->poll);
+    if(w->delay)
+        event_cancel(w->ev, w->delay);
+    if(w->fd >= 0) {
+        event_unwatch(w->ev, w->fd);
+        close(w->fd);
+    }
+
+    for(i = 0; i < w->files; i++)
+        free(w->file[i].path);
+    free(w->file);
+    free(w);
+}
@@ -0,0 +1,98 @@
+/*
+ * Memory of the slides of a lazily loaded deck, shown with a cache limit.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <limits.h> // INT_MAX
+#include <locale.h> // setlocale
+
+#include "display.h"
+#include "parser.h"
+#include "render.h"
+#include "viewer.h"
+#include "test.h"
+
+#define SLIDES 200
+#define BUDGET (64 * 1024)
+
+// bytes of the slides loaded, as counted by the cache
+static size_t resident(deck_t *deck) {
+    size_t bytes = 0;
+    slide_t *slide;
+
+    for(slide = deck->slide; slide; slide = slide->next)
+        if(slide->loaded)
+            bytes += slide->bytes;
+
+    return bytes;
+}
+
+int main(void) {
+    FILE *input = tmpfile();
+    render_t *render;
+    slide_t *slide;
+    deck_t *deck;
+    int i, sc, pass, max_cols, stop;
+
+    setlocale(LC_CTYPE, "C.UTF-8");
+
+    for(i = 0; i < SLIDES; i++) {
+        fprintf(input, "%s# slide %d\n\n", i ? "\n---\n\n" : "", i);
+        fprintf(input, "some *text* with `code` and a [link %d](http://example.com/%d)\n\n", i, i);
+        fprintf(input, "- an item\n- another item\n\n");
+        fprintf(input, "    code line %d\n", i);
+    }
+    rewind(input);
+
+    deck = markdown_index(input, 1);
+    markdown_scan(deck, INT_MAX);
+    markdown_cache(deck, BUDGET);
+    render = render_headless_init(24, 80);
+
+    // the deck is larger than the limit, every slide is shown twice, so
+    // its display list is compiled
+    for(pass = 0; pass < 2; pass++) {
+        for(slide = deck->slide, sc = 1; slide; slide = slide->next, sc++) {
+            max_cols = 0;
+            CHECK(layout_check_slide(deck, render, slide, 2, &max_cols));
+            slide->stop = INT_MAX - 1;
+            for(i = 0; i < 2; i++)
+                display_slide(render, deck, slide, sc, max_cols, 2, 0, &stop);
+            slide->stop = 0;
+
+            CHECK(slide->display && slide->display->lines > 0);
+            CHECK(slide->bytes >= display_bytes(slide->display));
+            CHECK(resident(deck) <= BUDGET);
+        }
+    }
+
+    // unloaded slides hold no display list
+    for(slide = deck->slide, i = 0; slide; slide = slide->next) {
+        if(!slide->loaded) {
+            CHECK(!slide->display);
+            i++;
+        }
+    }
+    CHECK(i > SLIDES / 2);
+
+    (render->delete)(render);
+    free_deck(deck);
+
+    return TEST_RESULT;
+}
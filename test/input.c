@@ -0,0 +1,222 @@
+/*
+ * Decks read plain and compressed, from files and pipes.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#define _POSIX_C_SOURCE 200809L // fdopen, mkstemp
+
+#include <errno.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#if defined( HAVE_ZLIB )
+#include <zlib.h>
+#endif
+
+#if defined( HAVE_ZSTD )
+#include <zstd.h>
+#endif
+
+#include "input.h"
+#include "test.h"
+
+// more than the output buffers of the decoders, so a read ends inside
+// a frame
+#define DECK_SIZE (512 * 1024)
+
+static char deck[DECK_SIZE];
+static char path[] = "/tmp/smdp-test-XXXXXX";
+
+static void make_deck(void) {
+    size_t len = 0;
+    int i = 0;
+
+    // the slide number keeps it from compressing to nothing
+    while(len + 64 < sizeof(deck)) {
+        if(i % 8 == 0)
+            len += sprintf(&deck[len], "-------------------\n\n# slide %d\n\n", i / 8);
+        len += sprintf(&deck[len], "- item %d of some list\n", i++);
+    }
+    memset(&deck[len], '.', sizeof(deck) - len);
+}
+
+static void write_file(const void *buf, size_t size) {
+    FILE *f = fopen(path, "w");
+
+    fwrite(buf, 1, size, f);
+    fclose(f);
+}
+
+// a pipe fed with the file by a child
+static FILE *pipe_file(void) {
+    char buf[4096];
+    int fd[2];
+    size_t n;
+    FILE *f;
+
+    if(pipe(fd) != 0)
+        return NULL;
+
+    if(fork() == 0) {
+        close(fd[0]);
+        f = fopen(path, "r");
+        while((n = fread(buf, 1, sizeof(buf), f)) > 0)
+            if(write(fd[1], buf, n) != (ssize_t) n)
+                _exit(EXIT_FAILURE);
+        _exit(EXIT_SUCCESS);
+    }
+
+    close(fd[1]);
+    return fdopen(fd[0], "r");
+}
+
+// true if the stream gives the deck, read in odd sized chunks
+static int read_deck(FILE *input) {
+    static char buf[DECK_SIZE + 1];
+    size_t len = 0, n;
+
+    if(!input)
+        return 0;
+
+    while((n = fread(&buf[len], 1, len + 1000 < sizeof(buf) ? 1000 : sizeof(buf) - len, input)) > 0)
+        len += n;
+
+    n = !ferror(input) && len == sizeof(deck) && !memcmp(buf, deck, len);
+    fclose(input);
+    wait(NULL);
+
+    return n;
+}
+
+// true if the stream fails with an I/O error
+static int read_error(FILE *input) {
+    char buf[4096];
+    int failed;
+
+    if(!input)
+        return 0;
+
+    errno = 0;
+    while(fread(buf, 1, sizeof(buf), input) > 0)
+        ;
+
+    failed = ferror(input) && errno == EIO;
+    fclose(input);
+    wait(NULL);
+
+    return failed;
+}
+
+// a file and a pipe give the deck, and both fail when truncated
+static void check_compressed(const unsigned char *buf, size_t size) {
+    write_file(buf, size);
+    CHECK(read_deck(input_open(path)));
+    CHECK(read_deck(input_probe(pipe_file())));
+
+    write_file(buf, size - size / 3);
+    CHECK(read_error(input_open(path)));
+    CHECK(read_error(input_probe(pipe_file())));
+
+    // the last bytes only
+    write_file(buf, size - 1);
+    CHECK(read_error(input_open(path)));
+}
+
+#if defined( HAVE_ZLIB )
+// two gzip members, like concatenated files
+static void check_gzip(void) {
+    static unsigned char buf[DECK_SIZE + 1024];
+    size_t len = 0, half = sizeof(deck) / 2;
+    z_stream z;
+    int i;
+
+    for(i = 0; i < 2; i++) {
+        memset(&z, 0, sizeof(z));
+        deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+        z.next_in = (Bytef *) &deck[i * half];
+        z.avail_in = i ? sizeof(deck) - half : half;
+        z.next_out = &buf[len];
+        z.avail_out = sizeof(buf) - len;
+        CHECK(deflate(&z, Z_FINISH) == Z_STREAM_END);
+        len = sizeof(buf) - z.avail_out;
+        deflateEnd(&z);
+    }
+
+    check_compressed(buf, len);
+}
+#endif // defined( HAVE_ZLIB )
+
+#if defined( HAVE_ZSTD )
+static void check_zstd(void) {
+    static unsigned char buf[DECK_SIZE + 1024];
+    size_t len = ZSTD_compress(buf, sizeof(buf), deck, sizeof(deck), 3);
+
+    CHECK(!ZSTD_isError(len));
+    CHECK(sizeof(deck) > ZSTD_DStreamOutSize());
+    check_compressed(buf, len);
+}
+#endif // defined( HAVE_ZSTD )
+
+int main(void) {
+    int fd = mkstemp(path);
+
+    if(fd < 0) {
+        perror(path);
+        return EXIT_FAILURE;
+    }
+    close(fd);
+
+    make_deck();
+
+    // plain text, a file must still seek from the start
+    write_file(deck, sizeof(deck));
+    FILE *input = input_open(path);
+    CHECK(input && fseek(input, 0, SEEK_END) == 0 && ftell(input) == sizeof(deck));
+    if(input)
+        fclose(input);
+    CHECK(read_deck(input_open(path)));
+    CHECK(read_deck(input_probe(pipe_file())));
+
+    // shorter than the magic bytes
+    write_file("#", 1);
+    input = input_probe(pipe_file());
+    CHECK(input && fgetc(input) == '#' && fgetc(input) == EOF);
+    if(input)
+        fclose(input);
+    wait(NULL);
+
+#if defined( HAVE_ZLIB )
+    check_gzip();
+#else
+    write_file("\x1f\x8b\x08\x00", 4);
+    CHECK(!input_open(path) && errno == ENOTSUP);
+#endif
+
+#if defined( HAVE_ZSTD )
+    check_zstd();
+#else
+    write_file("\x28\xb5\x2f\xfd", 4);
+    CHECK(!input_open(path) && errno == ENOTSUP);
+#endif
+
+    unlink(path);
+
+    return TEST_RESULT;
+}
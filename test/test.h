@@ -0,0 +1,43 @@
+#if !defined( TEST_H )
+#define TEST_H
+
+/*
+ * Checks of the test programs.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * CHECK reports a failed condition on STDERR and goes on, a test program
+ * returns TEST_RESULT from main, which fails if any check failed.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static int test_failed = 0;
+
+#define CHECK(cond) do { \
+        if(!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            test_failed++; \
+        } \
+    } while(0)
+
+#define TEST_RESULT (test_failed ? EXIT_FAILURE : EXIT_SUCCESS)
+
+#endif // !defined( TEST_H )
@@ -0,0 +1,108 @@
+/*
+ * Frames of the VT100 backend, written to a pseudo terminal.
+ * Copyright (C) 2018 Michael Goehler
+ *
+ * This file is part of mdp.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#define _XOPEN_SOURCE 600 // posix_openpt
+
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "render.h"
+#include "test.h"
+
+// the output of the backend, read from the master side
+static size_t drain(int master, char *buf, size_t size) {
+    struct pollfd pfd = { master, POLLIN, 0 };
+    size_t len = 0;
+    ssize_t n;
+
+    while(len < size - 1 && poll(&pfd, 1, 100) > 0 &&
+          (n = read(master, &buf[len], size - 1 - len)) > 0)
+        len += n;
+    buf[len] = '\0';
+
+    return len;
+}
+
+int main(void) {
+    struct winsize ws = { 5, 20, 0, 0 };
+    struct termios tio;
+    char buf[4096];
+    const char *p;
+    render_t *r;
+    int master, slave, in, out;
+
+    master = posix_openpt(O_RDWR | O_NOCTTY);
+    if(master < 0 || grantpt(master) || unlockpt(master) ||
+       (slave = open(ptsname(master), O_RDWR | O_NOCTTY)) < 0) {
+        perror("pty");
+        return EXIT_FAILURE;
+    }
+    ioctl(master, TIOCSWINSZ, &ws);
+
+    // the output as it is written, without \n turned into \r\n
+    tcgetattr(slave, &tio);
+    tio.c_oflag &= ~OPOST;
+    tcsetattr(slave, TCSANOW, &tio);
+
+    // the backend reads STDIN and writes STDOUT
+    in = dup(STDIN_FILENO);
+    out = dup(STDOUT_FILENO);
+    dup2(slave, STDIN_FILENO);
+    dup2(slave, STDOUT_FILENO);
+
+    r = render_vt100_init();
+    CHECK((r->open)(r));
+    CHECK(r->lines == 5 && r->cols == 20);
+    drain(master, buf, sizeof(buf));
+
+    // the cursor is anywhere before the first frame, row 0 starting at
+    // column 0 has to be reached with an absolute move
+    (r->erase)(r);
+    (r->move)(r, 0, 0);
+    (r->addnwstr)(r, L"top", -1);
+    (r->move)(r, 1, 0);
+    (r->addnwstr)(r, L"next", -1);
+    (r->flush)(r);
+    drain(master, buf, sizeof(buf));
+
+    CHECK((p = strstr(buf, "\033[2J")) != NULL);
+    if(p) {
+        p += 4;
+        CHECK(!strncmp(p, "\033[H", 3) || !strncmp(p, "\033[1H", 4) ||
+              !strncmp(p, "\033[1;1H", 6));
+        CHECK(strstr(p, "top") < strstr(p, "next"));
+    }
+
+    // once the cursor is known, the next row is reached with a line feed
+    CHECK(strstr(buf, "top\r\nnext") != NULL);
+
+    (r->delete)(r);
+    dup2(in, STDIN_FILENO);
+    dup2(out, STDOUT_FILENO);
+    close(slave);
+    close(master);
+
+    return TEST_RESULT;
+}